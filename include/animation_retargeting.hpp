@@ -1,8 +1,19 @@
+#ifndef ANIMATION_RETARGETING_HPP
+#define ANIMATION_RETARGETING_HPP
+
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 
 #include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <utility>
 #include <vector>
 #include <string_view>
 
@@ -10,8 +21,184 @@
 
 namespace animation_retargeting {
 
+// A bone name interned with intern_name. Equal names have equal ids everywhere in the process, so bones can be matched without comparing strings.
+using NameId = std::uint32_t;
+constexpr auto no_name = static_cast<NameId>(-1);
+
+namespace detail {
+
+// Open addressing with linear probing, keeping the table at most half full.
+// Lookups share the lock, so threads that only find names don't wait for each other.
+class NameTable {
+private:
+    struct Slot_ {
+        std::size_t hash;
+        NameId id{no_name};
+    };
+
+    std::shared_mutex mutex_;
+    // A deque, so that names don't move when more are added.
+    std::deque<std::string> names_;
+    std::vector<Slot_> slots_ = std::vector<Slot_>(64);
+
+    std::size_t find_slot_(std::string_view const name, std::size_t const hash) const
+    {
+        auto const mask = slots_.size() - 1;
+        for (auto i = hash & mask;; i = (i + 1) & mask) {
+            auto const& slot = slots_[i];
+            if (slot.id == no_name || (slot.hash == hash && names_[slot.id] == name)) {
+                return i;
+            }
+        }
+    }
+    void grow_()
+    {
+        auto slots = std::vector<Slot_>(slots_.size()*2);
+        auto const mask = slots.size() - 1;
+        for (auto const& slot : slots_) {
+            if (slot.id != no_name) {
+                auto i = slot.hash & mask;
+                while (slots[i].id != no_name) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = slot;
+            }
+        }
+        slots_ = std::move(slots);
+    }
+
+public:
+    NameId intern(std::string_view const name)
+    {
+        auto const hash = std::hash<std::string_view>{}(name);
+        {
+            auto const lock = std::shared_lock{mutex_};
+            if (auto const id = slots_[find_slot_(name, hash)].id; id != no_name) {
+                return id;
+            }
+        }
+        auto const lock = std::unique_lock{mutex_};
+
+        // Another thread may have added the name in between.
+        auto slot = find_slot_(name, hash);
+        if (slots_[slot].id != no_name) {
+            return slots_[slot].id;
+        }
+        if ((names_.size() + 1)*2 > slots_.size()) {
+            grow_();
+            slot = find_slot_(name, hash);
+        }
+        names_.emplace_back(name);
+        slots_[slot] = Slot_{hash, static_cast<NameId>(names_.size() - 1)};
+        return slots_[slot].id;
+    }
+    NameId find(std::string_view const name)
+    {
+        auto const hash = std::hash<std::string_view>{}(name);
+        auto const lock = std::shared_lock{mutex_};
+        return slots_[find_slot_(name, hash)].id;
+    }
+    std::string_view name(NameId const id)
+    {
+        auto const lock = std::shared_lock{mutex_};
+        return names_[id];
+    }
+};
+
+inline NameTable& name_table() {
+    static auto table = NameTable{};
+    return table;
+}
+
+} // namespace detail
+
+inline NameId intern_name(std::string_view const name) {
+    return detail::name_table().intern(name);
+}
+// The name's id if it has been interned, otherwise no_name. Unlike intern_name, this doesn't add names that are only looked up.
+inline NameId find_name(std::string_view const name) {
+    return detail::name_table().find(name);
+}
+// Stays valid for the rest of the process.
+inline std::string_view name_string(NameId const id) {
+    return detail::name_table().name(id);
+}
+
+// Maps interned names to indices, like those of a pose's bones. The first index added for a name is kept.
+class NameIndex {
+public:
+    static constexpr auto not_found = static_cast<std::size_t>(-1);
+
+private:
+    struct Slot_ {
+        NameId name{no_name};
+        std::size_t index{not_found};
+    };
+
+    std::vector<Slot_> slots_;
+    std::size_t size_{};
+
+    // Fibonacci hashing, since ids are mostly small consecutive numbers.
+    std::size_t first_slot_(NameId const name) const {
+        return static_cast<std::size_t>((static_cast<std::uint64_t>(name)*0x9e3779b97f4a7c15) >> 32) & (slots_.size() - 1);
+    }
+    void add_(NameId const name, std::size_t const index)
+    {
+        auto i = first_slot_(name);
+        for (; slots_[i].name != no_name; i = (i + 1) & (slots_.size() - 1)) {
+            if (slots_[i].name == name) {
+                return;
+            }
+        }
+        slots_[i] = Slot_{name, index};
+        ++size_;
+    }
+
+public:
+    void add(NameId const name, std::size_t const index)
+    {
+        if (name == no_name) {
+            return;
+        }
+        if ((size_ + 1)*2 > slots_.size()) 
+        {
+            auto old_slots = std::move(slots_);
+            slots_ = std::vector<Slot_>(std::max(std::size_t{16}, old_slots.size()*2));
+            size_ = 0;
+            for (auto const& slot : old_slots) {
+                if (slot.name != no_name) {
+                    add_(slot.name, slot.index);
+                }
+            }
+        }
+        add_(name, index);
+    }
+
+    std::size_t find(NameId const name) const
+    {
+        if (slots_.empty() || name == no_name) {
+            return not_found;
+        }
+        for (auto i = first_slot_(name); slots_[i].name != no_name; i = (i + 1) & (slots_.size() - 1)) {
+            if (slots_[i].name == name) {
+                return slots_[i].index;
+            }
+        }
+        return not_found;
+    }
+
+    void clear() {
+        slots_.clear();
+        size_ = 0;
+    }
+
+    std::size_t byte_size() const {
+        return slots_.capacity()*sizeof(Slot_);
+    }
+};
+
 struct PoseBone {
-    std::string name;
+    NameId name{no_name};
     
     static constexpr auto no_parent = static_cast<std::size_t>(-1);
     std::size_t parent_index{no_parent};
@@ -23,48 +210,106 @@ struct PoseBone {
 
 struct Pose {
     std::vector<PoseBone> bones;
+
+    // The index of each bone by name.
+    NameIndex create_name_index() const
+    {
+        auto index = NameIndex{};
+        for (auto i = std::size_t{}; i < bones.size(); ++i) {
+            index.add(bones[i].name, i);
+        }
+        return index;
+    }
 };
 
 struct AnimatedBone {
     std::vector<glm::vec3> scales;
     std::vector<glm::quat> rotations;
     std::vector<glm::vec3> translations;
+
+    // The channels' key times, as indices into Animation::time_axes. Channels without times have no_time_axis, 
+    // and so do channels that collapse_constant_channels has shortened to one value.
+    static constexpr auto no_time_axis = static_cast<std::size_t>(-1);
+    std::size_t scale_time_axis{no_time_axis};
+    std::size_t rotation_time_axis{no_time_axis};
+    std::size_t translation_time_axis{no_time_axis};
+
+    // Whether any of the channels changes over time. Channels with one value or none are constant.
+    bool is_animated() const {
+        return scales.size() > 1 || rotations.size() > 1 || translations.size() > 1;
+    }
 };
 
 struct Animation {
     std::vector<AnimatedBone> bones;
+    // Key times in seconds, shared by every channel that has the same ones.
+    std::vector<std::vector<float>> time_axes;
 };
 
+// Returns the index of the animation's time axis with the same times, adding one if there is none.
+inline std::size_t add_time_axis(Animation& animation, std::vector<float> times)
+{
+    auto const pos = std::find(animation.time_axes.begin(), animation.time_axes.end(), times);
+    if (pos != animation.time_axes.end()) {
+        return static_cast<std::size_t>(pos - animation.time_axes.begin());
+    }
+    animation.time_axes.push_back(std::move(times));
+    return animation.time_axes.size() - 1;
+}
+
 struct RetargetResult {
     Animation animation;
     Pose bind_pose;
 };
 
-inline RetargetResult retarget(Animation source_animation, Pose const& source_bind_pose, Pose target_bind_pose)
+// How a target bone is animated: the source bone that drives it, and the correction applied to that bone's translations.
+struct RetargetBone {
+    static constexpr auto no_source = static_cast<std::size_t>(-1);
+    std::size_t source_index{no_source};
+
+    glm::quat translation_rotation{glm::identity<glm::quat>()};
+    float translation_scale{1.f};
+
+    glm::vec3 retarget_translation(glm::vec3 const translation) const {
+        return glm::rotate(translation_rotation, translation * translation_scale);
+    }
+};
+
+// Everything retarget() needs from the two bind poses, so that it can be computed once and applied to any number of frames.
+struct Retargeting {
+    std::vector<RetargetBone> bones;
+    Pose bind_pose;
+};
+
+inline Retargeting create_retargeting(Pose const& source_bind_pose, Pose target_bind_pose)
 {
-    assert(source_animation.bones.size() == source_bind_pose.bones.size());
+    auto result = Retargeting{};
+    result.bones.reserve(target_bind_pose.bones.size());
+    result.bind_pose.bones.reserve(target_bind_pose.bones.size());
+
+    auto const source_bones_by_name = source_bind_pose.create_name_index();
 
-    auto result = RetargetResult{};
     for (auto& target_pose_bone : target_bind_pose.bones) 
     {
-        auto const source_pos = std::find_if(source_bind_pose.bones.begin(), source_bind_pose.bones.end(), [&](auto const& x) { return x.name == target_pose_bone.name; });
+        auto const source_index = source_bones_by_name.find(target_pose_bone.name);
         
-        if (source_pos == source_bind_pose.bones.end()) {
+        if (source_index == NameIndex::not_found) {
             if (target_pose_bone.parent_index != PoseBone::no_parent) {
                 auto const parent_rotation = target_bind_pose.bones[target_pose_bone.parent_index].rotation;
                 target_pose_bone.translation = glm::rotate(parent_rotation, target_pose_bone.translation);
                 target_pose_bone.rotation = parent_rotation;
             }
             result.bind_pose.bones.push_back(PoseBone{
-                std::move(target_pose_bone.name),
+                target_pose_bone.name,
                 target_pose_bone.parent_index,
                 target_pose_bone.scale,
                 glm::identity<glm::quat>(),
                 target_pose_bone.translation
             });
-            result.animation.bones.push_back(AnimatedBone{});
+            result.bones.push_back(RetargetBone{});
         }
         else {
+            auto const source_pos = source_bind_pose.bones.begin() + static_cast<std::ptrdiff_t>(source_index);
             if (target_pose_bone.parent_index == PoseBone::no_parent) {
                 target_pose_bone.rotation = glm::inverse(source_pos->rotation) * target_pose_bone.rotation;
             }
@@ -75,19 +320,16 @@ inline RetargetResult retarget(Animation source_animation, Pose const& source_bi
             }
             
             // auto const translation_offset = target_pose_bone.translation - source_pos->translation;
-            auto const translation_rotation_offset = glm::rotation(glm::normalize(source_pos->translation), glm::normalize(target_pose_bone.translation));
-            auto const scale_factor = std::sqrt(glm::length2(target_pose_bone.translation) / glm::length2(source_pos->translation));
-
-            auto& animated_bone = source_animation.bones[source_pos - source_bind_pose.bones.begin()];
-            for (auto& translation : animated_bone.translations) {         
-                // translation = translation + translation_offset;
-                // translation = (translation - source_pos->translation) * scale_factor + target_pose_bone.translation;
-                translation = glm::rotate(translation_rotation_offset, translation * scale_factor);
-            }
-            result.animation.bones.push_back(std::move(animated_bone));
+            // translation = translation + translation_offset;
+            // translation = (translation - source_pos->translation) * scale_factor + target_pose_bone.translation;
+            result.bones.push_back(RetargetBone{
+                source_index,
+                glm::rotation(glm::normalize(source_pos->translation), glm::normalize(target_pose_bone.translation)),
+                std::sqrt(glm::length2(target_pose_bone.translation) / glm::length2(source_pos->translation))
+            });
 
             result.bind_pose.bones.push_back(PoseBone{
-                std::move(target_pose_bone.name),
+                target_pose_bone.name,
                 target_pose_bone.parent_index,
                 target_pose_bone.scale,
                 source_pos->rotation,
@@ -98,4 +340,105 @@ inline RetargetResult retarget(Animation source_animation, Pose const& source_bi
     return result;
 }
 
+// Works on any range of frames, so a long source animation can be retargeted in consecutive chunks.
+inline Animation apply_retargeting(Retargeting const& retargeting, Animation source_animation)
+{
+    auto animation = Animation{};
+    animation.bones.reserve(retargeting.bones.size());
+
+    for (auto const& bone : retargeting.bones) 
+    {
+        if (bone.source_index == RetargetBone::no_source) {
+            animation.bones.push_back(AnimatedBone{});
+            continue;
+        }
+
+        auto& animated_bone = source_animation.bones[bone.source_index];
+        for (auto& translation : animated_bone.translations) {         
+            translation = bone.retarget_translation(translation);
+        }
+        animation.bones.push_back(std::move(animated_bone));
+    }
+    animation.time_axes = std::move(source_animation.time_axes);
+    return animation;
+}
+
+// Like the above, but writes into an animation whose arrays keep their capacity, 
+// so that retargeting chunk after chunk into the same animation stops allocating once the arrays are big enough.
+inline void apply_retargeting(Retargeting const& retargeting, Animation const& source_animation, Animation& animation)
+{
+    animation.bones.resize(retargeting.bones.size());
+
+    for (auto i = std::size_t{}; i < retargeting.bones.size(); ++i) 
+    {
+        auto const& bone = retargeting.bones[i];
+        auto& animated_bone = animation.bones[i];
+
+        if (bone.source_index == RetargetBone::no_source) {
+            animated_bone.scales.clear();
+            animated_bone.rotations.clear();
+            animated_bone.translations.clear();
+            animated_bone.scale_time_axis = animated_bone.rotation_time_axis = animated_bone.translation_time_axis = AnimatedBone::no_time_axis;
+            continue;
+        }
+
+        auto const& source_bone = source_animation.bones[bone.source_index];
+        animated_bone.scales.assign(source_bone.scales.begin(), source_bone.scales.end());
+        animated_bone.rotations.assign(source_bone.rotations.begin(), source_bone.rotations.end());
+        animated_bone.translations.resize(source_bone.translations.size());
+        std::transform(source_bone.translations.begin(), source_bone.translations.end(), animated_bone.translations.begin(), 
+            [&](glm::vec3 const translation) { return bone.retarget_translation(translation); });
+        animated_bone.scale_time_axis = source_bone.scale_time_axis;
+        animated_bone.rotation_time_axis = source_bone.rotation_time_axis;
+        animated_bone.translation_time_axis = source_bone.translation_time_axis;
+    }
+
+    animation.time_axes.resize(source_animation.time_axes.size());
+    for (auto i = std::size_t{}; i < source_animation.time_axes.size(); ++i) {
+        animation.time_axes[i].assign(source_animation.time_axes[i].begin(), source_animation.time_axes[i].end());
+    }
+}
+
+// Shortens the channels whose values never change to their first value, so that they are only retargeted and sampled once.
+// A shortened channel has no times any more, the time axis it used stays in the animation for the other channels.
+inline void collapse_constant_channels(Animation& animation)
+{
+    auto const collapse = [](auto& values, std::size_t& time_axis, auto const& is_close) {
+        if (values.size() > 1 && std::all_of(values.begin() + 1, values.end(), [&](auto const& value) { return is_close(value, values.front()); })) {
+            values.resize(1);
+            time_axis = AnimatedBone::no_time_axis;
+        }
+    };
+    auto const is_close_vector = [](glm::vec3 const a, glm::vec3 const b) { return glm::length2(a - b) <= 1e-12f; };
+    auto const is_close_rotation = [](glm::quat const a, glm::quat const b) { return std::abs(glm::dot(a, b)) >= 1.f - 1e-6f; };
+
+    for (auto& bone : animation.bones) {
+        collapse(bone.scales, bone.scale_time_axis, is_close_vector);
+        collapse(bone.rotations, bone.rotation_time_axis, is_close_rotation);
+        collapse(bone.translations, bone.translation_time_axis, is_close_vector);
+    }
+}
+
+enum class ConstantChannels { keep, collapse };
+
+// The result has the source animation's channels with the same numbers of values, 
+// unless constant_channels is ConstantChannels::collapse, see collapse_constant_channels.
+inline RetargetResult retarget(Animation source_animation, Pose const& source_bind_pose, Pose target_bind_pose, 
+    ConstantChannels const constant_channels = ConstantChannels::keep)
+{
+    assert(source_animation.bones.size() == source_bind_pose.bones.size());
+
+    if (constant_channels == ConstantChannels::collapse) {
+        collapse_constant_channels(source_animation);
+    }
+
+    auto retargeting = create_retargeting(source_bind_pose, std::move(target_bind_pose));
+    return RetargetResult{
+        apply_retargeting(retargeting, std::move(source_animation)),
+        std::move(retargeting.bind_pose)
+    };
+}
+
 } // namespace animation_retargeting
+
+#endif
@@ -1,20 +1,26 @@
 #ifndef ANIMATION_RETARGETING_TESTING_ANIMATED_CHARACTER_HPP
 #define ANIMATION_RETARGETING_TESTING_ANIMATED_CHARACTER_HPP
 
-#include "animation.hpp"
+#include "animated_model.hpp"
+#include "arena.hpp"
 #include "model.hpp"
 #include "shader.hpp"
 
+#include <array>
+#include <string>
+
 namespace testing {
 
-constexpr auto model_vertex_shader = R"(
-#version 330 core
+// Compiled once per bone influence variant, with the influence count and attribute types defined in front of it. See model_vertex_shader.
+constexpr auto model_vertex_shader_body = R"(
 layout (location = 0) in vec3 in_pos;
 layout (location = 1) in vec3 in_normal;
 layout (location = 2) in vec2 in_uv;
 
-layout (location = 3) in uvec4 bone_ids;
-layout (location = 4) in vec4 bone_weights;
+layout (location = 3) in BONE_IDS bone_ids;
+#if BONE_INFLUENCE_COUNT > 1
+layout (location = 4) in BONE_WEIGHTS bone_weights;
+#endif
 
 out vec3 normal;
 out vec2 uv;
@@ -31,16 +37,35 @@ void main()
 	uv = in_uv;
 	normal = in_normal;
 
+	// The last weight isn't stored since the weights add up to one.
+#if BONE_INFLUENCE_COUNT == 1
+	mat4 bone_transform = bone_matrices[bone_ids];
+#elif BONE_INFLUENCE_COUNT == 2
+	mat4 bone_transform = bone_matrices[bone_ids[0]] * bone_weights;
+	bone_transform += bone_matrices[bone_ids[1]] * (1.f - bone_weights);
+#else
 	mat4 bone_transform = bone_matrices[bone_ids[0]] * bone_weights[0];
 	bone_transform += bone_matrices[bone_ids[1]] * bone_weights[1];
 	bone_transform += bone_matrices[bone_ids[2]] * bone_weights[2];
-	bone_transform += bone_matrices[bone_ids[3]] * bone_weights[3];
+	bone_transform += bone_matrices[bone_ids[3]] * (1.f - bone_weights[0] - bone_weights[1] - bone_weights[2]);
+#endif
 
 	gl_Position = projection * view * model * bone_transform * vec4(in_pos, 1.f);
 	//normal = normalize(total_normal);
 }
 )";
 
+inline std::string model_vertex_shader(std::size_t const influence_count)
+{
+	constexpr char const* id_types[] = {"uint", "uvec2", "uvec3", "uvec4"};
+	constexpr char const* weight_types[] = {"float", "float", "vec2", "vec3"};
+	return std::string{"#version 330 core\n"} + 
+		"#define BONE_INFLUENCE_COUNT " + std::to_string(influence_count) + "\n" +
+		"#define BONE_IDS " + id_types[influence_count - 1] + "\n" +
+		"#define BONE_WEIGHTS " + weight_types[influence_count - 1] + "\n" +
+		model_vertex_shader_body;
+}
+
 constexpr auto model_fragment_shader = R"(
 #version 330 core
 in vec3 normal;
@@ -85,90 +110,104 @@ void main() {
 }
 )";
 
-inline std::string bone_matrix_uniform_name(Bone::Id const id)
-{
-	return "bone_matrices[" + std::to_string(id) + "]";
-	// return fmt::format("bone_matrices[{}]", id);
-}
-
+// Draws an AnimatedModel with its bone matrices.
 class AnimatedCharacter {
 private:
-	Model model_;
-	ShaderProgram model_shader_{model_vertex_shader, model_fragment_shader};
-	Animation animation_;
-
-	SkeletonMesh skeleton_mesh_{model_.skeleton()};
+	AnimatedModel animated_model_;
+	// A shader per bone influence variant, see bone_influence_variants.
+	std::array<ShaderProgram, bone_influence_variants.size()> model_shaders_{
+		ShaderProgram{model_vertex_shader(bone_influence_variants[0]).c_str(), model_fragment_shader},
+		ShaderProgram{model_vertex_shader(bone_influence_variants[1]).c_str(), model_fragment_shader},
+		ShaderProgram{model_vertex_shader(bone_influence_variants[2]).c_str(), model_fragment_shader},
+	};
+
+	SkeletonMesh skeleton_mesh_{animated_model_.model().skeleton()};
 	ShaderProgram skeleton_shader_{skeleton_vertex_shader, skeleton_fragment_shader};
 
-	float scale_;
-
 public:
 	AnimatedCharacter(Model model, char const* const animation_path, float const scale = 1.f) :
-		model_{std::move(model)}, 
-		animation_{animation_path, model_.skeleton()},
-		scale_{scale}
+		animated_model_{std::move(model), animation_path, scale}
 	{
-		model_shader_.use();
-		model_shader_.set_mat4("view", glm::mat4{1.f});
-		model_shader_.set_mat4("model", glm::mat4{1.f});
-		model_shader_.set_int("diffuse_texture", 0);
+		for (auto& model_shader : model_shaders_) {
+			model_shader.use();
+			model_shader.set_mat4("view", glm::mat4{1.f});
+			model_shader.set_mat4("model", glm::mat4{1.f});
+			model_shader.set_int("diffuse_texture", 0);
+		}
 
 		skeleton_shader_.use();
 		skeleton_shader_.set_mat4("view", glm::mat4{1.f});
 		skeleton_shader_.set_mat4("model", glm::mat4{1.f});
 	}
 
-	void update_skeleton_mesh() {
-		skeleton_mesh_ = SkeletonMesh{model_.skeleton()};
+	AnimatedModel const& animated_model() const {
+		return animated_model_;
+	}
+	AnimatedModel& animated_model() {
+		return animated_model_;
 	}
 
 	Model const& model() const {
-		return model_;
+		return animated_model_.model();
 	}
 	Model& model() {
-		return model_;
+		return animated_model_.model();
+	}
+
+	// Plays the source skeleton's clip, retargeted while it is sampled. See Animation::retarget_from.
+	void retarget_animation_from(Skeleton const& source_skeleton) {
+		animated_model_.retarget_animation_from(source_skeleton);
+		update_skeleton_mesh();
+	}
+
+	void update_skeleton_mesh() {
+		skeleton_mesh_ = SkeletonMesh{animated_model_.model().skeleton()};
 	}
 
 	void position_scale(glm::vec3 const pos, float const scale) {
-		auto const model_transform = glm::translate(glm::mat4{1.f}, pos) * glm::scale(glm::mat4{1.f}, glm::vec3{scale}*scale_);
-		model_shader_.use();
-		model_shader_.set_mat4("model", model_transform);
+		animated_model_.position_scale(pos, scale);
+		for (auto& model_shader : model_shaders_) {
+			model_shader.use();
+			model_shader.set_mat4("model", animated_model_.model_transform());
+		}
 
 		skeleton_shader_.use();
-		skeleton_shader_.set_mat4("model", model_transform);
+		skeleton_shader_.set_mat4("model", animated_model_.model_transform());
 	}
 
 	void projection_matrix(glm::mat4 const& projection) {
-		model_shader_.use();
-		model_shader_.set_mat4("projection", projection);
+		for (auto& model_shader : model_shaders_) {
+			model_shader.use();
+			model_shader.set_mat4("projection", projection);
+		}
 
 		skeleton_shader_.use();
 		skeleton_shader_.set_mat4("projection", projection);
 	}
 
-	void restart_animation() {
-		animation_.restart();
-	}
-
-	void update_animation() {
-		animation_.update_bone_matrices();
-	}
-
-	void draw_model(glm::mat4 const& view_matrix) {
-		model_shader_.use();
-		model_shader_.set_mat4("view", view_matrix);
-		for (auto const& bone : model_.skeleton().bones()) {
-			model_shader_.set_mat4(bone_matrix_uniform_name(bone.id).c_str(), bone.animation_transform);
-		}
-		model_.draw();
+	// The frame arena holds the frame's scratch memory, and is reset once per frame by the caller.
+	void draw_model(glm::mat4 const& view_matrix, util::Arena& frame_arena) 
+	{
+		auto const bone_matrices = animated_model_.gather_bone_matrices(frame_arena);
+
+		// The uniforms are only set for the shaders that are used, once per frame.
+		auto is_shader_ready = std::array<bool, bone_influence_variants.size()>{};
+		animated_model_.model().draw(animated_model_.max_bone_influence_count(), [&](std::size_t const variant) {
+			auto& model_shader = model_shaders_[variant];
+			model_shader.use();
+			if (!is_shader_ready[variant]) {
+				model_shader.set_mat4("view", view_matrix);
+				model_shader.set_mat4_array("bone_matrices", bone_matrices.data(), bone_matrices.size());
+				is_shader_ready[variant] = true;
+			}
+		});
 	}
 
-	void draw_skeleton(glm::mat4 const& view_matrix) {
+	void draw_skeleton(glm::mat4 const& view_matrix, util::Arena& frame_arena) {
+		auto const bone_matrices = animated_model_.gather_bone_matrices(frame_arena);
 		skeleton_shader_.use();
 		skeleton_shader_.set_mat4("view", view_matrix);
-		for (auto const& bone : model_.skeleton().bones()) {
-			skeleton_shader_.set_mat4(bone_matrix_uniform_name(bone.id).c_str(), bone.animation_transform);
-		}
+		skeleton_shader_.set_mat4_array("bone_matrices", bone_matrices.data(), bone_matrices.size());
 		skeleton_shader_.set_vec4("color", glm::vec4{0.f, 1.f, 0.f, 0.5f});
 		skeleton_mesh_.draw_bones();
 		skeleton_shader_.set_vec4("color", glm::vec4{1.f, 0.f, 0.f, 0.5f});
@@ -0,0 +1,159 @@
+#ifndef ANIMATION_RETARGETING_TESTING_ANIMATED_MODEL_HPP
+#define ANIMATION_RETARGETING_TESTING_ANIMATED_MODEL_HPP
+
+#include "animation.hpp"
+#include "arena.hpp"
+#include "baked_palette.hpp"
+#include "bounds.hpp"
+#include "model.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <memory>
+
+namespace testing {
+
+// The size of bone_matrices in the shaders. Bones past it can't skin anything.
+constexpr auto max_shader_bone_count = std::size_t{128};
+
+/*
+	A model and the clip it plays, with everything a frame needs before drawing: updating the bone matrices, culling and
+	gathering the matrices for the shaders. It has no GPU resources of its own, so AnimationLod can update it headless.
+	AnimatedCharacter draws one.
+*/
+class AnimatedModel {
+private:
+	Model model_;
+	std::size_t max_bone_influence_count_{Vertex::max_bone_influence};
+	Animation animation_;
+	// Set when the animation has been baked, see bake_animation.
+	std::unique_ptr<BakedPalette> baked_palette_;
+
+	float scale_;
+	glm::vec3 position_{};
+	glm::mat4 model_transform_{1.f};
+
+	// Empty until calculate_bounds is called, and then the model can be culled.
+	ClipBounds clip_bounds_;
+
+public:
+	AnimatedModel(Model model, char const* const animation_path, float const scale = 1.f) :
+		model_{std::move(model)},
+		animation_{animation_path, model_.skeleton()},
+		scale_{scale}
+	{}
+
+	// Plays the source skeleton's clip, retargeted while it is sampled. See Animation::retarget_from.
+	void retarget_animation_from(Skeleton const& source_skeleton) {
+		animation_.retarget_from(source_skeleton);
+	}
+
+	// Precomputes the bone matrices of the clip, so that updating the animation only blends baked frames.
+	void bake_animation(float const frames_per_second, PalettePrecision const precision = PalettePrecision::full) {
+		baked_palette_ = std::make_unique<BakedPalette>(animation_, frames_per_second, precision);
+	}
+
+	// Precomputes the bounds of the skin through the clip. Call again if the bind pose or clip changes.
+	void calculate_bounds() {
+		clip_bounds_ = ClipBounds{animation_, model_.skin_radius()};
+	}
+
+	// Whether any of the skin may be inside the frustum. Always true before calculate_bounds has been called.
+	bool is_visible(Frustum const& frustum)
+	{
+		if (clip_bounds_.is_empty()) {
+			return true;
+		}
+		// AnimationLod can show poses up to eight frames ahead of the animation time.
+		constexpr auto lookahead = Seconds{0.15f};
+		auto const time = animation_.current_time();
+		return frustum.intersects(clip_bounds_.bounds(time, time + lookahead).transformed(model_transform_));
+	}
+
+	Model const& model() const {
+		return model_;
+	}
+	Model& model() {
+		return model_;
+	}
+	Animation const& animation() const {
+		return animation_;
+	}
+
+	glm::vec3 position() const {
+		return position_;
+	}
+	glm::mat4 const& model_transform() const {
+		return model_transform_;
+	}
+
+	void position_scale(glm::vec3 const pos, float const scale) {
+		position_ = pos;
+		model_transform_ = glm::translate(glm::mat4{1.f}, pos) * glm::scale(glm::mat4{1.f}, glm::vec3{scale}*scale_);
+	}
+
+	void restart_animation() {
+		animation_.restart();
+	}
+
+	std::size_t bone_count() const {
+		return model_.skeleton().bone_count();
+	}
+
+	Seconds animation_time() {
+		return animation_.current_time();
+	}
+
+	// Writes the bone matrices at the time to arrays indexed by bone id, leaving the skeleton as it is.
+	void evaluate_animation(Seconds const time, util::Span<glm::mat4> const global_transforms, util::Span<glm::mat4> const animation_transforms) const
+	{
+		if (baked_palette_) {
+			baked_palette_->sample(time, animation_transforms);
+		}
+		else {
+			animation_.evaluate_bone_matrices(time, global_transforms, animation_transforms);
+		}
+	}
+
+	// Sets the bone matrices that the model is drawn with.
+	void set_animation_transforms(util::Span<glm::mat4 const> const animation_transforms)
+	{
+		for (auto& bone : model_.skeleton().bones()) {
+			bone.animation_transform = animation_transforms[bone.id];
+		}
+	}
+
+	void update_animation()
+	{
+		if (baked_palette_) {
+			baked_palette_->sample(animation_.current_time(), model_.skeleton());
+		}
+		else {
+			animation_.update_bone_matrices();
+		}
+	}
+
+	// Limits skinning to the variants with at most this many bone influences, for distant models.
+	void set_max_bone_influence_count(std::size_t const count) {
+		max_bone_influence_count_ = count;
+	}
+	std::size_t max_bone_influence_count() const {
+		return max_bone_influence_count_;
+	}
+
+	// The bone matrices to set bone_matrices in the shaders to, in the frame's scratch memory.
+	util::Span<glm::mat4> gather_bone_matrices(util::Arena& frame_arena) const
+	{
+		auto const& bones = model_.skeleton().bones();
+		auto const matrices = frame_arena.allocate_array<glm::mat4>(std::min(bones.size(), max_shader_bone_count), util::cache_line_size);
+		for (auto const i : util::indices(matrices)) {
+			matrices[i] = bones[i].animation_transform;
+		}
+		return matrices;
+	}
+};
+
+} // namespace testing
+
+#endif
@@ -1,18 +1,30 @@
 #ifndef ANIMATION_RETARGETING_TESTING_ANIMATION_HPP
 #define ANIMATION_RETARGETING_TESTING_ANIMATION_HPP
 
-#include "fbx.hpp"
+#include "compressed_clip.hpp"
+#include "cooked.hpp"
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+#	include "fbx.hpp"
+#endif
+#include "gltf.hpp"
+#include "simd.hpp"
 #include "skeleton.hpp"
 
 #include <fmt/format.h>
 #include <glm/ext.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace testing {
 
 class Animation {
 private:
+#ifdef ANIMATION_RETARGETING_FBX_SDK
 	static fbx::Unique<FbxIOSettings> create_import_settings_(FbxManager* const manager)
 	{
 		auto settings = fbx::create<FbxIOSettings>(manager, IOSROOT);
@@ -28,34 +40,70 @@ private:
 		settings->SetBoolProp(IMP_FBX_VERTEXCOLOR, false);
 		return settings;
 	}
+#endif
 
 	using Clock_ = std::chrono::steady_clock;
 
 	Skeleton& skeleton_;
 	std::chrono::time_point<Clock_> start_time_{Clock_::now()};
 
-	void load_animation_(FbxNode* const node, FbxAnimLayer* const animation_layer)
+	// Set when the animation is retargeted live from another skeleton's tracks instead of the skeleton's own.
+	Skeleton const* source_skeleton_{};
+	std::vector<animation_retargeting::RetargetBone> retarget_bones_;
+	// The bones whose source bones are static, or that have none, and their local transforms.
+	Skeleton::BoneMask live_static_bones_;
+	std::vector<glm::mat4> live_static_local_transforms_;
+
+	// Set when the animation samples a compressed clip instead of tracks.
+	CompressedClip const* compressed_clip_{};
+
+	// The bones with pivots, whose local transforms can't be composed in batches, see calculate_local_transforms_.
+	Skeleton::BoneMask pivot_bones_;
+
+	// Scratch memory for evaluating whole poses. Poses are evaluated on several threads at once, so each thread has its own,
+	// which grows to the largest skeleton evaluated on it and is kept, so that evaluating poses stops allocating.
+	struct PoseBatch_ {
+		simd::ComponentArrays scales;
+		simd::ComponentArrays rotations;
+		simd::ComponentArrays translations;
+		// For update_bone_matrices, which evaluates the pose before writing it to the skeleton.
+		std::vector<glm::mat4> global_transforms;
+		std::vector<glm::mat4> animation_transforms;
+	};
+	static PoseBatch_& pose_batch_(std::size_t const bone_count)
+	{
+		thread_local auto batch = PoseBatch_{};
+		if (batch.global_transforms.size() < bone_count) {
+			batch.scales = simd::ComponentArrays{bone_count};
+			batch.rotations = simd::ComponentArrays{bone_count};
+			batch.translations = simd::ComponentArrays{bone_count};
+			batch.global_transforms.resize(bone_count);
+			batch.animation_transforms.resize(bone_count);
+		}
+		return batch;
+	}
+
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+	// Calls visit(bone_name, bone_node, animation_layer) for every skeleton node in the subtree.
+	template<typename Visitor_>
+	static void visit_animated_bones_(FbxNode* const node, FbxAnimLayer* const animation_layer, Visitor_&& visit)
 	{
 		if (auto const* const attribute = node->GetNodeAttribute())
 		{
 			if (attribute->GetAttributeType() == FbxNodeAttribute::eSkeleton)
 			{
-				if (auto* const bone = skeleton_.bone_by_name(util::trimmed_bone_name(node).c_str())) 
-				{
-					bone->scale_track = AnimationTrack<glm::vec3>{animation_layer, node->LclScaling};
-					bone->rotation_track = AnimationTrack<glm::quat>{animation_layer, node->LclRotation};
-					bone->translation_track = AnimationTrack<glm::vec3>{animation_layer, node->LclTranslation};
-				}
+				visit(util::trimmed_bone_name(node), node, animation_layer);
 			}
 		}
 		
 		for (auto const i : util::indices(node->GetChildCount()))
 		{
-			load_animation_(node->GetChild(i), animation_layer);
+			visit_animated_bones_(node->GetChild(i), animation_layer, visit);
 		}	
 	}
 
-	void load_animations_(FbxScene const* const scene, FbxNode* const root_node) 
+	template<typename Visitor_>
+	static void visit_animated_bones_(FbxScene const* const scene, FbxNode* const root_node, Visitor_&& visit) 
 	{
 		auto const stack_count = scene->GetSrcObjectCount(FbxCriteria::ObjectType(FbxAnimStack::ClassId));
 		for (auto const stack_index : util::indices(stack_count))
@@ -66,19 +114,187 @@ private:
 			for (auto const layer_index : util::indices(layer_count))
 			{
 				auto* const animation_layer = static_cast<FbxAnimLayer*>(animation_stack->GetMember(FbxCriteria::ObjectType(FbxAnimLayer::ClassId), layer_index));
-				load_animation_(root_node, animation_layer);
+				visit_animated_bones_(root_node, animation_layer, visit);
 			}
 		}
 	}
+#endif
+
+	void load_cooked_(char const* const cooked_path)
+	{
+		auto const file = cooked::File{cooked_path};
+
+		for (auto const& track : file.tracks())
+		{
+			if (auto* const bone = skeleton_.bone_by_name(file.string(track.bone_name)))
+			{
+				auto const times = file.times(track);
+				switch (track.channel) {
+					case cooked::Channel::scale: 
+						bone->scale_track = AnimationTrack<glm::vec3>{times, file.values<glm::vec3>(track)}; 
+						break;
+					case cooked::Channel::rotation: 
+						bone->rotation_track = AnimationTrack<glm::quat>{times, file.values<glm::quat>(track)}; 
+						break;
+					case cooked::Channel::translation: 
+						bone->translation_track = AnimationTrack<glm::vec3>{times, file.values<glm::vec3>(track)}; 
+						break;
+				}
+			}
+		}
+	}
+
+	static void set_track_(Bone& bone, cooked::Channel const channel, AnimationTrack<glm::vec3> track) {
+		(channel == cooked::Channel::scale ? bone.scale_track : bone.translation_track) = std::move(track);
+	}
+	static void set_track_(Bone& bone, cooked::Channel, AnimationTrack<glm::quat> track) {
+		bone.rotation_track = std::move(track);
+	}
+
+	// The local transform of a bone that doesn't move, otherwise nullptr.
+	glm::mat4 const* fixed_local_transform_(Bone const& bone) const
+	{
+		if (compressed_clip_) {
+			return nullptr;
+		}
+		// Bones that never move don't need their tracks sampled.
+		if (!source_skeleton_ && skeleton_.is_static(bone.id)) {
+			return &skeleton_.static_local_transform(bone.id);
+		}
+		if (source_skeleton_ && live_static_bones_.test(bone.id)) {
+			return &live_static_local_transforms_[bone.id];
+		}
+		return nullptr;
+	}
+
+	void sample_local_components_(Bone const& bone, Seconds const time, glm::vec3& local_scale, glm::quat& local_rotation, glm::vec3& local_translation) const
+	{
+		local_scale = bone.local_bind_scale;
+		local_rotation = bone.local_bind_rotation;
+		local_translation = bone.local_bind_translation;
+
+		if (compressed_clip_) {
+			auto const local = compressed_clip_->sample(bone.id, time);
+			local_scale = local.scale;
+			local_rotation = local.rotation;
+			local_translation = local.translation;
+		}
+		else if (!source_skeleton_) {
+			local_scale = bone.scale_track.evaluate(time, local_scale);
+			local_rotation = bone.rotation_track.evaluate(time, local_rotation);
+			local_translation = bone.translation_track.evaluate(time, local_translation);
+		}
+		else if (auto const& retarget_bone = retarget_bones_[bone.id]; retarget_bone.source_index != animation_retargeting::RetargetBone::no_source) 
+		{
+			// The same as the baked values that retarget() produces, see apply_retargeting.
+			auto const& source_bone = *source_skeleton_->bone_by_id(static_cast<Bone::Id>(retarget_bone.source_index));
+			local_scale = source_bone.scale_track.evaluate(time, local_scale);
+			local_rotation = source_bone.rotation_track.evaluate(time, local_rotation);
+			if (!source_bone.translation_track.is_empty()) {
+				local_translation = retarget_bone.retarget_translation(source_bone.translation_track.evaluate(time));
+			}
+		}
+	}
+
+	glm::mat4 calculate_local_transform_(Bone const& bone, Seconds const time) const
+	{
+		if (auto const* const fixed = fixed_local_transform_(bone)) {
+			return *fixed;
+		}
+		auto local_scale = glm::vec3{};
+		auto local_rotation = glm::quat{};
+		auto local_translation = glm::vec3{};
+		sample_local_components_(bone, time, local_scale, local_rotation, local_translation);
+		return bone.calculate_local_transform(local_scale, local_rotation, local_translation);
+	}
+
+	/*
+		Writes the local transforms of every bone to an array indexed by bone id. The tracks are sampled bone by bone, since each
+		track finds its own keys, and the sampled components are composed into matrices in batches with simd::compose.
+		Bones that don't move or that have pivots are then given their own. The batch's component arrays are overwritten.
+	*/
+	void calculate_local_transforms_(Seconds const time, PoseBatch_& batch, glm::mat4* const local_transforms) const
+	{
+		auto local_scale = glm::vec3{};
+		auto local_rotation = glm::quat{};
+		auto local_translation = glm::vec3{};
+		for (auto const& bone : skeleton_.bones()) 
+		{
+			if (fixed_local_transform_(bone)) {
+				continue;
+			}
+			sample_local_components_(bone, time, local_scale, local_rotation, local_translation);
+			batch.scales.set(bone.id, local_scale);
+			batch.rotations.set(bone.id, local_rotation);
+			batch.translations.set(bone.id, local_translation);
+		}
+		simd::compose(std::as_const(batch.scales).vec3(), std::as_const(batch.rotations).quat(), std::as_const(batch.translations).vec3(), 
+			skeleton_.bone_count(), local_transforms);
+
+		for (auto const& bone : skeleton_.bones())
+		{
+			if (auto const* const fixed = fixed_local_transform_(bone)) {
+				local_transforms[bone.id] = *fixed;
+			}
+			else if (pivot_bones_.test(bone.id)) {
+				local_transforms[bone.id] = bone.calculate_local_transform(batch.scales.vec3(bone.id), batch.rotations.quat(bone.id), batch.translations.vec3(bone.id));
+			}
+		}
+	}
+
+	void load_(char const* const fbx_path)
+	{
+		if (cooked::is_cooked_path(fbx_path)) {
+			load_cooked_(fbx_path);
+			return;
+		}
+
+		if (gltf::is_gltf_path(fbx_path)) {
+			for_each_gltf_track(fbx_path, [this](std::string const& name, cooked::Channel const channel, auto track) {
+				if (auto* const bone = skeleton_.bone_by_name(name.c_str())) {
+					set_track_(*bone, channel, std::move(track));
+				}
+			});
+			return;
+		}
+
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+		for_each_animated_bone(fbx_path, [this](std::string const& name, FbxNode* const node, FbxAnimLayer* const animation_layer, fbx::CoordinateConversion const& conversion) {
+			if (auto* const bone = skeleton_.bone_by_name(name.c_str())) 
+			{
+				bone->scale_track = read_scale_track(node, animation_layer, conversion);
+				bone->rotation_track = read_rotation_track(node, animation_layer, conversion);
+				bone->translation_track = read_translation_track(node, animation_layer, conversion);
+			}
+		});
+#else
+		throw std::runtime_error{std::string{"FBX files can't be loaded without the FBX SDK: "} + fbx_path};
+#endif
+	}
 
 public:
+	// The path can point to an FBX, glTF or cooked file. Tracks that never change are collapsed, see Skeleton::collapse_constant_tracks.
 	Animation(char const* const fbx_path, Skeleton& skeleton) :
 		skeleton_{skeleton}
 	{
-		if (!fbx_path || *fbx_path == char{}) {
-			return;
+		if (fbx_path && *fbx_path != char{}) {
+			load_(fbx_path);
+			skeleton_.collapse_constant_tracks();
 		}
-		
+		for (auto const& bone : skeleton_.bones()) {
+			pivot_bones_.set(bone.id, !bone.has_identity_pivots());
+		}
+	}
+
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+	/*
+		Imports an FBX file and calls visit(bone_name, bone_node, animation_layer, conversion) for every skeleton node in every 
+		animation layer. With SceneConversion::bulk the scene is left in its own axis system and the keys read from it have to be 
+		converted with the conversion, which the read_*_track functions do.
+	*/
+	template<typename Visitor_>
+	static void for_each_animated_bone(char const* const fbx_path, Visitor_&& visit, fbx::SceneConversion const scene_conversion = fbx::SceneConversion::bulk)
+	{
 		auto manager = fbx::create<FbxManager>();
 		
 		auto settings = create_import_settings_(manager.get());
@@ -86,7 +302,13 @@ public:
 		
 		auto scene = fbx::import_scene(manager.get(), fbx_path);
 
-		FbxAxisSystem::OpenGL.DeepConvertScene(scene.get());
+		auto conversion = fbx::CoordinateConversion{};
+		if (scene_conversion == fbx::SceneConversion::sdk) {
+			FbxAxisSystem::OpenGL.DeepConvertScene(scene.get());
+		}
+		else {
+			conversion = fbx::CoordinateConversion::to_opengl(scene.get());
+		}
 
 		auto* const root_node = scene->GetRootNode();
 
@@ -94,38 +316,254 @@ public:
 			throw std::runtime_error{"An FBX scene did not contain a root node."};
 		}
 
-		load_animations_(scene.get(), root_node);		
+		visit_animated_bones_(scene.get(), root_node, [&](std::string const& name, FbxNode* const node, FbxAnimLayer* const animation_layer) {
+			visit(name, node, animation_layer, conversion);
+		});
+	}
+#endif
+
+	// Calls visit(bone_name, channel, track) for every scale, rotation and translation channel in the first animation of a glTF file.
+	template<typename Visitor_>
+	static void for_each_gltf_track(char const* const gltf_path, Visitor_&& visit)
+	{
+		auto const document = gltf::Document{gltf_path};
+		auto const& animation = document.root()["animations"][0];
+
+		auto time_storage = std::vector<float>{};
+		auto vector_storage = std::vector<glm::vec3>{};
+		auto rotation_storage = std::vector<glm::quat>{};
+
+		for (auto const& channel : animation["channels"].elements())
+		{
+			auto const& target = channel["target"];
+			if (!target.contains("node")) {
+				continue;
+			}
+
+			auto const name = document.node_name(target["node"].as_index());
+			auto const& sampler = animation["samplers"][channel["sampler"].as_index()];
+			auto const& path = target["path"].as_string();
+
+			if (path == "rotation") {
+				auto const keys = document.read_sampler(sampler, time_storage, rotation_storage);
+				visit(name, cooked::Channel::rotation, AnimationTrack<glm::quat>{keys.times, keys.values});
+			}
+			else if (path == "scale" || path == "translation") {
+				auto const keys = document.read_sampler(sampler, time_storage, vector_storage);
+				visit(name, path == "scale" ? cooked::Channel::scale : cooked::Channel::translation, AnimationTrack<glm::vec3>{keys.times, keys.values});
+			}
+		}
+	}
+
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+	static AnimationTrack<glm::vec3> read_scale_track(FbxNode* const node, FbxAnimLayer* const animation_layer, fbx::CoordinateConversion const& conversion)
+	{
+		auto keys = fbx::read_property_keys(animation_layer, node->LclScaling);
+		conversion.convert_scales(keys);
+		return AnimationTrack<glm::vec3>{std::move(keys)};
+	}
+	static AnimationTrack<glm::quat> read_rotation_track(FbxNode* const node, FbxAnimLayer* const animation_layer, fbx::CoordinateConversion const& conversion)
+	{
+		// Euler angles don't convert component-wise, so the rotations are converted after they have been made into quaternions.
+		auto track = AnimationTrack<glm::quat>{fbx::read_property_keys(animation_layer, node->LclRotation)};
+		if (!conversion.is_identity()) {
+			track.transform_values([&](glm::quat const rotation) { return conversion.convert_rotation(rotation); });
+		}
+		return track;
+	}
+	static AnimationTrack<glm::vec3> read_translation_track(FbxNode* const node, FbxAnimLayer* const animation_layer, fbx::CoordinateConversion const& conversion)
+	{
+		auto keys = fbx::read_property_keys(animation_layer, node->LclTranslation);
+		conversion.convert_points(keys);
+		return AnimationTrack<glm::vec3>{std::move(keys)};
+	}
+#endif
+
+	// Imports the clip in an FBX or glTF file and adds its tracks to a cooked file, keyed by bone name.
+	static void cook(char const* const fbx_path, cooked::Writer& writer)
+	{
+		if (gltf::is_gltf_path(fbx_path)) {
+			for_each_gltf_track(fbx_path, [&](std::string const& name, cooked::Channel const channel, auto const& track) {
+				if (!util::is_end_bone(name) && !track.is_empty()) {
+					writer.add_track(name.c_str(), channel, track.extract_times(), track.extract_values());
+				}
+			});
+			return;
+		}
+
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+		for_each_animated_bone(fbx_path, [&](std::string const& name, FbxNode* const node, FbxAnimLayer* const animation_layer, fbx::CoordinateConversion const& conversion) {
+			if (util::is_end_bone(name)) {
+				return;
+			}
+			
+			auto const add_track = [&](cooked::Channel const channel, auto const& track) {
+				if (!track.is_empty()) {
+					writer.add_track(name.c_str(), channel, track.extract_times(), track.extract_values());
+				}
+			};
+			add_track(cooked::Channel::scale, read_scale_track(node, animation_layer, conversion));
+			add_track(cooked::Channel::rotation, read_rotation_track(node, animation_layer, conversion));
+			add_track(cooked::Channel::translation, read_translation_track(node, animation_layer, conversion));
+		});
+#else
+		throw std::runtime_error{std::string{"FBX files can't be cooked without the FBX SDK: "} + fbx_path};
+#endif
+	}
+
+	/*
+		Makes the animation sample the source skeleton's tracks and retarget them as they are sampled, instead of using
+		a retargeted copy of the clip. Only the per-bone translation corrections are kept, so the memory used by a clip
+		doesn't grow with the number of skeletons playing it. Sets the skeleton's bind pose to the retargeted one and drops its own tracks.
+	*/
+	void retarget_from(Skeleton const& source_skeleton)
+	{
+		auto retargeting = animation_retargeting::create_retargeting(source_skeleton.extract_pose(), skeleton_.extract_pose());
+		skeleton_.set_bind_pose(retargeting.bind_pose);
+		skeleton_.clear_animation();
+
+		source_skeleton_ = &source_skeleton;
+		retarget_bones_ = std::move(retargeting.bones);
+
+		live_static_bones_.reset();
+		live_static_local_transforms_.resize(skeleton_.bone_count());
+		for (auto const& bone : skeleton_.bones())
+		{
+			auto const source_index = retarget_bones_[bone.id].source_index;
+			if (source_index == animation_retargeting::RetargetBone::no_source || source_skeleton.is_static(static_cast<Bone::Id>(source_index))) {
+				live_static_local_transforms_[bone.id] = calculate_local_transform_(bone, Seconds{});
+				live_static_bones_.set(bone.id);
+			}
+		}
+	}
+
+	// Makes the animation sample the clip, which has to have been compressed from this skeleton's bones or another skeleton like it.
+	void play_compressed(CompressedClip const& clip)
+	{
+		if (clip.bone_count() != skeleton_.bone_count()) {
+			throw std::runtime_error{"A compressed clip has a different number of bones than the skeleton playing it."};
+		}
+		compressed_clip_ = &clip;
 	}
 
 	void restart() {
 		start_time_ = Clock_::now();
 	}
 
-	void update_bone_matrices()
+	Seconds duration() const {
+		if (compressed_clip_) {
+			return compressed_clip_->duration();
+		}
+		return clip_skeleton().animation_duration();
+	}
+
+	Skeleton const& skeleton() const {
+		return skeleton_;
+	}
+	// The skeleton whose tracks are played, which is the source skeleton when retargeting live.
+	Skeleton const& clip_skeleton() const {
+		return source_skeleton_ ? *source_skeleton_ : skeleton_;
+	}
+
+	// The time since the animation was restarted. Restarts it when it has played to the end.
+	Seconds current_time()
 	{
 		auto const time = std::chrono::duration_cast<Seconds>(Clock_::now() - start_time_);
 		// auto const time = Seconds{};
 
 		// Hack, remove later
-		if (time > skeleton_.bones()[0].translation_track.duration()) {
+		if (time > duration()) {
 			restart();
 		}
+		return time;
+	}
+
+	void update_bone_matrices() {
+		update_bone_matrices(current_time());
+	}
+
+	void update_bone_matrices(Seconds const time)
+	{
+		auto& batch = pose_batch_(skeleton_.bone_count());
+		evaluate_bone_matrices(time, {batch.global_transforms.data(), skeleton_.bone_count()}, {batch.animation_transforms.data(), skeleton_.bone_count()});
+
+		for (auto& bone : skeleton_.bones()) {
+			bone.global_transform = batch.global_transforms[bone.id];
+			bone.animation_transform = batch.animation_transforms[bone.id];
+		}
+	}
+
+	/*
+		Like update_bone_matrices, but writes the matrices to arrays indexed by bone id instead of to the skeleton, so it can run concurrently.
+		The local transforms are composed in batches, and the animation transforms are multiplied in one batch with simd::multiply.
+		Only the multiplications by the parents' global transforms go bone by bone, since each one needs its parent's result.
+	*/
+	void evaluate_bone_matrices(Seconds const time, util::Span<glm::mat4> const global_transforms, util::Span<glm::mat4> const animation_transforms) const
+	{
+		auto const bone_count = skeleton_.bone_count();
+		auto& batch = pose_batch_(bone_count);
+		calculate_local_transforms_(time, batch, animation_transforms.data());
+
+		for (auto const& bone : skeleton_.bones())
+		{
+			auto const& local_transform = animation_transforms[bone.id];
+			global_transforms[bone.id] = bone.has_parent() ? global_transforms[bone.parent] * local_transform : local_transform;
+			animation_transforms[bone.id] = bone.inverse_bind_transform;
+		}
+		simd::multiply(global_transforms.data(), animation_transforms.data(), bone_count, animation_transforms.data());
+	}
+	// Evaluates only the listed bones, which have to be listed after their parents, like for a reduced skeleton (see SkeletonLod).
+	// Global transforms are indexed by bone id and animation transforms by the bone's position in the list.
+	void evaluate_bone_matrices(Seconds const time, util::Span<Bone::Id const> const bone_ids, 
+		util::Span<glm::mat4> const global_transforms, util::Span<glm::mat4> const animation_transforms) const
+	{
+		for (auto const i : util::indices(bone_ids))
+		{
+			auto const& bone = *skeleton_.bone_by_id(bone_ids[i]);
+			auto const local_transform = calculate_local_transform_(bone, time);
+
+			global_transforms[bone.id] = bone.has_parent() ? global_transforms[bone.parent] * local_transform : local_transform;
+
+			animation_transforms[i] = global_transforms[bone.id] * bone.inverse_bind_transform;
+		}
+	}
 
-		for (auto& bone : skeleton_.bones())
+	/*
+		Evaluates the global transforms of the listed bones and their ancestors only, for when a character that isn't drawn
+		still needs a few of its bones, like an attachment point or the head. The cost grows with the length of the bones'
+		chains instead of with the size of the skeleton, and nothing is allocated once collected_bones has grown: the ids of 
+		the evaluated bones are collected in chain_ids, which needs room for all of them (at most the skeleton's bone count), 
+		and marked in collected_bones, which is empty again when the function returns. Returns those ids, sorted.
+		Global transforms are indexed by bone id, and only the ones of the returned bones are written.
+	*/
+	util::Span<Bone::Id const> evaluate_global_transforms(Seconds const time, util::Span<Bone::Id const> const bone_ids, 
+		util::Span<Bone::Id> const chain_ids, util::BitSet& collected_bones, util::Span<glm::mat4> const global_transforms) const
+	{
+		auto chain_end = chain_ids.begin();
+		for (auto const id : bone_ids)
 		{
-			auto const local_scale = bone.scale_track.evaluate(time, bone.local_bind_scale);
-			auto const local_rotation = bone.rotation_track.evaluate(time, bone.local_bind_rotation);
-			auto const local_translation = bone.translation_track.evaluate(time, bone.local_bind_translation);
-			// auto const local_scale = bone.local_bind_scale;
-			// auto const local_rotation = bone.local_bind_rotation;
-			// auto const local_translation = bone.local_bind_translation;
-
-			auto const local_transform = bone.calculate_local_transform(local_scale, local_rotation, local_translation);
-			
-			bone.global_transform = bone.parent ? bone.parent->global_transform * local_transform : local_transform;
+			// The walk stops at the first ancestor that has been collected, since its own ancestors have been too.
+			for (auto ancestor = id; ancestor != Bone::no_parent && !collected_bones.test(ancestor); 
+				ancestor = skeleton_.bone_by_id(ancestor)->parent) 
+			{
+				assert(chain_end != chain_ids.end());
+				collected_bones.set(ancestor);
+				*chain_end++ = ancestor;
+			}
+		}
+		std::sort(chain_ids.begin(), chain_end);
+
+		// Parents have lower ids than their children, so going through the ids in order evaluates parents first.
+		auto const chain = util::Span<Bone::Id const>{chain_ids.data(), static_cast<std::size_t>(chain_end - chain_ids.begin())};
+		for (auto const id : chain)
+		{
+			auto const& bone = *skeleton_.bone_by_id(id);
+			auto const local_transform = calculate_local_transform_(bone, time);
 
-			bone.animation_transform = bone.global_transform * bone.inverse_bind_transform;
+			global_transforms[id] = bone.has_parent() ? global_transforms[bone.parent] * local_transform : local_transform;
+			collected_bones.set(id, false);
 		}
+		return chain;
 	}
 };
 
@@ -0,0 +1,206 @@
+#ifndef ANIMATION_RETARGETING_TESTING_ANIMATION_LOD_HPP
+#define ANIMATION_RETARGETING_TESTING_ANIMATION_LOD_HPP
+
+#include "animated_model.hpp"
+#include "arena.hpp"
+
+#include <fmt/format.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <vector>
+
+namespace testing {
+
+/*
+	Updates the animations of distant characters less often, and skins them with fewer bone influences. A character at level n is evaluated every 2^n frames,
+	ahead of time, and the frames in between blend its previous and next bone matrices. Characters at the same level
+	are updated on different frames, so that their updates don't all land on the same frame.
+
+	A governor scales the level distances down while animation takes longer than the budget per frame,
+	and back up when there is time to spare.
+*/
+class AnimationLod {
+public:
+	static constexpr auto level_count = std::size_t{4};
+
+	using Milliseconds = std::chrono::duration<float, std::milli>;
+
+	struct Report {
+		Milliseconds update_time;
+		Milliseconds average_update_time;
+		float distance_scale;
+		std::array<std::size_t, level_count> character_counts;
+	};
+
+private:
+	using Clock_ = std::chrono::steady_clock;
+
+	struct Character_ {
+		AnimatedModel* character;
+		// Spreads the updates of characters at the same level over the frames of their interval.
+		std::size_t stagger;
+		std::size_t level;
+		std::size_t frames_until_update;
+		std::size_t frames_since_update;
+		// The number of frames that the end transforms were evaluated ahead, or zero if they weren't.
+		std::size_t end_frame_count;
+
+		// The matrices at the last update, and the ones evaluated ahead for the next update.
+		util::CacheAlignedVector<glm::mat4> start_transforms;
+		util::CacheAlignedVector<glm::mat4> end_transforms;
+		util::CacheAlignedVector<glm::mat4> blended_transforms;
+		util::CacheAlignedVector<glm::mat4> global_transforms;
+	};
+
+	std::vector<Character_> characters_;
+
+	// The distance from the viewer where each level after the first starts.
+	std::array<float, level_count - 1> level_distances_;
+	Milliseconds budget_;
+	float distance_scale_{1.f};
+
+	Clock_::time_point last_update_time_point_{Clock_::now()};
+	Seconds frame_time_{1.f/60.f};
+	Report report_{};
+
+	static std::size_t interval_(std::size_t const level) {
+		return std::size_t{1} << level;
+	}
+
+	std::size_t choose_level_(float const distance) const
+	{
+		auto level = std::size_t{};
+		while (level < level_distances_.size() && distance > level_distances_[level]*distance_scale_) {
+			++level;
+		}
+		return level;
+	}
+
+	void update_character_(Character_& state)
+	{
+		auto& character = *state.character;
+		auto const bone_count = character.bone_count();
+		auto const interval = interval_(state.level);
+
+		auto const global_transforms = util::Span<glm::mat4>{state.global_transforms.data(), bone_count};
+		auto const end_transforms = util::Span<glm::mat4>{state.end_transforms.data(), bone_count};
+
+		if (state.frames_until_update == 0)
+		{
+			auto const time = character.animation_time();
+			// The end transforms are the current pose if the interval ran to its end, otherwise the level changed midway.
+			if (state.end_frame_count && state.frames_since_update == state.end_frame_count) {
+				state.start_transforms.swap(state.end_transforms);
+			}
+			else {
+				character.evaluate_animation(time, global_transforms, {state.start_transforms.data(), bone_count});
+			}
+
+			state.end_frame_count = interval == 1 ? 0 : interval;
+			if (state.end_frame_count) {
+				character.evaluate_animation(time + frame_time_*static_cast<float>(interval), global_transforms, end_transforms);
+			}
+			state.frames_until_update = interval;
+			state.frames_since_update = 0;
+		}
+
+		if (!state.end_frame_count) {
+			character.set_animation_transforms({state.start_transforms.data(), bone_count});
+		}
+		else {
+			auto const weight = static_cast<float>(state.frames_since_update)/static_cast<float>(state.end_frame_count);
+			for (auto const i : util::indices(bone_count)) {
+				state.blended_transforms[i] = state.start_transforms[i] + (state.end_transforms[i] - state.start_transforms[i])*weight;
+			}
+			character.set_animation_transforms({state.blended_transforms.data(), bone_count});
+		}
+
+		--state.frames_until_update;
+		++state.frames_since_update;
+	}
+
+	void govern_(Milliseconds const update_time)
+	{
+		// Averaged over a few frames so that a single slow frame doesn't change the levels.
+		report_.average_update_time = report_.average_update_time*0.9f + update_time*0.1f;
+
+		if (report_.average_update_time > budget_) {
+			distance_scale_ = std::max(distance_scale_*0.95f, 1.f/64.f);
+		}
+		else if (report_.average_update_time < budget_*0.75f) {
+			distance_scale_ = std::min(distance_scale_*1.02f, 1.f);
+		}
+	}
+
+public:
+	AnimationLod(Milliseconds const budget, std::array<float, level_count - 1> const level_distances) :
+		level_distances_{level_distances},
+		budget_{budget}
+	{}
+
+	void add_character(AnimatedModel& character)
+	{
+		auto const bone_count = character.bone_count();
+		characters_.push_back(Character_{
+			&character,
+			characters_.size(),
+			0,
+			0,
+			0,
+			0,
+			util::CacheAlignedVector<glm::mat4>(bone_count),
+			util::CacheAlignedVector<glm::mat4>(bone_count),
+			util::CacheAlignedVector<glm::mat4>(bone_count),
+			util::CacheAlignedVector<glm::mat4>(bone_count),
+		});
+	}
+
+	// Call once per frame.
+	void update(glm::vec3 const viewer_position)
+	{
+		auto const now = Clock_::now();
+		frame_time_ = frame_time_*0.9f + std::chrono::duration_cast<Seconds>(now - last_update_time_point_)*0.1f;
+		last_update_time_point_ = now;
+
+		report_.character_counts = {};
+
+		for (auto& state : characters_)
+		{
+			auto const level = choose_level_(glm::length(state.character->position() - viewer_position));
+			if (level != state.level) {
+				state.level = level;
+				// Distant characters are also skinned with fewer bone influences.
+				state.character->set_max_bone_influence_count(bone_influence_variants[bone_influence_variants.size() - 1 - std::min(level, bone_influence_variants.size() - 1)]);
+				// Don't wait longer than the new interval, and keep characters that change level together on different frames.
+				state.frames_until_update = std::min(state.frames_until_update, state.stagger % interval_(level));
+			}
+			++report_.character_counts[level];
+
+			update_character_(state);
+		}
+
+		report_.update_time = std::chrono::duration_cast<Milliseconds>(Clock_::now() - now);
+		report_.distance_scale = distance_scale_;
+		govern_(report_.update_time);
+	}
+
+	Report const& report() const {
+		return report_;
+	}
+
+	void print_report() const
+	{
+		fmt::print("Animation took {:.3f} ms, {:.3f} ms on average with a budget of {:.3f} ms. LOD distances are scaled by {:.3f}.\n",
+			report_.update_time.count(), report_.average_update_time.count(), budget_.count(), report_.distance_scale);
+		for (auto const level : util::indices(level_count)) {
+			fmt::print("  Every {} frames: {} characters\n", interval_(level), report_.character_counts[level]);
+		}
+	}
+};
+
+} // namespace testing
+
+#endif
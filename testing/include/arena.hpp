@@ -0,0 +1,203 @@
+#ifndef ANIMATION_RETARGETING_TESTING_ARENA_HPP
+#define ANIMATION_RETARGETING_TESTING_ARENA_HPP
+
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace testing {
+
+namespace util {
+
+// Buffers that are written every frame start on a cache line of their own, so that no two of them share one.
+constexpr auto cache_line_size = std::size_t{64};
+
+/*
+	Hands out memory from large blocks and frees all of it at once in reset, like the temporaries of an import or the scratch
+	memory of a frame. Reset keeps the memory, in one block big enough for everything that was allocated since the last reset,
+	so a loop that allocates about the same every iteration stops allocating from the heap after its first iteration.
+	Nothing allocated is destroyed, so only trivially destructible objects should be constructed in it directly.
+*/
+class Arena {
+private:
+	struct Block_ {
+		std::unique_ptr<unsigned char[]> bytes;
+		std::size_t size;
+	};
+
+	std::size_t block_size_;
+	std::vector<Block_> blocks_;
+	// The bytes used in the last block.
+	std::size_t used_{};
+
+	void add_block_(std::size_t const min_size)
+	{
+		auto const size = std::max(block_size_, min_size);
+		blocks_.push_back(Block_{std::make_unique<unsigned char[]>(size), size});
+		used_ = 0;
+	}
+
+public:
+	explicit Arena(std::size_t const block_size = std::size_t{1} << 16) :
+		block_size_{block_size}
+	{}
+
+	// The alignment has to be a power of two.
+	void* allocate(std::size_t const size, std::size_t const alignment)
+	{
+		assert(alignment && !(alignment & (alignment - 1)));
+
+		if (!blocks_.empty())
+		{
+			auto const& block = blocks_.back();
+			auto const address = reinterpret_cast<std::uintptr_t>(block.bytes.get());
+			auto const start = (address + used_ + alignment - 1) & ~(alignment - 1);
+			if (start + size <= address + block.size) {
+				used_ = start + size - address;
+				return reinterpret_cast<void*>(start);
+			}
+		}
+		// Also big enough for the worst alignment of the block's start.
+		add_block_(size + alignment);
+		return allocate(size, alignment);
+	}
+
+	// Value-initialized, and aligned to at least the type's alignment.
+	template<typename T_>
+	Span<T_> allocate_array(std::size_t const count, std::size_t const alignment = alignof(T_))
+	{
+		static_assert(std::is_trivially_destructible<T_>::value, "Arenas don't destroy what they hold.");
+
+		auto* const data = static_cast<T_*>(allocate(count*sizeof(T_), std::max(alignment, alignof(T_))));
+		for (auto i = std::size_t{}; i < count; ++i) {
+			new (data + i) T_{};
+		}
+		return Span<T_>{data, count};
+	}
+
+	// Frees everything allocated, keeping the memory for the next allocations.
+	void reset()
+	{
+		if (blocks_.size() > 1)
+		{
+			auto total_size = std::size_t{};
+			for (auto const& block : blocks_) {
+				total_size += block.size;
+			}
+			blocks_.clear();
+			add_block_(total_size);
+		}
+		used_ = 0;
+	}
+
+	// The memory the arena holds, used or not.
+	std::size_t byte_size() const
+	{
+		auto size = std::size_t{};
+		for (auto const& block : blocks_) {
+			size += block.size;
+		}
+		return size;
+	}
+};
+
+/*
+	Lets standard containers allocate from an arena, where freeing does nothing until the arena is reset.
+	A default constructed allocator has no arena and uses the heap, so containers with it work like any other.
+*/
+template<typename T_>
+class ArenaAllocator {
+private:
+	template<typename>
+	friend class ArenaAllocator;
+
+	Arena* arena_{};
+
+public:
+	using value_type = T_;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ArenaAllocator() = default;
+	explicit ArenaAllocator(Arena* const arena) :
+		arena_{arena}
+	{}
+	template<typename U_>
+	ArenaAllocator(ArenaAllocator<U_> const& other) :
+		arena_{other.arena_}
+	{}
+
+	T_* allocate(std::size_t const count)
+	{
+		if (arena_) {
+			return static_cast<T_*>(arena_->allocate(count*sizeof(T_), alignof(T_)));
+		}
+		return std::allocator<T_>{}.allocate(count);
+	}
+	void deallocate(T_* const data, std::size_t const count)
+	{
+		if (!arena_) {
+			std::allocator<T_>{}.deallocate(data, count);
+		}
+	}
+
+	template<typename U_>
+	bool operator==(ArenaAllocator<U_> const& other) const {
+		return arena_ == other.arena_;
+	}
+	template<typename U_>
+	bool operator!=(ArenaAllocator<U_> const& other) const {
+		return arena_ != other.arena_;
+	}
+};
+
+/*
+	Starts every array on a cache line. Allocates through the plain operator new, with the address of the allocation
+	stored in front of the aligned array.
+*/
+template<typename T_>
+class CacheAlignedAllocator {
+public:
+	using value_type = T_;
+
+	CacheAlignedAllocator() = default;
+	template<typename U_>
+	CacheAlignedAllocator(CacheAlignedAllocator<U_> const&) {}
+
+	T_* allocate(std::size_t const count)
+	{
+		auto* const allocation = static_cast<unsigned char*>(::operator new(count*sizeof(T_) + cache_line_size + sizeof(void*)));
+		auto const address = reinterpret_cast<std::uintptr_t>(allocation + sizeof(void*));
+		auto* const data = reinterpret_cast<unsigned char*>((address + cache_line_size - 1) & ~(cache_line_size - 1));
+		reinterpret_cast<void**>(data)[-1] = allocation;
+		return reinterpret_cast<T_*>(data);
+	}
+	void deallocate(T_* const data, std::size_t) {
+		::operator delete(reinterpret_cast<void**>(data)[-1]);
+	}
+
+	template<typename U_>
+	bool operator==(CacheAlignedAllocator<U_> const&) const {
+		return true;
+	}
+	template<typename U_>
+	bool operator!=(CacheAlignedAllocator<U_> const&) const {
+		return false;
+	}
+};
+
+template<typename T_>
+using CacheAlignedVector = std::vector<T_, CacheAlignedAllocator<T_>>;
+
+} // namespace util
+
+} // namespace testing
+
+#endif
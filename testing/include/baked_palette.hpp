@@ -0,0 +1,131 @@
+#ifndef ANIMATION_RETARGETING_TESTING_BAKED_PALETTE_HPP
+#define ANIMATION_RETARGETING_TESTING_BAKED_PALETTE_HPP
+
+#include "animation.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace testing {
+
+enum class PalettePrecision { full, half };
+
+/*
+	A clip's skinning palettes computed ahead of time at a fixed rate, for characters that only ever play that clip.
+	Playback blends two baked frames instead of sampling tracks and walking the hierarchy.
+	The matrices are affine, so only their top three rows are stored, optionally as half floats.
+*/
+class BakedPalette {
+private:
+	std::size_t bone_count_;
+	float frames_per_second_;
+	std::size_t frame_count_;
+	PalettePrecision precision_;
+
+	// Three rows per matrix, indexed by (frame_index*bone_count + bone_index)*3 + row. Only one of them is used, depending on the precision.
+	std::vector<glm::vec4> rows_;
+	std::vector<std::uint64_t> half_rows_;
+
+	void add_matrix_(glm::mat4 const& matrix)
+	{
+		for (auto const row : {0, 1, 2})
+		{
+			auto const values = glm::vec4{matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]};
+			if (precision_ == PalettePrecision::half) {
+				half_rows_.push_back(glm::packHalf4x16(values));
+			}
+			else {
+				rows_.push_back(values);
+			}
+		}
+	}
+
+	glm::vec4 row_(std::size_t const index) const {
+		return precision_ == PalettePrecision::half ? glm::unpackHalf4x16(half_rows_[index]) : rows_[index];
+	}
+
+	// Calls output(bone_index, matrix) for every bone.
+	template<typename Output_>
+	void sample_(Seconds const time, bool const should_blend, Output_ const& output) const
+	{
+		auto const position = std::clamp(time.count()*frames_per_second_, 0.f, static_cast<float>(frame_count_ - 1));
+		auto const frame = should_blend ? static_cast<std::size_t>(position) : static_cast<std::size_t>(position + 0.5f);
+		auto const next_frame = std::min(frame + 1, frame_count_ - 1);
+		auto const weight = should_blend ? position - static_cast<float>(frame) : 0.f;
+
+		for (auto bone = std::size_t{}; bone < bone_count_; ++bone)
+		{
+			auto rows = std::array<glm::vec4, 3>{};
+			for (auto const row : {0u, 1u, 2u})
+			{
+				rows[row] = row_((frame*bone_count_ + bone)*3 + row);
+				if (weight > 0.f) {
+					rows[row] += (row_((next_frame*bone_count_ + bone)*3 + row) - rows[row])*weight;
+				}
+			}
+			output(bone, glm::mat4{
+				glm::vec4{rows[0].x, rows[1].x, rows[2].x, 0.f},
+				glm::vec4{rows[0].y, rows[1].y, rows[2].y, 0.f},
+				glm::vec4{rows[0].z, rows[1].z, rows[2].z, 0.f},
+				glm::vec4{rows[0].w, rows[1].w, rows[2].w, 1.f},
+			});
+		}
+	}
+
+public:
+	// Samples the whole animation, which leaves its skeleton in the last frame's pose.
+	BakedPalette(Animation& animation, float const frames_per_second, PalettePrecision const precision = PalettePrecision::full) :
+		bone_count_{animation.skeleton().bone_count()},
+		frames_per_second_{frames_per_second},
+		frame_count_{static_cast<std::size_t>(std::ceil(animation.duration().count()*frames_per_second)) + 1},
+		precision_{precision}
+	{
+		if (precision == PalettePrecision::half) {
+			half_rows_.reserve(frame_count_*bone_count_*3);
+		}
+		else {
+			rows_.reserve(frame_count_*bone_count_*3);
+		}
+
+		for (auto frame = std::size_t{}; frame < frame_count_; ++frame)
+		{
+			animation.update_bone_matrices(std::min(Seconds{static_cast<float>(frame)/frames_per_second}, animation.duration()));
+			for (auto const& bone : animation.skeleton().bones()) {
+				add_matrix_(bone.animation_transform);
+			}
+		}
+	}
+
+	std::size_t frame_count() const {
+		return frame_count_;
+	}
+	Seconds duration() const {
+		return Seconds{static_cast<float>(frame_count_ - 1)/frames_per_second_};
+	}
+	std::size_t byte_size() const {
+		return rows_.size()*sizeof(rows_[0]) + half_rows_.size()*sizeof(half_rows_[0]);
+	}
+
+	// Blends the two baked frames around the time. The palette has a matrix per bone.
+	void sample(Seconds const time, util::Span<glm::mat4> const palette) const {
+		sample_(time, true, [&](std::size_t const bone, glm::mat4 const& matrix) { palette[bone] = matrix; });
+	}
+	// Copies the baked frame closest to the time.
+	void sample_nearest(Seconds const time, util::Span<glm::mat4> const palette) const {
+		sample_(time, false, [&](std::size_t const bone, glm::mat4 const& matrix) { palette[bone] = matrix; });
+	}
+	// Sets the bones' animation transforms. Their global transforms are left as they were.
+	void sample(Seconds const time, Skeleton& skeleton) const {
+		sample_(time, true, [&](std::size_t const bone, glm::mat4 const& matrix) { skeleton.bones()[bone].animation_transform = matrix; });
+	}
+};
+
+} // namespace testing
+
+#endif
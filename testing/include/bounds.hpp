@@ -0,0 +1,175 @@
+#ifndef ANIMATION_RETARGETING_TESTING_BOUNDS_HPP
+#define ANIMATION_RETARGETING_TESTING_BOUNDS_HPP
+
+#include "animation.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace testing {
+
+struct Aabb {
+	glm::vec3 min{std::numeric_limits<float>::max()};
+	glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+	bool is_empty() const {
+		return min.x > max.x;
+	}
+
+	void add(glm::vec3 const point) {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+	void add(Aabb const& other) {
+		if (!other.is_empty()) {
+			add(other.min);
+			add(other.max);
+		}
+	}
+
+	Aabb inflated(float const distance) const {
+		return is_empty() ? *this : Aabb{min - glm::vec3{distance}, max + glm::vec3{distance}};
+	}
+
+	glm::vec3 corner(int const index) const {
+		return {index & 1 ? max.x : min.x, index & 2 ? max.y : min.y, index & 4 ? max.z : min.z};
+	}
+
+	// The bounds of the transformed box.
+	Aabb transformed(glm::mat4 const& transform) const
+	{
+		auto result = Aabb{};
+		if (!is_empty()) {
+			for (auto const i : {0, 1, 2, 3, 4, 5, 6, 7}) {
+				result.add(glm::vec3{transform*glm::vec4{corner(i), 1.f}});
+			}
+		}
+		return result;
+	}
+};
+
+struct Frustum {
+	// Plane normals point inwards, so a point is inside when dot(plane, (point, 1)) >= 0 for every plane.
+	std::array<glm::vec4, 6> planes;
+
+	// The frustum of a projection * view matrix, in world space.
+	static Frustum from_matrix(glm::mat4 const& matrix)
+	{
+		auto const row = [&](int const index) {
+			return glm::vec4{matrix[0][index], matrix[1][index], matrix[2][index], matrix[3][index]};
+		};
+		return Frustum{{
+			row(3) + row(0), row(3) - row(0),
+			row(3) + row(1), row(3) - row(1),
+			row(3) + row(2), row(3) - row(2),
+		}};
+	}
+
+	// Conservative: boxes near the corners of the frustum may count as intersecting when they don't.
+	bool intersects(Aabb const& box) const
+	{
+		for (auto const& plane : planes)
+		{
+			// The corner furthest along the plane's normal.
+			auto const corner = glm::vec3{
+				plane.x >= 0.f ? box.max.x : box.min.x,
+				plane.y >= 0.f ? box.max.y : box.min.y,
+				plane.z >= 0.f ? box.max.z : box.min.z,
+			};
+			if (glm::dot(glm::vec3{plane}, corner) + plane.w < 0.f) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/*
+	The furthest that skin can be from the bones that move it, given the bounds of each bone's vertices.
+	Every bone moves its vertices rigidly, so in any pose a skinned vertex is within this distance of some blend of the
+	bone positions, and bounds around the bone positions inflated by it contain the skin. Scaled bones can break this.
+*/
+inline float calculate_skin_radius(Skeleton const& skeleton, util::Span<Aabb const> const bone_vertex_bounds)
+{
+	auto radius = 0.f;
+	for (auto const& bone : skeleton.bones())
+	{
+		auto const& bounds = bone_vertex_bounds[bone.id];
+		if (bounds.is_empty()) {
+			continue;
+		}
+		auto const bone_position = glm::vec3{bone.bind_transform[3]};
+		for (auto const i : {0, 1, 2, 3, 4, 5, 6, 7}) {
+			radius = std::max(radius, glm::length(bounds.corner(i) - bone_position));
+		}
+	}
+	return radius;
+}
+
+/*
+	Bounds of a clip's posed skin in model space for each segment of the clip, so that animated characters can be culled.
+	Each segment's box holds the bone positions at a few samples within it and the samples bordering it, inflated by the skin radius.
+*/
+class ClipBounds {
+private:
+	float segments_per_second_{};
+	std::vector<Aabb> segments_;
+
+	std::size_t segment_(Seconds const time) const {
+		return std::min(static_cast<std::size_t>(std::max(time.count(), 0.f)*segments_per_second_), segments_.size() - 1);
+	}
+
+public:
+	ClipBounds() = default;
+	ClipBounds(Animation const& animation, float const skin_radius, Seconds const segment_duration = Seconds{0.25f}, int const samples_per_segment = 8) :
+		segments_per_second_{1.f/segment_duration.count()}
+	{
+		auto const bone_count = animation.skeleton().bone_count();
+		auto global_transforms = std::vector<glm::mat4>(bone_count);
+		auto animation_transforms = std::vector<glm::mat4>(bone_count);
+
+		auto const segment_count = std::max(std::size_t{1}, static_cast<std::size_t>(std::ceil(animation.duration()/segment_duration)));
+		segments_.resize(segment_count);
+
+		for (auto const segment : util::indices(segment_count))
+		{
+			for (auto sample = 0; sample <= samples_per_segment; ++sample)
+			{
+				auto const time = segment_duration*(static_cast<float>(segment) + static_cast<float>(sample)/static_cast<float>(samples_per_segment));
+				animation.evaluate_bone_matrices(std::min(time, animation.duration()),
+					{global_transforms.data(), bone_count}, {animation_transforms.data(), bone_count});
+				for (auto const& transform : global_transforms) {
+					segments_[segment].add(glm::vec3{transform[3]});
+				}
+			}
+			segments_[segment] = segments_[segment].inflated(skin_radius);
+		}
+	}
+
+	bool is_empty() const {
+		return segments_.empty();
+	}
+
+	// The bounds of the segment that the time is in. Times past the end use the last segment.
+	Aabb const& bounds(Seconds const time) const {
+		return segments_[segment_(time)];
+	}
+	// The bounds of the segments that overlap the time range.
+	Aabb bounds(Seconds const start_time, Seconds const end_time) const
+	{
+		auto result = Aabb{};
+		for (auto segment = segment_(start_time); segment <= segment_(end_time); ++segment) {
+			result.add(segments_[segment]);
+		}
+		return result;
+	}
+};
+
+} // namespace testing
+
+#endif
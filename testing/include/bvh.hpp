@@ -0,0 +1,410 @@
+// A streaming reader for BVH motion capture files.
+// The hierarchy becomes a bind pose, and the motion is parsed straight from the memory-mapped file a chunk of frames at a time.
+
+#ifndef ANIMATION_RETARGETING_TESTING_BVH_HPP
+#define ANIMATION_RETARGETING_TESTING_BVH_HPP
+
+#include "mapped_file.hpp"
+
+#include "animation_retargeting.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace testing {
+namespace bvh {
+
+constexpr auto file_extension = ".bvh";
+
+inline bool is_bvh_path(char const* const path)
+{
+	auto const path_length = std::strlen(path);
+	auto const extension_length = std::strlen(file_extension);
+	return path_length >= extension_length && !std::strcmp(path + path_length - extension_length, file_extension);
+}
+
+namespace detail {
+
+constexpr bool is_whitespace(char const character) {
+	return character == ' ' || character == '\t' || character == '\n' || character == '\r';
+}
+
+/*
+	Parses a decimal number like "-12.345e-2". Up to 19 significant digits are accumulated as an integer and scaled
+	by an exact power of ten in double precision, which is exact for the short numbers in mocap files.
+	This is several times faster than strtof, which also has to handle locales and hexadecimal floats.
+*/
+inline float parse_float(char const*& position, char const* const end)
+{
+	constexpr double powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	while (position != end && is_whitespace(*position)) {
+		++position;
+	}
+
+	auto const is_negative = position != end && *position == '-';
+	if (position != end && (*position == '-' || *position == '+')) {
+		++position;
+	}
+
+	auto mantissa = std::uint64_t{};
+	auto exponent = 0;
+	auto digit_count = 0;
+	auto const* const start = position;
+
+	auto const add_digit = [&](int const digit) {
+		if (digit_count < 19) {
+			mantissa = mantissa*10 + static_cast<std::uint64_t>(digit);
+			++digit_count;
+			return true;
+		}
+		return false;
+	};
+
+	for (; position != end && *position >= '0' && *position <= '9'; ++position) {
+		if (!add_digit(*position - '0')) {
+			++exponent;
+		}
+	}
+	if (position != end && *position == '.') {
+		++position;
+		for (; position != end && *position >= '0' && *position <= '9'; ++position) {
+			if (add_digit(*position - '0')) {
+				--exponent;
+			}
+		}
+	}
+	if (position == start) {
+		throw std::runtime_error{"Expected a number in a BVH file."};
+	}
+	if (position != end && (*position == 'e' || *position == 'E'))
+	{
+		++position;
+		auto const is_exponent_negative = position != end && *position == '-';
+		if (position != end && (*position == '-' || *position == '+')) {
+			++position;
+		}
+		auto written_exponent = 0;
+		for (; position != end && *position >= '0' && *position <= '9'; ++position) {
+			written_exponent = std::min(written_exponent*10 + (*position - '0'), 1000);
+		}
+		exponent += is_exponent_negative ? -written_exponent : written_exponent;
+	}
+
+	auto value = static_cast<double>(mantissa);
+	if (exponent < 0) {
+		value = -exponent <= 22 ? value/powers_of_ten[-exponent] : value*std::pow(10., exponent);
+	}
+	else if (exponent > 0) {
+		value = exponent <= 22 ? value*powers_of_ten[exponent] : value*std::pow(10., exponent);
+	}
+	return static_cast<float>(is_negative ? -value : value);
+}
+
+} // namespace detail
+
+enum class Channel : std::uint8_t {
+	x_position,
+	y_position,
+	z_position,
+	x_rotation,
+	y_rotation,
+	z_rotation,
+};
+
+class File {
+private:
+	struct Joint_ {
+		std::array<Channel, 6> channels;
+		std::size_t channel_count;
+		bool has_position;
+		bool has_rotation;
+	};
+
+	MappedFile file_;
+	char const* position_;
+	char const* end_;
+
+	animation_retargeting::Pose pose_;
+	std::vector<Joint_> joints_;
+	std::size_t channel_count_{};
+
+	std::size_t frame_count_{};
+	float frame_time_{};
+
+	char const* motion_start_{};
+	std::size_t frames_read_{};
+
+	std::vector<float> frame_values_;
+
+	std::string_view next_token_()
+	{
+		while (position_ != end_ && detail::is_whitespace(*position_)) {
+			++position_;
+		}
+		auto const* const start = position_;
+		while (position_ != end_ && !detail::is_whitespace(*position_)) {
+			++position_;
+		}
+		return {start, static_cast<std::size_t>(position_ - start)};
+	}
+
+	void expect_token_(std::string_view const expected)
+	{
+		if (next_token_() != expected) {
+			throw std::runtime_error{"Expected " + std::string{expected} + " in a BVH file."};
+		}
+	}
+
+	glm::vec3 parse_offset_()
+	{
+		expect_token_("OFFSET");
+		auto offset = glm::vec3{};
+		for (auto const i : {0, 1, 2}) {
+			offset[i] = detail::parse_float(position_, end_);
+		}
+		return offset;
+	}
+
+	static Channel parse_channel_(std::string_view const name)
+	{
+		constexpr std::string_view names[] = {"Xposition", "Yposition", "Zposition", "Xrotation", "Yrotation", "Zrotation"};
+		for (auto const i : {0, 1, 2, 3, 4, 5}) {
+			if (name == names[i]) {
+				return static_cast<Channel>(i);
+			}
+		}
+		throw std::runtime_error{"Unknown BVH channel " + std::string{name} + "."};
+	}
+
+	// Parses the joint after its ROOT or JOINT keyword, with its children.
+	void parse_joint_(std::size_t const parent)
+	{
+		auto const name = next_token_();
+		expect_token_("{");
+
+		auto const index = pose_.bones.size();
+		pose_.bones.push_back(animation_retargeting::PoseBone{
+			animation_retargeting::intern_name(name.substr(name.find(':') + 1)),
+			parent,
+			glm::vec3{1.f},
+			glm::identity<glm::quat>(),
+			parse_offset_(),
+		});
+
+		auto joint = Joint_{};
+		expect_token_("CHANNELS");
+		joint.channel_count = static_cast<std::size_t>(detail::parse_float(position_, end_));
+		if (joint.channel_count > joint.channels.size()) {
+			throw std::runtime_error{"A BVH joint had more than six channels."};
+		}
+		for (auto i = std::size_t{}; i < joint.channel_count; ++i) {
+			joint.channels[i] = parse_channel_(next_token_());
+			joint.has_position = joint.has_position || joint.channels[i] <= Channel::z_position;
+			joint.has_rotation = joint.has_rotation || joint.channels[i] >= Channel::x_rotation;
+		}
+		joints_.push_back(joint);
+		channel_count_ += joint.channel_count;
+
+		while (true)
+		{
+			auto const token = next_token_();
+			if (token == "}") {
+				return;
+			}
+			if (token == "JOINT") {
+				parse_joint_(index);
+			}
+			else if (token == "End") {
+				// End sites only have an offset, and they aren't bones.
+				expect_token_("Site");
+				expect_token_("{");
+				parse_offset_();
+				expect_token_("}");
+			}
+			else {
+				throw std::runtime_error{"Unexpected " + std::string{token} + " in a BVH joint."};
+			}
+		}
+	}
+
+public:
+	explicit File(char const* const path) :
+		file_{path},
+		position_{reinterpret_cast<char const*>(file_.data())},
+		end_{position_ + file_.size()}
+	{
+		expect_token_("HIERARCHY");
+		expect_token_("ROOT");
+		parse_joint_(animation_retargeting::PoseBone::no_parent);
+
+		for (auto token = next_token_(); token != "MOTION"; token = next_token_()) {
+			if (token.empty()) {
+				throw std::runtime_error{"A BVH file had no MOTION section."};
+			}
+			if (token != "ROOT") {
+				throw std::runtime_error{"Unexpected " + std::string{token} + " in a BVH hierarchy."};
+			}
+			parse_joint_(animation_retargeting::PoseBone::no_parent);
+		}
+
+		expect_token_("Frames:");
+		frame_count_ = static_cast<std::size_t>(detail::parse_float(position_, end_));
+		expect_token_("Frame");
+		expect_token_("Time:");
+		frame_time_ = detail::parse_float(position_, end_);
+
+		motion_start_ = position_;
+		frame_values_.resize(channel_count_);
+	}
+
+	animation_retargeting::Pose const& pose() const {
+		return pose_;
+	}
+
+	std::size_t frame_count() const {
+		return frame_count_;
+	}
+	float frame_time() const {
+		return frame_time_;
+	}
+	std::size_t frames_read() const {
+		return frames_read_;
+	}
+	std::size_t byte_size() const {
+		return file_.size();
+	}
+
+	/*
+		Parses up to max_frame_count frames into the chunk and returns how many there were. The chunk has a bone per pose bone,
+		with a rotation per frame for joints with rotation channels and a translation per frame for joints with position channels.
+		Position channels replace the offset's components. Rotations are applied in the order of the channels.
+		Frames are evenly spaced, so every channel refers to the chunk's one time axis, which starts at 0 at the chunk's first frame.
+		The chunk's arrays are cleared but keep their capacity, so reading into the same chunk repeatedly doesn't allocate.
+	*/
+	std::size_t read_frames(std::size_t const max_frame_count, animation_retargeting::Animation& chunk)
+	{
+		chunk.bones.resize(joints_.size());
+		for (auto& bone : chunk.bones) {
+			bone.scales.clear();
+			bone.rotations.clear();
+			bone.translations.clear();
+		}
+
+		auto const frame_count = std::min(max_frame_count, frame_count_ - frames_read_);
+
+		// The times only depend on the frame count, so only the ones past the previous chunk's count need computing.
+		chunk.time_axes.resize(1);
+		auto& times = chunk.time_axes.front();
+		for (auto i = times.size(); i < frame_count; ++i) {
+			times.push_back(static_cast<float>(i)*frame_time_);
+		}
+		times.resize(frame_count);
+
+		for (auto i = std::size_t{}; i < joints_.size(); ++i) 
+		{
+			auto& bone = chunk.bones[i];
+			bone.rotation_time_axis = joints_[i].has_rotation ? 0 : animation_retargeting::AnimatedBone::no_time_axis;
+			bone.translation_time_axis = joints_[i].has_position ? 0 : animation_retargeting::AnimatedBone::no_time_axis;
+			if (joints_[i].has_rotation) {
+				bone.rotations.reserve(frame_count);
+			}
+			if (joints_[i].has_position) {
+				bone.translations.reserve(frame_count);
+			}
+		}
+
+		constexpr glm::vec3 axes[] = {glm::vec3{1.f, 0.f, 0.f}, glm::vec3{0.f, 1.f, 0.f}, glm::vec3{0.f, 0.f, 1.f}};
+
+		for (auto frame = std::size_t{}; frame < frame_count; ++frame)
+		{
+			for (auto& value : frame_values_) {
+				value = detail::parse_float(position_, end_);
+			}
+
+			auto const* value = frame_values_.data();
+			for (auto i = std::size_t{}; i < joints_.size(); ++i)
+			{
+				auto const& joint = joints_[i];
+				auto translation = pose_.bones[i].translation;
+				auto rotation = glm::identity<glm::quat>();
+
+				for (auto const channel : util::Span<Channel const>{joint.channels.data(), joint.channel_count})
+				{
+					auto const axis = static_cast<int>(channel) % 3;
+					if (channel <= Channel::z_position) {
+						translation[axis] = *value++;
+					}
+					else {
+						rotation = rotation*glm::angleAxis(glm::radians(*value++), axes[axis]);
+					}
+				}
+
+				if (joint.has_rotation) {
+					chunk.bones[i].rotations.push_back(rotation);
+				}
+				if (joint.has_position) {
+					chunk.bones[i].translations.push_back(translation);
+				}
+			}
+		}
+
+		frames_read_ += frame_count;
+		return frame_count;
+	}
+
+	void rewind() {
+		position_ = motion_start_;
+		frames_read_ = 0;
+	}
+};
+
+// Reads every remaining frame.
+inline animation_retargeting::Animation read_animation(File& file)
+{
+	auto animation = animation_retargeting::Animation{};
+	file.read_frames(file.frame_count() - file.frames_read(), animation);
+	return animation;
+}
+
+/*
+	Retargets the motion to another bind pose without holding the whole take in memory. Each chunk of at most chunk_frame_count
+	frames is parsed, retargeted and passed to consume(chunk, first_frame_index). Returns the retargeted bind pose.
+	The parsed and retargeted chunks are reused, so memory stays bounded by one chunk and consume has to copy what it keeps.
+*/
+template<typename Consumer_>
+animation_retargeting::Pose retarget_in_chunks(File& file, animation_retargeting::Pose target_bind_pose, std::size_t const chunk_frame_count, Consumer_&& consume)
+{
+	auto retargeting = animation_retargeting::create_retargeting(file.pose(), std::move(target_bind_pose));
+
+	auto chunk = animation_retargeting::Animation{};
+	auto retargeted_chunk = animation_retargeting::Animation{};
+	while (file.frames_read() < file.frame_count())
+	{
+		auto const first_frame = file.frames_read();
+		if (!file.read_frames(chunk_frame_count, chunk)) {
+			break;
+		}
+		animation_retargeting::apply_retargeting(retargeting, chunk, retargeted_chunk);
+		consume(static_cast<animation_retargeting::Animation const&>(retargeted_chunk), first_frame);
+	}
+	return std::move(retargeting.bind_pose);
+}
+
+} // namespace bvh
+} // namespace testing
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef ANIMATION_RETARGETING_TESTING_CLIP_HPP
+#define ANIMATION_RETARGETING_TESTING_CLIP_HPP
+
+#include "skeleton.hpp"
+
+#include "animation_retargeting.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace testing {
+
+/*
+	Plays an animation_retargeting::Animation, like the result of retarget(), without the tracks it was extracted from.
+	Channels store only values and refer to a shared time axis for their key times, and sampling finds the keys around
+	the time once per axis instead of once per channel. Channels without keys use the bind pose.
+*/
+class Clip {
+private:
+	struct Channel_ {
+		std::size_t bone;
+		cooked::Channel channel;
+	};
+
+	animation_retargeting::Animation animation_;
+	// The bind pose with the constant channels' values, which every sample starts from.
+	std::vector<LocalTransform> base_pose_;
+	// The channels with more than one key, grouped by time axis.
+	std::vector<std::vector<Channel_>> channels_by_time_axis_;
+	Seconds duration_{};
+
+	template<typename T>
+	static T interpolate_(std::vector<T> const& values, std::size_t const start_key, std::size_t const end_key, float const weight)
+	{
+		if (start_key == end_key) {
+			return values[start_key];
+		}
+		return util::map(0.f, 1.f, values[start_key], values[end_key], weight);
+	}
+
+	void add_channel_(std::size_t const bone, cooked::Channel const channel, std::size_t const time_axis, std::size_t const value_count)
+	{
+		if (value_count > 1)
+		{
+			if (time_axis >= animation_.time_axes.size() || animation_.time_axes[time_axis].size() != value_count) {
+				throw std::runtime_error{"An animation channel's values don't match its time axis."};
+			}
+			channels_by_time_axis_[time_axis].push_back(Channel_{bone, channel});
+			return;
+		}
+		if (value_count == 1)
+		{
+			auto const& animated_bone = animation_.bones[bone];
+			auto& base = base_pose_[bone];
+			switch (channel) {
+				case cooked::Channel::scale: base.scale = animated_bone.scales.front(); break;
+				case cooked::Channel::rotation: base.rotation = animated_bone.rotations.front(); break;
+				case cooked::Channel::translation: base.translation = animated_bone.translations.front(); break;
+			}
+		}
+	}
+
+public:
+	Clip(animation_retargeting::Animation animation, animation_retargeting::Pose const& bind_pose) :
+		animation_{std::move(animation)},
+		channels_by_time_axis_(animation_.time_axes.size())
+	{
+		if (animation_.bones.size() != bind_pose.bones.size()) {
+			throw std::runtime_error{"An animation and its bind pose have different numbers of bones."};
+		}
+
+		base_pose_.reserve(bind_pose.bones.size());
+		for (auto const& bone : bind_pose.bones) {
+			base_pose_.push_back(LocalTransform{bone.scale, bone.rotation, bone.translation});
+		}
+
+		for (auto const i : util::indices(animation_.bones))
+		{
+			auto const& bone = animation_.bones[i];
+			add_channel_(i, cooked::Channel::scale, bone.scale_time_axis, bone.scales.size());
+			add_channel_(i, cooked::Channel::rotation, bone.rotation_time_axis, bone.rotations.size());
+			add_channel_(i, cooked::Channel::translation, bone.translation_time_axis, bone.translations.size());
+		}
+
+		for (auto const& times : animation_.time_axes) {
+			if (!times.empty()) {
+				duration_ = std::max(duration_, Seconds{times.back()});
+			}
+		}
+	}
+
+	Seconds duration() const {
+		return duration_;
+	}
+	std::size_t bone_count() const {
+		return base_pose_.size();
+	}
+	std::size_t time_axis_count() const {
+		return animation_.time_axes.size();
+	}
+
+	// The memory used by the values and time axes.
+	std::size_t byte_size() const
+	{
+		auto size = std::size_t{};
+		for (auto const& bone : animation_.bones) {
+			size += bone.scales.size()*sizeof(glm::vec3) + bone.rotations.size()*sizeof(glm::quat) + bone.translations.size()*sizeof(glm::vec3);
+		}
+		for (auto const& times : animation_.time_axes) {
+			size += times.size()*sizeof(float);
+		}
+		return size;
+	}
+
+	// The pose at the time, indexed by bone id.
+	void sample(Seconds const time, util::Span<LocalTransform> const pose) const
+	{
+		std::copy(base_pose_.begin(), base_pose_.end(), pose.begin());
+
+		for (auto const axis : util::indices(channels_by_time_axis_))
+		{
+			auto const& channels = channels_by_time_axis_[axis];
+			if (channels.empty()) {
+				continue;
+			}
+
+			auto const& times = animation_.time_axes[axis];
+			auto const end = static_cast<std::size_t>(std::lower_bound(times.begin(), times.end(), time.count()) - times.begin());
+			auto const start_key = end == 0 ? 0 : std::min(end, times.size()) - 1;
+			auto const end_key = std::min(end, times.size() - 1);
+			auto const weight = end_key == start_key ? 0.f : (time.count() - times[start_key])/(times[end_key] - times[start_key]);
+
+			for (auto const& channel : channels)
+			{
+				auto const& bone = animation_.bones[channel.bone];
+				auto& transform = pose[channel.bone];
+				switch (channel.channel) {
+					case cooked::Channel::scale: transform.scale = interpolate_(bone.scales, start_key, end_key, weight); break;
+					case cooked::Channel::rotation: transform.rotation = interpolate_(bone.rotations, start_key, end_key, weight); break;
+					case cooked::Channel::translation: transform.translation = interpolate_(bone.translations, start_key, end_key, weight); break;
+				}
+			}
+		}
+	}
+};
+
+} // namespace testing
+
+#endif
@@ -0,0 +1,568 @@
+#ifndef ANIMATION_RETARGETING_TESTING_COMPRESSED_CLIP_HPP
+#define ANIMATION_RETARGETING_TESTING_COMPRESSED_CLIP_HPP
+
+#include "skeleton.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace testing {
+
+struct CompressionSettings {
+	// Tracks are resampled at about this rate, adjusted so that the last sample lands on the end of the clip.
+	float sample_rate = 30.f;
+	// The furthest that a vertex may move from where the original clip puts it, as a fraction of the size of the skeleton.
+	float relative_max_error = 0.0001f;
+	// Vertices are assumed to be at least this far from the bones that move them, as a fraction of the size of the skeleton.
+	float relative_shell_distance = 0.05f;
+};
+
+/*
+	A clip compressed in the spirit of ACL. The tracks are resampled uniformly and split into segments of 16 samples.
+	Values are normalized to the range of their track, and again to the range of their segment, which is stored with 8 bits
+	per component. In each segment, every track gets as few bits per component as keep the error under the limit.
+
+	Error is measured on virtual vertices around each bone, as far out as its furthest descendant, so a bone near the root
+	gets more bits than a finger. After the bits are chosen per track, the segment is decoded and every bone whose vertices
+	still move too far in model space, from the error its ancestors add, gets more bits along its chain.
+
+	Rotations are stored as three components. The fourth is recovered from the unit length, and is chosen per track
+	as the one that stays largest, so that the other three can be range reduced. Tracks that don't change store one value.
+*/
+class CompressedClip {
+public:
+	static constexpr auto segment_sample_count = std::size_t{16};
+
+private:
+	static constexpr auto channel_count_ = std::size_t{3};
+	// The bits per component that a track can use in a segment. 32 stores the values as raw floats.
+	static constexpr auto bit_widths_ = std::array<std::uint8_t, 15>{3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 32};
+	static constexpr auto raw_bit_width_ = std::uint8_t{32};
+	// Constant tracks can't get more bits, so they leave most of the error to the animated ones.
+	static constexpr auto constant_error_fraction_ = 0.1f;
+
+	struct Track_ {
+		cooked::Channel channel;
+		bool is_constant;
+		// For rotations, the component (x, y, z or w) that isn't stored.
+		std::uint8_t dropped_component;
+		// Indexes the track's data in each segment.
+		std::uint32_t animated_index;
+		// The value of a constant track, as (x, y, z, w) for rotations.
+		glm::vec4 constant_value;
+		glm::vec3 range_min;
+		glm::vec3 range_extent;
+	};
+	struct SegmentTrack_ {
+		std::uint32_t bit_offset;
+		std::uint8_t bit_width;
+		// The segment's range within the track's range, in 255ths.
+		std::array<std::uint8_t, 3> range_min;
+		std::array<std::uint8_t, 3> range_extent;
+	};
+
+	float sample_rate_{};
+	std::size_t sample_count_{};
+	std::size_t bone_count_{};
+	std::size_t animated_track_count_{};
+	float max_error_{};
+
+	// Indexed by bone_id*3 + channel.
+	std::vector<Track_> tracks_;
+	// Indexed by segment*animated_track_count + animated_index.
+	std::vector<SegmentTrack_> segment_tracks_;
+	std::vector<std::uint32_t> bits_;
+
+	// Only used to measure error.
+	std::vector<float> shell_distances_;
+	std::vector<float> bind_scales_;
+
+	static glm::vec4 to_vec4_(glm::quat const rotation) {
+		return {rotation.x, rotation.y, rotation.z, rotation.w};
+	}
+
+	static glm::vec4 channel_value_(LocalTransform const& transform, cooked::Channel const channel)
+	{
+		switch (channel) {
+			case cooked::Channel::scale: return glm::vec4{transform.scale, 0.f};
+			case cooked::Channel::rotation: return to_vec4_(transform.rotation);
+			case cooked::Channel::translation: return glm::vec4{transform.translation, 0.f};
+		}
+		return {};
+	}
+	static void set_channel_value_(LocalTransform& transform, cooked::Channel const channel, glm::vec4 const value)
+	{
+		switch (channel) {
+			case cooked::Channel::scale: transform.scale = glm::vec3{value}; break;
+			case cooked::Channel::rotation: transform.rotation = glm::quat{value.w, value.x, value.y, value.z}; break;
+			case cooked::Channel::translation: transform.translation = glm::vec3{value}; break;
+		}
+	}
+
+	// How far the difference between two values of a channel moves a vertex at the distance from the bone.
+	static float value_error_(cooked::Channel const channel, float const distance, glm::vec4 const a, glm::vec4 const b)
+	{
+		switch (channel) {
+			case cooked::Channel::scale: return glm::length(a - b)*distance;
+			// |a - b| is about half the angle between small rotations, and q and -q are the same rotation.
+			case cooked::Channel::rotation: return 2.f*distance*std::min(glm::length(a - b), glm::length(a + b));
+			case cooked::Channel::translation: return glm::length(a - b);
+		}
+		return 0.f;
+	}
+
+	static glm::vec3 stored_components_(Track_ const& track, glm::vec4 value)
+	{
+		if (track.channel != cooked::Channel::rotation) {
+			return glm::vec3{value};
+		}
+		if (value[track.dropped_component] < 0.f) {
+			value = -value;
+		}
+		auto stored = glm::vec3{};
+		for (auto i = 0, j = 0; i < 4; ++i) {
+			if (i != track.dropped_component) {
+				stored[j++] = value[i];
+			}
+		}
+		return stored;
+	}
+	static glm::vec4 value_from_stored_(Track_ const& track, glm::vec3 const stored)
+	{
+		if (track.channel != cooked::Channel::rotation) {
+			return glm::vec4{stored, 0.f};
+		}
+		auto value = glm::vec4{};
+		for (auto i = 0, j = 0; i < 4; ++i) {
+			value[i] = i == track.dropped_component ? std::sqrt(std::max(0.f, 1.f - glm::dot(stored, stored))) : stored[j++];
+		}
+		return glm::normalize(value);
+	}
+
+	static float max_quantized_value_(std::uint8_t const bit_width) {
+		return static_cast<float>((std::uint32_t{1} << bit_width) - 1);
+	}
+
+	static std::uint32_t encode_component_(Track_ const& track, SegmentTrack_ const& segment_track, int const component, float const value)
+	{
+		if (segment_track.bit_width == raw_bit_width_) {
+			auto bits = std::uint32_t{};
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+		auto const track_extent = track.range_extent[component];
+		auto const normalized = track_extent > 0.f ? (value - track.range_min[component])/track_extent : 0.f;
+
+		auto const segment_extent = static_cast<float>(segment_track.range_extent[component])/255.f;
+		auto const in_segment = segment_extent > 0.f ? (normalized - static_cast<float>(segment_track.range_min[component])/255.f)/segment_extent : 0.f;
+
+		return static_cast<std::uint32_t>(std::lround(std::clamp(in_segment, 0.f, 1.f)*max_quantized_value_(segment_track.bit_width)));
+	}
+	static float decode_component_(Track_ const& track, SegmentTrack_ const& segment_track, int const component, std::uint32_t const bits)
+	{
+		if (segment_track.bit_width == raw_bit_width_) {
+			auto value = float{};
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+		auto const normalized = (static_cast<float>(segment_track.range_min[component]) +
+			static_cast<float>(bits)/max_quantized_value_(segment_track.bit_width)*static_cast<float>(segment_track.range_extent[component]))/255.f;
+		return track.range_min[component] + normalized*track.range_extent[component];
+	}
+
+	// The value that a track decodes to, given how the segment stores it.
+	static glm::vec4 quantized_value_(Track_ const& track, SegmentTrack_ const& segment_track, glm::vec3 const stored)
+	{
+		auto decoded = glm::vec3{};
+		for (auto const component : {0, 1, 2}) {
+			decoded[component] = decode_component_(track, segment_track, component, encode_component_(track, segment_track, component, stored[component]));
+		}
+		return value_from_stored_(track, decoded);
+	}
+
+	static void write_bits_(std::vector<std::uint32_t>& bits, std::size_t const offset, std::uint32_t const value)
+	{
+		auto const word = offset/32;
+		if (bits.size() < word + 2) {
+			bits.resize(word + 2);
+		}
+		auto const window = std::uint64_t{value} << offset%32;
+		bits[word] |= static_cast<std::uint32_t>(window);
+		bits[word + 1] |= static_cast<std::uint32_t>(window >> 32);
+	}
+	std::uint32_t read_bits_(std::size_t const offset, std::uint8_t const bit_width) const
+	{
+		auto const word = offset/32;
+		auto const window = (std::uint64_t{bits_[word + 1]} << 32 | bits_[word]) >> offset%32;
+		return static_cast<std::uint32_t>(window & ((std::uint64_t{1} << bit_width) - 1));
+	}
+
+	glm::vec4 read_value_(Track_ const& track, std::size_t const sample) const
+	{
+		if (track.is_constant) {
+			return track.constant_value;
+		}
+		auto const& segment_track = segment_tracks_[sample/segment_sample_count*animated_track_count_ + track.animated_index];
+		auto offset = segment_track.bit_offset + sample%segment_sample_count*channel_count_*segment_track.bit_width;
+
+		auto stored = glm::vec3{};
+		for (auto const component : {0, 1, 2}) {
+			stored[component] = decode_component_(track, segment_track, component, read_bits_(offset, segment_track.bit_width));
+			offset += segment_track.bit_width;
+		}
+		return value_from_stored_(track, stored);
+	}
+
+	struct SamplePosition_ {
+		std::size_t start;
+		std::size_t end;
+		float weight;
+	};
+	SamplePosition_ sample_position_(Seconds const time) const
+	{
+		auto const position = std::clamp(time.count()*sample_rate_, 0.f, static_cast<float>(sample_count_ - 1));
+		auto const start = static_cast<std::size_t>(position);
+		return {start, std::min(start + 1, sample_count_ - 1), position - static_cast<float>(start)};
+	}
+
+	// Interpolates linearly, and rotations with a normalized lerp along the shorter arc.
+	static glm::vec4 interpolate_(cooked::Channel const channel, glm::vec4 const a, glm::vec4 b, float const weight)
+	{
+		if (channel != cooked::Channel::rotation) {
+			return a + (b - a)*weight;
+		}
+		if (glm::dot(a, b) < 0.f) {
+			b = -b;
+		}
+		return glm::normalize(a + (b - a)*weight);
+	}
+
+	static std::vector<LocalTransform> sample_tracks_(Skeleton const& skeleton, Seconds const time)
+	{
+		auto transforms = std::vector<LocalTransform>{};
+		transforms.reserve(skeleton.bone_count());
+		for (auto const& bone : skeleton.bones()) {
+			transforms.push_back(LocalTransform{
+				bone.scale_track.evaluate(time, bone.local_bind_scale),
+				bone.rotation_track.evaluate(time, bone.local_bind_rotation),
+				bone.translation_track.evaluate(time, bone.local_bind_translation),
+			});
+		}
+		return transforms;
+	}
+
+	static void calculate_global_transforms_(Skeleton const& skeleton, util::Span<LocalTransform const> const locals, util::Span<glm::mat4> const globals)
+	{
+		for (auto const& bone : skeleton.bones())
+		{
+			auto const& local = locals[bone.id];
+			auto const local_transform = bone.calculate_local_transform(local.scale, local.rotation, local.translation);
+			globals[bone.id] = bone.has_parent() ? globals[bone.parent]*local_transform : local_transform;
+		}
+	}
+
+	// How far apart the bone's virtual vertices are in the two poses. The vertices are the bone's origin and a point along each of its axes.
+	float vertex_error_(Bone::Id const bone, glm::mat4 const& expected, glm::mat4 const& actual) const
+	{
+		auto const distance = shell_distances_[bone]/bind_scales_[bone];
+		auto error = glm::length(glm::vec3{expected[3] - actual[3]});
+		for (auto const axis : {0, 1, 2}) {
+			error = std::max(error, glm::length(glm::vec3{(expected[axis] - actual[axis])*distance + expected[3] - actual[3]}));
+		}
+		return error;
+	}
+
+	void calculate_shell_distances_(Skeleton const& skeleton, CompressionSettings const& settings)
+	{
+		auto bounds_min = glm::vec3{std::numeric_limits<float>::max()};
+		auto bounds_max = glm::vec3{std::numeric_limits<float>::lowest()};
+		for (auto const& bone : skeleton.bones()) {
+			bounds_min = glm::min(bounds_min, glm::vec3{bone.bind_transform[3]});
+			bounds_max = glm::max(bounds_max, glm::vec3{bone.bind_transform[3]});
+		}
+		auto const size = skeleton.bone_count() > 1 ? std::max(glm::length(bounds_max - bounds_min), 1e-6f) : 1.f;
+		max_error_ = settings.relative_max_error*size;
+
+		shell_distances_.assign(skeleton.bone_count(), settings.relative_shell_distance*size);
+		bind_scales_.resize(skeleton.bone_count());
+		for (auto const& bone : skeleton.bones())
+		{
+			bind_scales_[bone.id] = std::max(glm::length(glm::vec3{bone.bind_transform[0]}), 1e-6f);
+
+			auto const position = glm::vec3{bone.bind_transform[3]};
+			for (auto ancestor = bone.parent; ancestor != Bone::no_parent; ancestor = skeleton.bone_by_id(ancestor)->parent) {
+				shell_distances_[ancestor] = std::max(shell_distances_[ancestor], glm::length(position - glm::vec3{skeleton.bone_by_id(ancestor)->bind_transform[3]}));
+			}
+		}
+	}
+
+public:
+	CompressedClip() = default;
+
+	// Compresses the tracks of the skeleton's bones. Bones without a track keep their bind value.
+	explicit CompressedClip(Skeleton const& skeleton, CompressionSettings const& settings = CompressionSettings{}) :
+		bone_count_{skeleton.bone_count()}
+	{
+		calculate_shell_distances_(skeleton, settings);
+
+		auto const duration = skeleton.animation_duration();
+		sample_count_ = static_cast<std::size_t>(std::ceil(duration.count()*settings.sample_rate)) + 1;
+		sample_rate_ = sample_count_ > 1 ? static_cast<float>(sample_count_ - 1)/duration.count() : settings.sample_rate;
+
+		// The original pose at every sample, and the model space matrices that the decoded poses are compared against.
+		auto original_locals = std::vector<LocalTransform>{};
+		auto original_globals = std::vector<glm::mat4>(sample_count_*bone_count_);
+		original_locals.reserve(sample_count_*bone_count_);
+		for (auto const sample : util::indices(sample_count_))
+		{
+			auto const locals = sample_tracks_(skeleton, Seconds{static_cast<float>(sample)/sample_rate_});
+			original_locals.insert(original_locals.end(), locals.begin(), locals.end());
+			calculate_global_transforms_(skeleton, {locals.data(), locals.size()}, {original_globals.data() + sample*bone_count_, bone_count_});
+		}
+		auto const original_value = [&](std::size_t const sample, std::size_t const track_index) {
+			return channel_value_(original_locals[sample*bone_count_ + track_index/channel_count_], tracks_[track_index].channel);
+		};
+
+		// Find the constant tracks, and the ranges and dropped rotation components of the others.
+		tracks_.resize(bone_count_*channel_count_);
+		auto animated_tracks = std::vector<std::size_t>{};
+		for (auto const track_index : util::indices(tracks_))
+		{
+			auto& track = tracks_[track_index];
+			track.channel = static_cast<cooked::Channel>(track_index%channel_count_);
+			track.constant_value = original_value(0, track_index);
+
+			auto const distance = shell_distances_[track_index/channel_count_];
+			track.is_constant = true;
+			for (auto const sample : util::indices(sample_count_)) {
+				if (value_error_(track.channel, distance, track.constant_value, original_value(sample, track_index)) > max_error_*constant_error_fraction_) {
+					track.is_constant = false;
+					break;
+				}
+			}
+			if (track.is_constant) {
+				continue;
+			}
+
+			if (track.channel == cooked::Channel::rotation)
+			{
+				auto smallest_magnitudes = glm::vec4{std::numeric_limits<float>::max()};
+				for (auto const sample : util::indices(sample_count_)) {
+					smallest_magnitudes = glm::min(smallest_magnitudes, glm::abs(original_value(sample, track_index)));
+				}
+				for (auto const component : {1, 2, 3}) {
+					if (smallest_magnitudes[component] > smallest_magnitudes[track.dropped_component]) {
+						track.dropped_component = static_cast<std::uint8_t>(component);
+					}
+				}
+			}
+
+			auto range_max = glm::vec3{std::numeric_limits<float>::lowest()};
+			track.range_min = glm::vec3{std::numeric_limits<float>::max()};
+			for (auto const sample : util::indices(sample_count_))
+			{
+				auto const stored = stored_components_(track, original_value(sample, track_index));
+				track.range_min = glm::min(track.range_min, stored);
+				range_max = glm::max(range_max, stored);
+			}
+			track.range_extent = range_max - track.range_min;
+
+			track.animated_index = static_cast<std::uint32_t>(animated_tracks.size());
+			animated_tracks.push_back(track_index);
+		}
+		animated_track_count_ = animated_tracks.size();
+
+		auto const segment_count = (sample_count_ + segment_sample_count - 1)/segment_sample_count;
+		segment_tracks_.resize(segment_count*animated_track_count_);
+
+		auto decoded_locals = std::vector<LocalTransform>(bone_count_);
+		auto decoded_globals = std::vector<glm::mat4>(bone_count_);
+		auto bit_count = std::size_t{};
+
+		for (auto const segment : util::indices(segment_count))
+		{
+			auto const first_sample = segment*segment_sample_count;
+			auto const last_sample = std::min(first_sample + segment_sample_count, sample_count_);
+			auto* const segment_tracks = segment_tracks_.data() + segment*animated_track_count_;
+			// Indexes bit_widths_.
+			auto width_indices = std::vector<std::size_t>(animated_track_count_);
+
+			auto const track_error = [&](std::size_t const track_index, SegmentTrack_ const& segment_track) {
+				auto const& track = tracks_[track_index];
+				auto error = 0.f;
+				for (auto sample = first_sample; sample < last_sample; ++sample) {
+					auto const original = original_value(sample, track_index);
+					auto const decoded = quantized_value_(track, segment_track, stored_components_(track, original));
+					error = std::max(error, value_error_(track.channel, shell_distances_[track_index/channel_count_], original, decoded));
+				}
+				return error;
+			};
+
+			// The range of the segment, and the fewest bits that keep each track's own error under the limit.
+			for (auto const animated_index : util::indices(animated_tracks))
+			{
+				auto const track_index = animated_tracks[animated_index];
+				auto const& track = tracks_[track_index];
+				auto& segment_track = segment_tracks[animated_index];
+
+				auto normalized_min = glm::vec3{1.f};
+				auto normalized_max = glm::vec3{0.f};
+				for (auto sample = first_sample; sample < last_sample; ++sample)
+				{
+					auto const stored = stored_components_(track, original_value(sample, track_index));
+					auto const normalized = glm::clamp((stored - track.range_min)/glm::max(track.range_extent, glm::vec3{std::numeric_limits<float>::min()}), 0.f, 1.f);
+					normalized_min = glm::min(normalized_min, normalized);
+					normalized_max = glm::max(normalized_max, normalized);
+				}
+				for (auto const component : {0, 1, 2})
+				{
+					auto const quantized_min = std::floor(normalized_min[component]*255.f);
+					auto const quantized_max = std::ceil(normalized_max[component]*255.f);
+					segment_track.range_min[component] = static_cast<std::uint8_t>(quantized_min);
+					segment_track.range_extent[component] = static_cast<std::uint8_t>(quantized_max - quantized_min);
+				}
+
+				auto& width_index = width_indices[animated_index];
+				for (; width_index < bit_widths_.size() - 1; ++width_index)
+				{
+					segment_track.bit_width = bit_widths_[width_index];
+					if (track_error(track_index, segment_track) <= max_error_) {
+						break;
+					}
+				}
+				segment_track.bit_width = bit_widths_[width_index];
+			}
+
+			// Error adds up down the hierarchy, so give more bits to the chains of bones whose vertices still move too far.
+			for (auto is_over_limit = true; is_over_limit;)
+			{
+				is_over_limit = false;
+				auto should_raise = std::vector<bool>(bone_count_);
+				for (auto sample = first_sample; sample < last_sample; ++sample)
+				{
+					for (auto const track_index : util::indices(tracks_))
+					{
+						auto const& track = tracks_[track_index];
+						auto const value = track.is_constant ? track.constant_value :
+							quantized_value_(track, segment_tracks[track.animated_index], stored_components_(track, original_value(sample, track_index)));
+						set_channel_value_(decoded_locals[track_index/channel_count_], track.channel, value);
+					}
+					calculate_global_transforms_(skeleton, {decoded_locals.data(), bone_count_}, {decoded_globals.data(), bone_count_});
+
+					for (auto const& bone : skeleton.bones()) {
+						if (vertex_error_(bone.id, original_globals[sample*bone_count_ + bone.id], decoded_globals[bone.id]) > max_error_) {
+							for (auto ancestor = bone.id; ancestor != Bone::no_parent; ancestor = skeleton.bone_by_id(ancestor)->parent) {
+								should_raise[ancestor] = true;
+							}
+						}
+					}
+				}
+
+				for (auto const animated_index : util::indices(animated_tracks))
+				{
+					auto const bone = animated_tracks[animated_index]/channel_count_;
+					auto& width_index = width_indices[animated_index];
+					if (should_raise[bone] && width_index < bit_widths_.size() - 1) {
+						segment_tracks[animated_index].bit_width = bit_widths_[++width_index];
+						is_over_limit = true;
+					}
+				}
+			}
+
+			for (auto const animated_index : util::indices(animated_tracks))
+			{
+				auto const track_index = animated_tracks[animated_index];
+				auto const& track = tracks_[track_index];
+				auto& segment_track = segment_tracks[animated_index];
+
+				segment_track.bit_offset = static_cast<std::uint32_t>(bit_count);
+				for (auto sample = first_sample; sample < last_sample; ++sample)
+				{
+					auto const stored = stored_components_(track, original_value(sample, track_index));
+					for (auto const component : {0, 1, 2}) {
+						write_bits_(bits_, bit_count, encode_component_(track, segment_track, component, stored[component]));
+						bit_count += segment_track.bit_width;
+					}
+				}
+			}
+		}
+		// Reads load two words at a time.
+		bits_.resize(bit_count/32 + 2);
+	}
+
+	std::size_t bone_count() const {
+		return bone_count_;
+	}
+	std::size_t sample_count() const {
+		return sample_count_;
+	}
+	std::size_t animated_track_count() const {
+		return animated_track_count_;
+	}
+	Seconds duration() const {
+		return Seconds{sample_count_ > 1 ? static_cast<float>(sample_count_ - 1)/sample_rate_ : 0.f};
+	}
+	// The error limit in model units.
+	float max_error() const {
+		return max_error_;
+	}
+	// The memory needed to decode the clip.
+	std::size_t byte_size() const {
+		return tracks_.size()*sizeof(Track_) + segment_tracks_.size()*sizeof(SegmentTrack_) + bits_.size()*sizeof(bits_[0]);
+	}
+
+	LocalTransform sample(Bone::Id const bone, Seconds const time) const
+	{
+		auto const position = sample_position_(time);
+		auto transform = LocalTransform{};
+		for (auto const channel : {cooked::Channel::scale, cooked::Channel::rotation, cooked::Channel::translation})
+		{
+			auto const& track = tracks_[bone*channel_count_ + static_cast<std::size_t>(channel)];
+			set_channel_value_(transform, channel, track.is_constant ? track.constant_value :
+				interpolate_(channel, read_value_(track, position.start), read_value_(track, position.end), position.weight));
+		}
+		return transform;
+	}
+	// Decodes the whole pose at the time, indexed by bone id.
+	void sample(Seconds const time, util::Span<LocalTransform> const pose) const
+	{
+		auto const position = sample_position_(time);
+		for (auto const track_index : util::indices(tracks_))
+		{
+			auto const& track = tracks_[track_index];
+			set_channel_value_(pose[track_index/channel_count_], track.channel, track.is_constant ? track.constant_value :
+				interpolate_(track.channel, read_value_(track, position.start), read_value_(track, position.end), position.weight));
+		}
+	}
+
+	// The furthest that a virtual vertex of the decoded pose is from where the skeleton's own tracks put it at the time.
+	float measure_error(Skeleton const& skeleton, Seconds const time) const
+	{
+		auto const original_locals = sample_tracks_(skeleton, time);
+		auto decoded_locals = std::vector<LocalTransform>(bone_count_);
+		sample(time, {decoded_locals.data(), bone_count_});
+
+		auto original_globals = std::vector<glm::mat4>(bone_count_);
+		auto decoded_globals = std::vector<glm::mat4>(bone_count_);
+		calculate_global_transforms_(skeleton, {original_locals.data(), bone_count_}, {original_globals.data(), bone_count_});
+		calculate_global_transforms_(skeleton, {decoded_locals.data(), bone_count_}, {decoded_globals.data(), bone_count_});
+
+		auto error = 0.f;
+		for (auto const& bone : skeleton.bones()) {
+			error = std::max(error, vertex_error_(bone.id, original_globals[bone.id], decoded_globals[bone.id]));
+		}
+		return error;
+	}
+};
+
+} // namespace testing
+
+#endif
@@ -0,0 +1,490 @@
+// An incremental cook pipeline that turns FBX assets into cooked files.
+//
+// The pipeline reads a manifest with one asset per line:
+//   model <name> <fbx path>
+//   clip <name> <fbx path>
+//   retarget <name> <clip name> <source model name> <target model name>
+// Empty lines and lines starting with '#' are ignored. Assets can only depend on assets listed before them.
+//
+// Every asset is cooked into <output directory>/<name>.cooked. The cook key of an asset hashes its kind,
+// import settings, the contents of its input file and the keys of its dependencies, so an edited file makes
+// everything that depends on it stale. Keys are stored in <output directory>/cook.db between runs.
+
+#ifndef ANIMATION_RETARGETING_TESTING_COOK_HPP
+#define ANIMATION_RETARGETING_TESTING_COOK_HPP
+
+#include "animation.hpp"
+#include "cooked.hpp"
+#include "mapped_file.hpp"
+#include "model.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace testing {
+namespace cook {
+
+enum class AssetKind {
+	model,
+	clip,
+	retarget,
+};
+
+inline char const* asset_kind_name(AssetKind const kind)
+{
+	switch (kind) {
+		case AssetKind::model: return "model";
+		case AssetKind::clip: return "clip";
+		case AssetKind::retarget: return "retarget";
+	}
+	return "";
+}
+
+// Describes everything besides the input contents that affects an asset's cooked output.
+// Change these when the import code changes in a way that should invalidate earlier cooks.
+inline std::string import_settings(AssetKind const kind)
+{
+	switch (kind) {
+		case AssetKind::model:
+			return fmt::format("fbx model, bulk OpenGL axis conversion, fan triangulated, cooked v{}", cooked::version);
+		case AssetKind::clip:
+			return fmt::format("fbx clip, bulk OpenGL axis conversion, raw curve keys, cooked v{}", cooked::version);
+		case AssetKind::retarget:
+			return fmt::format("retarget, cooked v{}", cooked::version);
+	}
+	return {};
+}
+
+//---------------------------------------------------
+// 64-bit FNV-1a.
+
+constexpr auto hash_seed = std::uint64_t{0xcbf29ce484222325};
+
+inline std::uint64_t hash_bytes(void const* const data, std::size_t const size, std::uint64_t hash = hash_seed)
+{
+	auto const* const bytes = static_cast<unsigned char const*>(data);
+	for (auto const i : util::indices(size)) {
+		hash = (hash ^ bytes[i])*std::uint64_t{0x100000001b3};
+	}
+	return hash;
+}
+inline std::uint64_t hash_string(std::string const& string, std::uint64_t const hash = hash_seed) {
+	// Include the terminator so that consecutive strings can't run into each other.
+	return hash_bytes(string.c_str(), string.size() + 1, hash);
+}
+inline std::uint64_t hash_value(std::uint64_t const value, std::uint64_t const hash = hash_seed) {
+	return hash_bytes(&value, sizeof(value), hash);
+}
+
+inline std::uint64_t hash_file(char const* const path)
+{
+	auto const file = MappedFile{path};
+	return hash_bytes(file.data(), file.size());
+}
+
+//---------------------------------------------------
+
+struct Asset {
+	AssetKind kind;
+	std::string name;
+
+	// The FBX file, for models and clips.
+	std::string input;
+
+	// Indices into the manifest's assets. For retargets these are the clip, source model and target model.
+	std::vector<std::size_t> dependencies;
+};
+
+class Manifest {
+private:
+	std::vector<Asset> assets_;
+
+	std::size_t dependency_index_(std::string const& name, AssetKind const kind, std::size_t const line_number) const
+	{
+		auto const pos = std::find_if(assets_.begin(), assets_.end(), [&](Asset const& asset) { return asset.name == name; });
+		if (pos == assets_.end() || pos->kind != kind) {
+			throw std::runtime_error{fmt::format("Line {}: there is no {} named {} listed before it.", line_number, asset_kind_name(kind), name)};
+		}
+		return static_cast<std::size_t>(pos - assets_.begin());
+	}
+
+public:
+	explicit Manifest(char const* const path)
+	{
+		auto stream = std::ifstream{path};
+		if (!stream) {
+			throw std::runtime_error{"Failed to open manifest " + std::string{path} + "."};
+		}
+
+		auto line = std::string{};
+		for (auto line_number = std::size_t{1}; std::getline(stream, line); ++line_number)
+		{
+			auto words = std::istringstream{line};
+			auto kind = std::string{};
+			if (!(words >> kind) || kind[0] == '#') {
+				continue;
+			}
+
+			auto asset = Asset{};
+			if (!(words >> asset.name)) {
+				throw std::runtime_error{fmt::format("Line {}: missing asset name.", line_number)};
+			}
+			if (std::any_of(assets_.begin(), assets_.end(), [&](Asset const& other) { return other.name == asset.name; })) {
+				throw std::runtime_error{fmt::format("Line {}: the name {} is used more than once.", line_number, asset.name)};
+			}
+
+			if (kind == "model" || kind == "clip") {
+				asset.kind = kind == "model" ? AssetKind::model : AssetKind::clip;
+				if (!(words >> asset.input)) {
+					throw std::runtime_error{fmt::format("Line {}: missing input file.", line_number)};
+				}
+			}
+			else if (kind == "retarget") {
+				asset.kind = AssetKind::retarget;
+				auto clip = std::string{}, source = std::string{}, target = std::string{};
+				if (!(words >> clip >> source >> target)) {
+					throw std::runtime_error{fmt::format("Line {}: a retarget needs a clip, a source model and a target model.", line_number)};
+				}
+				asset.dependencies = {
+					dependency_index_(clip, AssetKind::clip, line_number),
+					dependency_index_(source, AssetKind::model, line_number),
+					dependency_index_(target, AssetKind::model, line_number),
+				};
+			}
+			else {
+				throw std::runtime_error{fmt::format("Line {}: unknown asset kind {}.", line_number, kind)};
+			}
+
+			assets_.push_back(std::move(asset));
+		}
+	}
+
+	std::vector<Asset> const& assets() const {
+		return assets_;
+	}
+};
+
+//---------------------------------------------------
+
+// What was recorded for an asset the last time it was cooked successfully.
+struct DatabaseEntry {
+	std::uint64_t key;
+	std::string input;
+	std::uint64_t input_hash;
+	std::string settings;
+	std::string dependencies;
+};
+
+// A tab-separated text file with one line per cooked asset.
+class Database {
+private:
+	std::unordered_map<std::string, DatabaseEntry> entries_;
+
+public:
+	static constexpr auto file_name = "cook.db";
+
+	Database() = default;
+	explicit Database(std::filesystem::path const& path)
+	{
+		auto stream = std::ifstream{path};
+
+		auto line = std::string{};
+		while (std::getline(stream, line))
+		{
+			auto fields = std::vector<std::string>{};
+			auto field_stream = std::istringstream{line};
+			for (auto field = std::string{}; std::getline(field_stream, field, '\t');) {
+				fields.push_back(std::move(field));
+			}
+			if (fields.size() < 5) {
+				continue;
+			}
+			entries_[fields[0]] = DatabaseEntry{
+				std::stoull(fields[1], nullptr, 16),
+				fields[2],
+				std::stoull(fields[3], nullptr, 16),
+				fields[4],
+				fields.size() > 5 ? fields[5] : std::string{}
+			};
+		}
+	}
+
+	DatabaseEntry const* find(std::string const& name) const
+	{
+		auto const pos = entries_.find(name);
+		return pos == entries_.end() ? nullptr : &pos->second;
+	}
+
+	void set(std::string const& name, DatabaseEntry entry) {
+		entries_[name] = std::move(entry);
+	}
+
+	void write(std::filesystem::path const& path) const
+	{
+		auto stream = std::ofstream{path};
+		for (auto const& entry : entries_) {
+			stream << fmt::format("{}\t{:016x}\t{}\t{:016x}\t{}\t{}\n", entry.first, entry.second.key, entry.second.input,
+				entry.second.input_hash, entry.second.settings, entry.second.dependencies);
+		}
+		if (!stream) {
+			throw std::runtime_error{"Failed to write the cook database " + path.string() + "."};
+		}
+	}
+};
+
+//---------------------------------------------------
+
+struct Summary {
+	std::size_t skipped{};
+	std::size_t rebuilt{};
+	std::size_t failed{};
+
+	// Wall-clock time of the whole run, and the time spent cooking summed over all threads.
+	std::chrono::duration<double> total_time{};
+	std::chrono::duration<double> cook_time{};
+};
+
+class Pipeline {
+private:
+	using Clock_ = std::chrono::steady_clock;
+
+	enum class State_ {
+		up_to_date,
+		stale,
+		rebuilt,
+		failed,
+	};
+
+	std::vector<Asset> const& assets_;
+	std::filesystem::path output_directory_;
+	unsigned thread_count_;
+
+	std::vector<std::uint64_t> keys_;
+	std::vector<std::uint64_t> input_hashes_;
+	std::vector<State_> states_;
+
+	std::mutex print_mutex_;
+
+	std::filesystem::path output_path_(std::size_t const index) const {
+		return output_directory_/(assets_[index].name + cooked::file_extension);
+	}
+
+	void cook_retarget_(Asset const& asset, cooked::Writer& writer) const
+	{
+		auto const clip_path = output_path_(asset.dependencies[0]).string();
+
+		auto const source_file = cooked::File{output_path_(asset.dependencies[1]).string().c_str()};
+		auto source_skeleton = Skeleton{};
+		source_skeleton.load_from_cooked(source_file);
+		// Loads the clip's tracks into the skeleton.
+		Animation{clip_path.c_str(), source_skeleton};
+
+		auto const target_file = cooked::File{output_path_(asset.dependencies[2]).string().c_str()};
+		auto target_skeleton = Skeleton{};
+		target_skeleton.load_from_cooked(target_file);
+		Animation{clip_path.c_str(), target_skeleton};
+
+		// The same steps as when retargeting at startup in the scene.
+		auto const result = animation_retargeting::retarget(source_skeleton.extract_animation(), source_skeleton.extract_pose(), target_skeleton.extract_pose(), 
+			animation_retargeting::ConstantChannels::collapse);
+		target_skeleton.set_animation_values(result.animation);
+		target_skeleton.set_bind_pose(result.bind_pose);
+
+		// The result is a complete character: the target's meshes, its retargeted skeleton and the clip.
+		target_skeleton.cook(writer);
+		target_skeleton.cook_animation(writer);
+		for (auto const& mesh : target_file.meshes()) {
+			writer.add_mesh(target_file.vertices<Vertex>(mesh), target_file.indices(mesh));
+		}
+	}
+
+	void cook_(std::size_t const index)
+	{
+		auto const& asset = assets_[index];
+
+		auto writer = cooked::Writer{};
+		switch (asset.kind) {
+			case AssetKind::model: Model::cook(asset.input.c_str(), writer); break;
+			case AssetKind::clip: Animation::cook(asset.input.c_str(), writer); break;
+			case AssetKind::retarget: cook_retarget_(asset, writer); break;
+		}
+
+		// Write to a temporary file first so that an interrupted cook never leaves a valid-looking output.
+		auto const output_path = output_path_(index);
+		auto temporary_path = output_path;
+		temporary_path += ".tmp";
+		writer.write(temporary_path.string().c_str());
+		std::filesystem::rename(temporary_path, output_path);
+	}
+
+	void compute_keys_(Database const& database)
+	{
+		for (auto const i : util::indices(assets_))
+		{
+			auto const& asset = assets_[i];
+
+			auto key = hash_string(import_settings(asset.kind), hash_value(static_cast<std::uint64_t>(asset.kind)));
+			if (!asset.input.empty()) {
+				key = hash_value(input_hashes_[i], hash_string(asset.input, key));
+			}
+			for (auto const dependency : asset.dependencies) {
+				key = hash_value(keys_[dependency], key);
+			}
+			keys_[i] = key;
+
+			auto const* const entry = database.find(asset.name);
+			states_[i] = entry && entry->key == key && std::filesystem::exists(output_path_(i)) ? State_::up_to_date : State_::stale;
+		}
+	}
+
+	// Runs function(i) for i in [0, count) on the pipeline's threads.
+	template<typename Function_>
+	void parallel_for_(std::size_t const count, Function_ const& function)
+	{
+		auto next = std::atomic<std::size_t>{};
+		auto const work = [&] {
+			for (auto i = next++; i < count; i = next++) {
+				function(i);
+			}
+		};
+
+		auto threads = std::vector<std::thread>{};
+		for (auto const i : util::indices(std::min<std::size_t>(thread_count_, count) - (count ? 1 : 0))) {
+			static_cast<void>(i);
+			threads.emplace_back(work);
+		}
+		work();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+
+public:
+	Pipeline(std::vector<Asset> const& assets, std::filesystem::path output_directory, unsigned const thread_count) :
+		assets_{assets},
+		output_directory_{std::move(output_directory)},
+		thread_count_{std::max(thread_count, 1u)},
+		keys_(assets.size()),
+		input_hashes_(assets.size()),
+		states_(assets.size())
+	{}
+
+	Summary run()
+	{
+		auto const start_time = Clock_::now();
+		auto summary = Summary{};
+
+		std::filesystem::create_directories(output_directory_);
+		auto const database_path = output_directory_/Database::file_name;
+		auto database = Database{database_path};
+
+		// Hash the inputs in parallel, then derive the keys in manifest order so dependencies come first.
+		parallel_for_(assets_.size(), [&](std::size_t const i) {
+			if (!assets_[i].input.empty()) {
+				try {
+					input_hashes_[i] = hash_file(assets_[i].input.c_str());
+				}
+				catch (std::exception const&) {
+					// A missing input makes the asset stale and its cook reports the error.
+					input_hashes_[i] = 0;
+				}
+			}
+		});
+		compute_keys_(database);
+
+		// Cook one dependency level at a time; assets within a level are independent.
+		auto levels = std::vector<std::size_t>(assets_.size());
+		for (auto const i : util::indices(assets_)) {
+			for (auto const dependency : assets_[i].dependencies) {
+				levels[i] = std::max(levels[i], levels[dependency] + 1);
+			}
+		}
+
+		auto cook_time = std::atomic<std::int64_t>{};
+		auto const level_count = assets_.empty() ? std::size_t{} : *std::max_element(levels.begin(), levels.end()) + 1;
+
+		for (auto const level : util::indices(level_count))
+		{
+			auto stale = std::vector<std::size_t>{};
+			for (auto const i : util::indices(assets_)) {
+				if (levels[i] == level && states_[i] == State_::stale) {
+					stale.push_back(i);
+				}
+			}
+
+			parallel_for_(stale.size(), [&](std::size_t const stale_index)
+			{
+				auto const i = stale[stale_index];
+				auto const& asset = assets_[i];
+
+				auto const has_failed_dependency = std::any_of(asset.dependencies.begin(), asset.dependencies.end(),
+					[&](std::size_t const dependency) { return states_[dependency] == State_::failed; });
+
+				auto const cook_start_time = Clock_::now();
+				auto error = std::string{};
+				if (has_failed_dependency) {
+					error = "a dependency failed to cook";
+				}
+				else {
+					try {
+						cook_(i);
+					}
+					catch (std::exception const& exception) {
+						error = exception.what();
+					}
+				}
+				auto const duration = Clock_::now() - cook_start_time;
+				cook_time += std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+
+				states_[i] = error.empty() ? State_::rebuilt : State_::failed;
+
+				auto const lock = std::lock_guard<std::mutex>{print_mutex_};
+				if (error.empty()) {
+					fmt::print("Cooked {} {} in {:.1f} ms.\n", asset_kind_name(asset.kind), asset.name,
+						std::chrono::duration<double, std::milli>{duration}.count());
+				}
+				else {
+					fmt::print("Failed to cook {} {}: {}\n", asset_kind_name(asset.kind), asset.name, error);
+				}
+			});
+		}
+
+		for (auto const i : util::indices(assets_))
+		{
+			auto const& asset = assets_[i];
+			switch (states_[i]) {
+				case State_::up_to_date: ++summary.skipped; break;
+				case State_::rebuilt: ++summary.rebuilt; break;
+				default: ++summary.failed; continue;
+			}
+
+			auto dependencies = std::string{};
+			for (auto const dependency : asset.dependencies) {
+				dependencies += (dependencies.empty() ? "" : ",") + assets_[dependency].name;
+			}
+			database.set(asset.name, DatabaseEntry{keys_[i], asset.input, input_hashes_[i], import_settings(asset.kind), std::move(dependencies)});
+		}
+		database.write(database_path);
+
+		summary.cook_time = std::chrono::microseconds{cook_time.load()};
+		summary.total_time = Clock_::now() - start_time;
+		return summary;
+	}
+};
+
+} // namespace cook
+} // namespace testing
+
+#endif
@@ -0,0 +1,375 @@
+// The cooked asset format: skeletons, clips and meshes converted ahead of time so that
+// runtime loading maps the file and reads it in place, without going through the FBX SDK.
+//
+// Layout (little-endian, every section and every array starts on a 64-byte boundary):
+//   FileHeader
+//   SectionHeader[section_count]
+//   sections: strings, bones, tracks, meshes and the array data referenced by tracks and meshes.
+
+#ifndef ANIMATION_RETARGETING_TESTING_COOKED_HPP
+#define ANIMATION_RETARGETING_TESTING_COOKED_HPP
+
+#include "mapped_file.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace testing {
+namespace cooked {
+
+constexpr auto file_extension = ".cooked";
+
+constexpr auto alignment = std::size_t{64};
+constexpr auto magic = std::array<char, 8>{'A', 'R', 'C', 'O', 'O', 'K', 'E', 'D'};
+constexpr auto version = std::uint32_t{1};
+constexpr auto endianness_tag = std::uint32_t{0x01020304};
+
+constexpr auto no_parent = static_cast<std::uint32_t>(-1);
+
+inline bool is_cooked_path(char const* const path)
+{
+	auto const path_length = std::strlen(path);
+	auto const extension_length = std::strlen(file_extension);
+	return path_length >= extension_length && !std::strcmp(path + path_length - extension_length, file_extension);
+}
+
+inline bool is_little_endian()
+{
+	auto const tag = endianness_tag;
+	unsigned char first_byte;
+	std::memcpy(&first_byte, &tag, 1);
+	return first_byte == 0x04;
+}
+
+constexpr std::size_t align_up(std::size_t const offset) {
+	return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+//---------------------------------------------------
+// On-disk records.
+
+enum class SectionType : std::uint32_t {
+	strings,
+	bones,
+	tracks,
+	meshes,
+	data,
+};
+
+enum class Channel : std::uint32_t {
+	scale,
+	rotation,
+	translation,
+};
+
+struct FileHeader {
+	std::array<char, 8> magic;
+	std::uint32_t version;
+	std::uint32_t endianness;
+	std::uint64_t file_size;
+	std::uint32_t section_count;
+	std::array<std::uint32_t, 9> reserved;
+};
+static_assert(sizeof(FileHeader) == alignment, "The file header must fill exactly one alignment block.");
+
+struct SectionHeader {
+	SectionType type;
+	std::uint32_t reserved;
+	std::uint64_t offset;
+	std::uint64_t size;
+	std::uint64_t count;
+};
+
+// Offsets into the string section are used for names, offsets relative to the data section for arrays.
+
+struct BoneRecord {
+	std::uint32_t name;
+	std::uint32_t parent;
+
+	glm::mat4 bind_transform;
+
+	glm::mat4 pre_scaling;
+	glm::mat4 pre_rotation;
+	glm::mat4 pre_translation;
+	glm::mat4 post_translation;
+
+	glm::vec3 local_bind_scale;
+	glm::quat local_bind_rotation;
+	glm::vec3 local_bind_translation;
+};
+
+// Keyframe times and values are stored as two separate arrays.
+struct TrackRecord {
+	std::uint32_t bone_name;
+	Channel channel;
+	std::uint32_t key_count;
+	std::uint32_t value_size;
+	std::uint64_t times;
+	std::uint64_t values;
+};
+
+struct MeshRecord {
+	std::uint32_t vertex_count;
+	std::uint32_t vertex_size;
+	std::uint32_t index_count;
+	std::uint32_t reserved;
+	std::uint64_t vertices;
+	std::uint64_t indices;
+};
+
+static_assert(std::is_trivially_copyable<BoneRecord>::value && std::is_trivially_copyable<TrackRecord>::value &&
+	std::is_trivially_copyable<MeshRecord>::value, "Cooked records are written and mapped as raw bytes.");
+
+//---------------------------------------------------
+
+class Writer {
+private:
+	std::string strings_;
+	std::vector<BoneRecord> bones_;
+	std::vector<TrackRecord> tracks_;
+	std::vector<MeshRecord> meshes_;
+	std::vector<unsigned char> data_;
+
+	std::uint32_t add_string_(char const* const string)
+	{
+		auto const offset = static_cast<std::uint32_t>(strings_.size());
+		strings_ += string;
+		strings_ += '\0';
+		return offset;
+	}
+
+	template<typename T>
+	std::uint64_t add_array_(T const* const elements, std::size_t const count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable arrays can be cooked.");
+
+		auto const offset = align_up(data_.size());
+		data_.resize(offset + count*sizeof(T));
+		if (count) {
+			std::memcpy(data_.data() + offset, elements, count*sizeof(T));
+		}
+		return offset;
+	}
+
+	static void write_padding_(std::ofstream& stream, std::size_t const size)
+	{
+		static constexpr auto zeros = std::array<char, alignment>{};
+		auto const padding = align_up(size) - size;
+		stream.write(zeros.data(), static_cast<std::streamsize>(padding));
+	}
+
+public:
+	// The name and parent fields of the record are set by the writer.
+	void add_bone(char const* const name, std::uint32_t const parent, BoneRecord record)
+	{
+		record.name = add_string_(name);
+		record.parent = parent;
+		bones_.push_back(record);
+	}
+
+	template<typename T>
+	void add_track(char const* const bone_name, Channel const channel, std::vector<float> const& times, std::vector<T> const& values)
+	{
+		assert(times.size() == values.size());
+
+		tracks_.push_back(TrackRecord{
+			add_string_(bone_name),
+			channel,
+			static_cast<std::uint32_t>(times.size()),
+			static_cast<std::uint32_t>(sizeof(T)),
+			add_array_(times.data(), times.size()),
+			add_array_(values.data(), values.size()),
+		});
+	}
+
+	template<typename Vertex_>
+	void add_mesh(util::Span<Vertex_ const> const vertices, util::Span<std::uint32_t const> const indices)
+	{
+		meshes_.push_back(MeshRecord{
+			static_cast<std::uint32_t>(vertices.size()),
+			static_cast<std::uint32_t>(sizeof(Vertex_)),
+			static_cast<std::uint32_t>(indices.size()),
+			0,
+			add_array_(vertices.data(), vertices.size()),
+			add_array_(indices.data(), indices.size()),
+		});
+	}
+	template<typename Vertex_>
+	void add_mesh(std::vector<Vertex_> const& vertices, std::vector<std::uint32_t> const& indices) {
+		add_mesh(util::Span<Vertex_ const>{vertices.data(), vertices.size()}, util::Span<std::uint32_t const>{indices.data(), indices.size()});
+	}
+
+	void write(char const* const path) const
+	{
+		if (!is_little_endian()) {
+			throw std::runtime_error{"Cooked files can only be written on little-endian machines."};
+		}
+
+		auto sections = std::array<SectionHeader, 5>{
+			SectionHeader{SectionType::strings, 0, 0, strings_.size(), strings_.size()},
+			SectionHeader{SectionType::bones, 0, 0, bones_.size()*sizeof(BoneRecord), bones_.size()},
+			SectionHeader{SectionType::tracks, 0, 0, tracks_.size()*sizeof(TrackRecord), tracks_.size()},
+			SectionHeader{SectionType::meshes, 0, 0, meshes_.size()*sizeof(MeshRecord), meshes_.size()},
+			SectionHeader{SectionType::data, 0, 0, data_.size(), data_.size()},
+		};
+
+		auto offset = align_up(sizeof(FileHeader) + sizeof(sections));
+		for (auto& section : sections) {
+			section.offset = offset;
+			offset = align_up(offset + section.size);
+		}
+
+		auto const header = FileHeader{magic, version, endianness_tag, offset, static_cast<std::uint32_t>(sections.size()), {}};
+
+		auto stream = std::ofstream{path, std::ios::binary};
+		if (!stream) {
+			throw std::runtime_error{"Failed to open " + std::string{path} + " for writing."};
+		}
+
+		stream.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<char const*>(sections.data()), sizeof(sections));
+		write_padding_(stream, sizeof(header) + sizeof(sections));
+
+		auto const write_section = [&](void const* const data, std::size_t const size) {
+			stream.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+			write_padding_(stream, size);
+		};
+		write_section(strings_.data(), strings_.size());
+		write_section(bones_.data(), bones_.size()*sizeof(BoneRecord));
+		write_section(tracks_.data(), tracks_.size()*sizeof(TrackRecord));
+		write_section(meshes_.data(), meshes_.size()*sizeof(MeshRecord));
+		write_section(data_.data(), data_.size());
+
+		if (!stream) {
+			throw std::runtime_error{"Failed to write cooked file " + std::string{path} + "."};
+		}
+	}
+};
+
+//---------------------------------------------------
+
+// A mapped cooked file. All views point directly into the mapping and live as long as the File.
+class File {
+private:
+	MappedFile file_;
+
+	util::Span<char const> strings_;
+	util::Span<BoneRecord const> bones_;
+	util::Span<TrackRecord const> tracks_;
+	util::Span<MeshRecord const> meshes_;
+	util::Span<unsigned char const> data_;
+
+	template<typename T>
+	util::Span<T const> section_view_(SectionHeader const& section) const
+	{
+		if (section.offset % alignment || section.offset + section.size > file_.size() || section.size != section.count*sizeof(T)) {
+			throw std::runtime_error{"A cooked file contains an invalid section."};
+		}
+		return {reinterpret_cast<T const*>(file_.data() + section.offset), static_cast<std::size_t>(section.count)};
+	}
+
+	template<typename T>
+	util::Span<T const> array_view_(std::uint64_t const offset, std::size_t const count) const
+	{
+		if (offset % alignment || offset + count*sizeof(T) > data_.size()) {
+			throw std::runtime_error{"A cooked file contains an array outside of its data section."};
+		}
+		return {reinterpret_cast<T const*>(data_.data() + offset), count};
+	}
+
+public:
+	explicit File(char const* const path) :
+		file_{path}
+	{
+		if (file_.size() < sizeof(FileHeader)) {
+			throw std::runtime_error{"The file " + std::string{path} + " is too small to be a cooked file."};
+		}
+
+		auto const& header = *reinterpret_cast<FileHeader const*>(file_.data());
+		if (header.magic != magic) {
+			throw std::runtime_error{"The file " + std::string{path} + " is not a cooked file."};
+		}
+		if (header.version != version) {
+			throw std::runtime_error{"The cooked file " + std::string{path} + " has an unsupported version, it needs to be cooked again."};
+		}
+		if (header.endianness != endianness_tag) {
+			throw std::runtime_error{"The cooked file " + std::string{path} + " was written with a different byte order."};
+		}
+		if (header.file_size > file_.size() || sizeof(FileHeader) + header.section_count*sizeof(SectionHeader) > file_.size()) {
+			throw std::runtime_error{"The cooked file " + std::string{path} + " is truncated."};
+		}
+
+		auto const* const sections = reinterpret_cast<SectionHeader const*>(file_.data() + sizeof(FileHeader));
+		for (auto const& section : util::Span<SectionHeader const>{sections, header.section_count})
+		{
+			switch (section.type) {
+				case SectionType::strings: strings_ = section_view_<char>(section); break;
+				case SectionType::bones: bones_ = section_view_<BoneRecord>(section); break;
+				case SectionType::tracks: tracks_ = section_view_<TrackRecord>(section); break;
+				case SectionType::meshes: meshes_ = section_view_<MeshRecord>(section); break;
+				case SectionType::data: data_ = section_view_<unsigned char>(section); break;
+			}
+		}
+		// Every string ends with a NUL, so strings read from a section that ends with one stay inside the mapping.
+		if (!strings_.empty() && strings_.back() != '\0') {
+			throw std::runtime_error{"The cooked file " + std::string{path} + " contains an unterminated string section."};
+		}
+	}
+
+	char const* string(std::uint32_t const offset) const
+	{
+		if (offset >= strings_.size()) {
+			throw std::runtime_error{"A cooked file contains a string outside of its string section."};
+		}
+		return strings_.data() + offset;
+	}
+
+	util::Span<BoneRecord const> bones() const {
+		return bones_;
+	}
+	util::Span<TrackRecord const> tracks() const {
+		return tracks_;
+	}
+	util::Span<MeshRecord const> meshes() const {
+		return meshes_;
+	}
+
+	util::Span<float const> times(TrackRecord const& track) const {
+		return array_view_<float>(track.times, track.key_count);
+	}
+
+	template<typename T>
+	util::Span<T const> values(TrackRecord const& track) const
+	{
+		if (track.value_size != sizeof(T)) {
+			throw std::runtime_error{"A cooked track has a different value type than requested."};
+		}
+		return array_view_<T>(track.values, track.key_count);
+	}
+
+	template<typename Vertex_>
+	util::Span<Vertex_ const> vertices(MeshRecord const& mesh) const
+	{
+		if (mesh.vertex_size != sizeof(Vertex_)) {
+			throw std::runtime_error{"A cooked mesh has a different vertex layout, it needs to be cooked again."};
+		}
+		return array_view_<Vertex_>(mesh.vertices, mesh.vertex_count);
+	}
+
+	util::Span<std::uint32_t const> indices(MeshRecord const& mesh) const {
+		return array_view_<std::uint32_t>(mesh.indices, mesh.index_count);
+	}
+};
+
+} // namespace cooked
+} // namespace testing
+
+#endif
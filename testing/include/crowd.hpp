@@ -0,0 +1,255 @@
+#ifndef ANIMATION_RETARGETING_TESTING_CROWD_HPP
+#define ANIMATION_RETARGETING_TESTING_CROWD_HPP
+
+#include "arena.hpp"
+#include "simd.hpp"
+#include "skeleton.hpp"
+#include "thread_pool.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace testing {
+
+/*
+	Plays one clip on many instances of a skeleton, each with its own time offset and playback rate.
+	The skeleton and its tracks are shared and never modified, so an instance only costs its local transforms and matrices.
+
+	Sampling is batched per track: instances are sorted by their local time, so one forward walk through a track's keys
+	serves all of them and instances at similar times read the same keys while they are in cache.
+	Local components are stored bone-major, one array per channel, and the hierarchy is then walked in parallel chunks of instances.
+	Rotations are interpolated and palettes multiplied in batches with the SIMD kernels.
+*/
+class Crowd {
+private:
+	static constexpr std::size_t instances_per_chunk_ = 64;
+	static constexpr std::size_t rotations_per_batch_ = 64;
+
+	// The keys around each instance's time in a rotation track, one array per component.
+	struct RotationBatch_ {
+		float starts[4][rotations_per_batch_];
+		float ends[4][rotations_per_batch_];
+		float weights[rotations_per_batch_];
+		float results[4][rotations_per_batch_];
+	};
+
+	Skeleton const& skeleton_;
+	float duration_{};
+	// Contiguous so that palettes can be multiplied in one batch per instance.
+	std::vector<glm::mat4> inverse_bind_transforms_;
+
+	std::vector<float> time_offsets_;
+	std::vector<float> playback_rates_;
+
+	std::vector<float> local_times_;
+	// Instance indices sorted by local time. The order is kept between updates since it changes little from one frame to the next.
+	std::vector<std::uint32_t> order_;
+	std::vector<float> sorted_times_;
+
+	// Indexed by bone_index*instance_count + instance_index.
+	std::vector<glm::vec3> local_scales_;
+	std::vector<glm::quat> local_rotations_;
+	std::vector<glm::vec3> local_translations_;
+
+	// Indexed by instance_index*bone_count + bone_index, so that each instance's palette is contiguous.
+	util::CacheAlignedVector<glm::mat4> global_transforms_;
+	util::CacheAlignedVector<glm::mat4> palettes_;
+
+	// Samples a track for every instance. Gives the same values as AnimationTrack::evaluate.
+	template<typename T>
+	void sample_track_(AnimationTrack<T> const& track, T const default_value, T* const values) const
+	{
+		auto const& keyframes = track.keyframes();
+		if (keyframes.empty()) {
+			std::fill_n(values, order_.size(), default_value);
+			return;
+		}
+
+		// The instances are visited in order of time, so the key cursor only moves forward.
+		auto end_key = std::size_t{};
+		for (auto const i : util::indices(order_))
+		{
+			auto const time = sorted_times_[i];
+			while (end_key != keyframes.size() && keyframes[end_key].time.count() < time) {
+				++end_key;
+			}
+
+			auto& value = values[order_[i]];
+			if (end_key == 0) {
+				value = keyframes.front().value;
+			}
+			else if (end_key == keyframes.size()) {
+				value = keyframes.back().value;
+			}
+			else {
+				value = track.evaluate_segment(end_key, Seconds{time});
+			}
+		}
+	}
+	/*
+		Linearly interpolated rotation tracks gather the keys around each time and interpolate whole batches at once.
+		Batches use nlerp unless one of their segments turns too far for it, like AnimationTrack::evaluate_segment.
+	*/
+	void sample_track_(AnimationTrack<glm::quat> const& track, glm::quat const default_value, glm::quat* const values) const
+	{
+		auto const& keyframes = track.keyframes();
+		if (keyframes.size() < 2 || track.interpolation() != Interpolation::linear) {
+			sample_track_<glm::quat>(track, default_value, values);
+			return;
+		}
+
+		auto batch = RotationBatch_{};
+		auto const batch_size = rotations_per_batch_;
+		auto end_key = std::size_t{};
+		for (auto first = std::size_t{}; first < order_.size(); first += batch_size)
+		{
+			auto const count = std::min(batch_size, order_.size() - first);
+			auto needs_slerp = false;
+			for (auto const i : util::indices(count))
+			{
+				auto const time = sorted_times_[first + i];
+				while (end_key != keyframes.size() && keyframes[end_key].time.count() < time) {
+					++end_key;
+				}
+
+				// Times outside the track hold the first or last key, as a segment from the key to itself.
+				auto const& start = keyframes[end_key == 0 ? 0 : end_key - 1];
+				auto const& end = keyframes[std::min(end_key, keyframes.size() - 1)];
+				for (auto const component : {0, 1, 2, 3}) {
+					batch.starts[component][i] = start.value[component];
+					batch.ends[component][i] = end.value[component];
+				}
+				batch.weights[i] = &start == &end ? 0.f : (time - start.time.count())/(end.time - start.time).count();
+				needs_slerp = needs_slerp || (&start != &end && track.is_slerp_segment(end_key));
+			}
+
+			auto const starts = simd::QuatArrays<float const>{batch.starts[0], batch.starts[1], batch.starts[2], batch.starts[3]};
+			auto const ends = simd::QuatArrays<float const>{batch.ends[0], batch.ends[1], batch.ends[2], batch.ends[3]};
+			auto const results = simd::QuatArrays<float>{batch.results[0], batch.results[1], batch.results[2], batch.results[3]};
+			if (needs_slerp) {
+				simd::slerp(starts, ends, batch.weights, count, results);
+			}
+			else {
+				simd::nlerp(starts, ends, batch.weights, count, results);
+			}
+
+			for (auto const i : util::indices(count)) {
+				values[order_[first + i]] = glm::quat{batch.results[3][i], batch.results[0][i], batch.results[1][i], batch.results[2][i]};
+			}
+		}
+	}
+
+	void update_instance_(std::size_t const instance)
+	{
+		auto const instance_count = this->instance_count();
+		auto const* const globals = &global_transforms_[instance*bone_count()];
+
+		for (auto const& bone : skeleton_.bones())
+		{
+			auto const component = bone.id*instance_count + instance;
+			auto const local_transform = bone.calculate_local_transform(local_scales_[component], local_rotations_[component], local_translations_[component]);
+
+			auto& global_transform = global_transforms_[instance*bone_count() + bone.id];
+			global_transform = bone.has_parent() ? globals[bone.parent] * local_transform : local_transform;
+		}
+		simd::multiply(globals, inverse_bind_transforms_.data(), bone_count(), &palettes_[instance*bone_count()]);
+	}
+
+public:
+	explicit Crowd(Skeleton const& skeleton) :
+		skeleton_{skeleton}
+	{
+		inverse_bind_transforms_.reserve(skeleton.bone_count());
+		for (auto const& bone : skeleton.bones()) {
+			duration_ = std::max({duration_, bone.scale_track.duration().count(), bone.rotation_track.duration().count(), bone.translation_track.duration().count()});
+			inverse_bind_transforms_.push_back(bone.inverse_bind_transform);
+		}
+	}
+
+	// Returns the index of the new instance.
+	std::size_t add_instance(Seconds const time_offset, float const playback_rate = 1.f)
+	{
+		auto const index = time_offsets_.size();
+		time_offsets_.push_back(time_offset.count());
+		playback_rates_.push_back(playback_rate);
+		order_.push_back(static_cast<std::uint32_t>(index));
+
+		local_times_.resize(index + 1);
+		sorted_times_.resize(index + 1);
+		local_scales_.resize(local_times_.size()*bone_count());
+		local_rotations_.resize(local_times_.size()*bone_count());
+		local_translations_.resize(local_times_.size()*bone_count());
+		global_transforms_.resize(local_times_.size()*bone_count());
+		palettes_.resize(local_times_.size()*bone_count());
+		return index;
+	}
+
+	std::size_t instance_count() const {
+		return time_offsets_.size();
+	}
+	std::size_t bone_count() const {
+		return skeleton_.bone_count();
+	}
+	Seconds duration() const {
+		return Seconds{duration_};
+	}
+
+	// The time in the clip that the instance was at in the last update.
+	Seconds local_time(std::size_t const instance) const {
+		return Seconds{local_times_[instance]};
+	}
+
+	// Advances every instance to the crowd time, looping the clip.
+	void update(Seconds const time, ThreadPool& thread_pool)
+	{
+		for (auto const i : util::indices(local_times_))
+		{
+			auto local_time = duration_ > 0.f ? std::fmod(time_offsets_[i] + time.count()*playback_rates_[i], duration_) : 0.f;
+			if (local_time < 0.f) {
+				local_time += duration_;
+			}
+			local_times_[i] = local_time;
+		}
+
+		std::sort(order_.begin(), order_.end(), [&](std::uint32_t const a, std::uint32_t const b) { return local_times_[a] < local_times_[b]; });
+		for (auto const i : util::indices(order_)) {
+			sorted_times_[i] = local_times_[order_[i]];
+		}
+
+		auto const instance_count = this->instance_count();
+
+		// Bones sample independently of each other.
+		thread_pool.parallel_for(bone_count(), [&](std::size_t const bone_index) {
+			auto const& bone = skeleton_.bones()[bone_index];
+			auto const first = bone_index*instance_count;
+			sample_track_(bone.scale_track, bone.local_bind_scale, &local_scales_[first]);
+			sample_track_(bone.rotation_track, bone.local_bind_rotation, &local_rotations_[first]);
+			sample_track_(bone.translation_track, bone.local_bind_translation, &local_translations_[first]);
+		});
+
+		auto const chunk_count = (instance_count + instances_per_chunk_ - 1)/instances_per_chunk_;
+		thread_pool.parallel_for(chunk_count, [&](std::size_t const chunk) {
+			auto const end = std::min(instance_count, (chunk + 1)*instances_per_chunk_);
+			for (auto instance = chunk*instances_per_chunk_; instance < end; ++instance) {
+				update_instance_(instance);
+			}
+		});
+	}
+
+	util::Span<glm::mat4 const> global_transforms(std::size_t const instance) const {
+		return {&global_transforms_[instance*bone_count()], bone_count()};
+	}
+	// The bone matrices to skin the instance with, equal to Bone::animation_transform for each bone.
+	util::Span<glm::mat4 const> palette(std::size_t const instance) const {
+		return {&palettes_[instance*bone_count()], bone_count()};
+	}
+};
+
+} // namespace testing
+
+#endif
@@ -7,6 +7,12 @@
 
 #include <fbxsdk.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <vector>
 
 namespace testing {
 namespace fbx {
@@ -101,6 +107,218 @@ auto layer_element_at(FbxLayerElementTemplate<T> const* const layer, int const i
 		: layer->GetDirectArray().GetAt(layer->GetIndexArray().GetAt(index)));
 }
 
+// The raw keys of an animation curve.
+struct CurveKeys {
+	std::vector<float> times;
+	std::vector<float> values;
+};
+
+inline CurveKeys read_curve_keys(FbxAnimCurve const* const curve)
+{
+	auto keys = CurveKeys{};
+	if (!curve) {
+		return keys;
+	}
+
+	auto const key_count = curve->KeyGetCount();
+	keys.times.resize(static_cast<std::size_t>(key_count));
+	keys.values.resize(static_cast<std::size_t>(key_count));
+
+	for (auto const i : util::indices(key_count)) {
+		keys.times[static_cast<std::size_t>(i)] = static_cast<float>(curve->KeyGetTime(i).GetSecondDouble());
+		keys.values[static_cast<std::size_t>(i)] = curve->KeyGetValue(i);
+	}
+	return keys;
+}
+
+// The X/Y/Z keys of a three component property, merged onto the union of the curves' key times.
+struct PropertyKeys {
+	std::vector<float> times;
+	std::array<std::vector<float>, 3> components;
+};
+
+/*
+	Keys closer than a millisecond to the earliest pending key are merged into it, like the evaluating AnimationTrack constructor does.
+	A curve without a key at a merged time is interpolated linearly between its neighbouring keys,
+	and a component without a curve takes the property's static value.
+*/
+inline PropertyKeys read_property_keys(FbxAnimLayer* const layer, FbxPropertyT<FbxDouble3>& property)
+{
+	constexpr auto merge_tolerance = 1e-3f;
+
+	auto const curves = std::array<CurveKeys, 3>{
+		read_curve_keys(property.GetCurve(layer, FBXSDK_CURVENODE_COMPONENT_X)),
+		read_curve_keys(property.GetCurve(layer, FBXSDK_CURVENODE_COMPONENT_Y)),
+		read_curve_keys(property.GetCurve(layer, FBXSDK_CURVENODE_COMPONENT_Z)),
+	};
+
+	auto keys = PropertyKeys{};
+	if (curves[0].times.empty() && curves[1].times.empty() && curves[2].times.empty()) {
+		return keys;
+	}
+
+	auto const static_value = property.Get();
+
+	auto const max_key_count = std::max({curves[0].times.size(), curves[1].times.size(), curves[2].times.size()});
+	keys.times.reserve(max_key_count);
+	for (auto& component : keys.components) {
+		component.reserve(max_key_count);
+	}
+
+	auto cursors = std::array<std::size_t, 3>{};
+	auto const is_pending = [&](std::size_t const c) { return cursors[c] < curves[c].times.size(); };
+
+	while (is_pending(0) || is_pending(1) || is_pending(2))
+	{
+		auto time = std::numeric_limits<float>::max();
+		for (auto const c : {0u, 1u, 2u}) {
+			if (is_pending(c)) {
+				time = std::min(time, curves[c].times[cursors[c]]);
+			}
+		}
+		keys.times.push_back(time);
+
+		for (auto const c : {0u, 1u, 2u})
+		{
+			auto const& curve = curves[c];
+			auto& component = keys.components[c];
+			auto& cursor = cursors[c];
+
+			if (curve.times.empty()) {
+				component.push_back(static_cast<float>(static_value.mData[c]));
+			}
+			else if (is_pending(c) && curve.times[cursor] <= time + merge_tolerance) {
+				component.push_back(curve.values[cursor++]);
+			}
+			else if (cursor == 0) {
+				component.push_back(curve.values.front());
+			}
+			else if (cursor == curve.times.size()) {
+				component.push_back(curve.values.back());
+			}
+			else {
+				component.push_back(util::map(curve.times[cursor - 1], curve.times[cursor], curve.values[cursor - 1], curve.values[cursor], time));
+			}
+		}
+	}
+
+	return keys;
+}
+
+// How a scene is brought into OpenGL's axis system on import.
+enum class SceneConversion {
+	// FbxAxisSystem::DeepConvertScene and FbxGeometryConverter::Triangulate over the whole scene.
+	sdk,
+	// A change of basis applied to the extracted arrays only, and triangulation of the meshes that are kept.
+	bulk,
+};
+
+/*
+	A change of basis from a scene's axis system to OpenGL's (Y up, Z front, right-handed), with an optional unit scale.
+	FBX axis systems only differ by signed permutations of the axes, so points and directions are converted by C,
+	matrices by M * A * M^-1 where M = scale*C, and rotations by conjugation with the proper rotation part of C.
+*/
+class CoordinateConversion {
+private:
+	glm::mat3 axes_{1.f};
+	float unit_scale_{1.f};
+
+	glm::mat4 matrix_{1.f};
+	glm::mat4 inverse_matrix_{1.f};
+	glm::quat rotation_{glm::identity<glm::quat>()};
+	bool flips_handedness_{};
+	bool is_identity_{true};
+
+public:
+	CoordinateConversion() = default;
+	CoordinateConversion(glm::mat3 const& axes, float const unit_scale) :
+		axes_{axes},
+		unit_scale_{unit_scale},
+		matrix_{glm::mat3{axes*unit_scale}},
+		inverse_matrix_{glm::mat3{glm::transpose(axes)/unit_scale}},
+		flips_handedness_{glm::determinant(axes) < 0.f},
+		is_identity_{axes == glm::mat3{1.f} && unit_scale == 1.f}
+	{
+		// The negation of a reflection is a rotation, and both conjugate rotations the same way.
+		rotation_ = glm::quat_cast(flips_handedness_ ? -axes : axes);
+	}
+
+	static CoordinateConversion to_opengl(FbxScene* const scene, float const unit_scale = 1.f)
+	{
+		auto const& axis_system = scene->GetGlobalSettings().GetAxisSystem();
+
+		auto up_sign = 0;
+		auto const up_index = static_cast<int>(axis_system.GetUpVector(up_sign)) - FbxAxisSystem::eXAxis;
+		auto front_sign = 0;
+		auto const front_parity = axis_system.GetFrontVector(front_sign);
+
+		// The front axis is the first (even parity) or second (odd parity) of the axes that aren't up.
+		auto const other_indices = up_index == 0 ? std::array<int, 2>{1, 2} : up_index == 1 ? std::array<int, 2>{0, 2} : std::array<int, 2>{0, 1};
+		auto const front_index = other_indices[front_parity == FbxAxisSystem::eParityEven ? 0 : 1];
+
+		auto up = glm::vec3{};
+		up[up_index] = static_cast<float>(up_sign);
+		auto front = glm::vec3{};
+		front[front_index] = static_cast<float>(front_sign);
+		auto const right = glm::cross(up, front)*(axis_system.GetCoorSystem() == FbxAxisSystem::eRightHanded ? 1.f : -1.f);
+
+		// The rows of the change of basis are the scene's right, up and front axes.
+		return CoordinateConversion{glm::transpose(glm::mat3{right, up, front}), unit_scale};
+	}
+
+	bool is_identity() const {
+		return is_identity_;
+	}
+	// Triangle winding has to be reversed when the handedness changes.
+	bool flips_handedness() const {
+		return flips_handedness_;
+	}
+
+	glm::mat4 const& matrix() const {
+		return matrix_;
+	}
+
+	glm::mat4 convert_matrix(glm::mat4 const& matrix) const {
+		return matrix_*matrix*inverse_matrix_;
+	}
+	glm::vec3 convert_point(glm::vec3 const point) const {
+		return axes_*point*unit_scale_;
+	}
+	glm::vec3 convert_direction(glm::vec3 const direction) const {
+		return axes_*direction;
+	}
+	glm::quat convert_rotation(glm::quat const rotation) const {
+		return rotation_*rotation*glm::conjugate(rotation_);
+	}
+
+	// These work directly on the component arrays: a signed permutation only reorders and negates them.
+	void convert_points(PropertyKeys& keys) const
+	{
+		auto const components = keys.components;
+		for (auto const row : {0, 1, 2}) {
+			for (auto const column : {0, 1, 2}) {
+				if (auto const factor = axes_[column][row]*unit_scale_) {
+					keys.components[row] = components[column];
+					for (auto& value : keys.components[row]) {
+						value *= factor;
+					}
+				}
+			}
+		}
+	}
+	void convert_scales(PropertyKeys& keys) const
+	{
+		auto const components = keys.components;
+		for (auto const row : {0, 1, 2}) {
+			for (auto const column : {0, 1, 2}) {
+				if (axes_[column][row] != 0.f) {
+					keys.components[row] = components[column];
+				}
+			}
+		}
+	}
+};
+
 inline FbxNode const* find_root_bone(FbxNode const* const root_node)
 {
 	if (auto const* const attribute = root_node->GetNodeAttribute())
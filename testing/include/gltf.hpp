@@ -0,0 +1,553 @@
+// A glTF 2.0 reader (.gltf with external or embedded buffers, and binary .glb) that doesn't need the FBX SDK.
+// Binary buffers are memory-mapped and accessors with tightly packed float data are read in place.
+
+#ifndef ANIMATION_RETARGETING_TESTING_GLTF_HPP
+#define ANIMATION_RETARGETING_TESTING_GLTF_HPP
+
+#include "json.hpp"
+#include "mapped_file.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace testing {
+namespace gltf {
+
+constexpr auto no_parent = static_cast<std::size_t>(-1);
+
+inline bool is_gltf_path(char const* const path)
+{
+	auto const ends_with = [path_length = std::strlen(path), path](char const* const extension) {
+		auto const extension_length = std::strlen(extension);
+		return path_length >= extension_length && !std::strcmp(path + path_length - extension_length, extension);
+	};
+	return ends_with(".gltf") || ends_with(".glb");
+}
+
+namespace component_type {
+	constexpr auto byte = std::uint32_t{5120};
+	constexpr auto unsigned_byte = std::uint32_t{5121};
+	constexpr auto short_ = std::uint32_t{5122};
+	constexpr auto unsigned_short = std::uint32_t{5123};
+	constexpr auto unsigned_int = std::uint32_t{5125};
+	constexpr auto float_ = std::uint32_t{5126};
+} // namespace component_type
+
+// The location and layout of an accessor's elements in a buffer.
+struct Accessor {
+	unsigned char const* data;
+	std::size_t count;
+	std::size_t stride;
+	std::size_t component_count;
+	std::uint32_t component_type;
+	bool is_normalized;
+};
+
+// A joint of a skin, with the transforms the skeleton needs.
+struct Joint {
+	std::string name;
+	// The joint's index in the skin's joint array, which is what JOINTS_n vertex attributes refer to.
+	std::size_t skin_joint;
+	std::size_t node;
+	// Index of the parent in Skin::joints, or no_parent.
+	std::size_t parent;
+	// The inverse of the joint's inverse bind matrix.
+	glm::mat4 bind_transform;
+	// The global transform of the node above a root joint, and identity for other joints.
+	glm::mat4 parent_transform;
+};
+
+struct Skin {
+	// Ordered parents first.
+	std::vector<Joint> joints;
+};
+
+template<typename T>
+struct Sampler {
+	util::Span<float const> times;
+	util::Span<T const> values;
+};
+
+namespace detail {
+
+inline std::uint32_t read_uint32(unsigned char const* const bytes)
+{
+	auto value = std::uint32_t{};
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+inline std::vector<unsigned char> decode_base64(char const* const begin, char const* const end)
+{
+	auto const decode_character = [](char const character) -> int {
+		if (character >= 'A' && character <= 'Z') return character - 'A';
+		if (character >= 'a' && character <= 'z') return character - 'a' + 26;
+		if (character >= '0' && character <= '9') return character - '0' + 52;
+		if (character == '+') return 62;
+		if (character == '/') return 63;
+		return -1;
+	};
+
+	auto bytes = std::vector<unsigned char>{};
+	bytes.reserve(static_cast<std::size_t>(end - begin)*3/4);
+
+	auto bits = 0u;
+	auto bit_count = 0;
+	for (auto const* character = begin; character != end && *character != '='; ++character)
+	{
+		auto const value = decode_character(*character);
+		if (value < 0) {
+			throw std::runtime_error{"A glTF data URI contained invalid base64."};
+		}
+		bits = (bits << 6) | static_cast<unsigned>(value);
+		bit_count += 6;
+		if (bit_count >= 8) {
+			bit_count -= 8;
+			bytes.push_back(static_cast<unsigned char>(bits >> bit_count));
+		}
+	}
+	return bytes;
+}
+
+inline std::size_t component_size(std::uint32_t const type)
+{
+	switch (type) {
+		case component_type::byte:
+		case component_type::unsigned_byte:
+			return 1;
+		case component_type::short_:
+		case component_type::unsigned_short:
+			return 2;
+		case component_type::unsigned_int:
+		case component_type::float_:
+			return 4;
+	}
+	throw std::runtime_error{"A glTF accessor had an unknown component type."};
+}
+
+inline std::size_t component_count(std::string const& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	if (type == "MAT2") return 4;
+	if (type == "MAT3") return 9;
+	if (type == "MAT4") return 16;
+	throw std::runtime_error{"A glTF accessor had an unknown type " + type + "."};
+}
+
+inline float read_float_component(unsigned char const* const bytes, std::uint32_t const type, bool const is_normalized)
+{
+	auto const read = [bytes](auto value) {
+		std::memcpy(&value, bytes, sizeof(value));
+		return value;
+	};
+	switch (type) {
+		case component_type::float_:
+			return read(float{});
+		case component_type::unsigned_byte:
+			return is_normalized ? read(std::uint8_t{})/255.f : read(std::uint8_t{});
+		case component_type::unsigned_short:
+			return is_normalized ? read(std::uint16_t{})/65535.f : read(std::uint16_t{});
+		case component_type::byte:
+			return is_normalized ? std::max(read(std::int8_t{})/127.f, -1.f) : read(std::int8_t{});
+		case component_type::short_:
+			return is_normalized ? std::max(read(std::int16_t{})/32767.f, -1.f) : read(std::int16_t{});
+		case component_type::unsigned_int:
+			return static_cast<float>(read(std::uint32_t{}));
+	}
+	throw std::runtime_error{"A glTF accessor had an unknown component type."};
+}
+
+} // namespace detail
+
+class Document {
+private:
+	json::Value root_;
+
+	// The .glb file or the external .bin files, and buffers decoded from data URIs.
+	std::vector<MappedFile> files_;
+	std::vector<std::vector<unsigned char>> decoded_buffers_;
+	std::vector<util::Span<unsigned char const>> buffers_;
+
+	std::vector<std::size_t> node_parents_;
+
+	void load_glb_(MappedFile file)
+	{
+		constexpr auto glb_magic = std::uint32_t{0x46546c67};
+		constexpr auto json_chunk = std::uint32_t{0x4e4f534a};
+		constexpr auto binary_chunk = std::uint32_t{0x004e4942};
+
+		auto const* const data = file.data();
+
+		if (file.size() < 20 || detail::read_uint32(data) != glb_magic) {
+			throw std::runtime_error{"A .glb file didn't start with a glTF header."};
+		}
+		if (detail::read_uint32(data + 4) != 2) {
+			throw std::runtime_error{"Only glTF version 2 is supported."};
+		}
+		auto const size = std::min(static_cast<std::size_t>(detail::read_uint32(data + 8)), file.size());
+
+		auto binary_buffer = util::Span<unsigned char const>{};
+
+		for (auto offset = std::size_t{12}; offset + 8 <= size;)
+		{
+			auto const chunk_size = static_cast<std::size_t>(detail::read_uint32(data + offset));
+			auto const chunk_type = detail::read_uint32(data + offset + 4);
+			auto const* const chunk = data + offset + 8;
+
+			if (offset + 8 + chunk_size > size) {
+				throw std::runtime_error{"A .glb chunk extended past the end of the file."};
+			}
+
+			if (chunk_type == json_chunk) {
+				root_ = json::parse(reinterpret_cast<char const*>(chunk), reinterpret_cast<char const*>(chunk + chunk_size));
+			}
+			else if (chunk_type == binary_chunk && binary_buffer.empty()) {
+				binary_buffer = {chunk, chunk_size};
+			}
+			// Chunks are 4-byte aligned.
+			offset += 8 + ((chunk_size + 3) & ~std::size_t{3});
+		}
+
+		files_.push_back(std::move(file));
+
+		// The binary chunk is the buffer without a URI, which has to be the first one.
+		load_buffers_(nullptr, binary_buffer);
+	}
+
+	void load_buffers_(char const* const path, util::Span<unsigned char const> const binary_buffer)
+	{
+		auto const& buffers = root_["buffers"];
+		buffers_.reserve(buffers.size());
+
+		for (auto const& buffer : buffers.elements())
+		{
+			if (!buffer.contains("uri")) {
+				buffers_.push_back(binary_buffer);
+				continue;
+			}
+
+			auto const& uri = buffer["uri"].as_string();
+			if (!uri.compare(0, 5, "data:"))
+			{
+				auto const data_start = uri.find(";base64,");
+				if (data_start == std::string::npos) {
+					throw std::runtime_error{"Only base64 glTF data URIs are supported."};
+				}
+				decoded_buffers_.push_back(detail::decode_base64(uri.data() + data_start + 8, uri.data() + uri.size()));
+				buffers_.push_back({decoded_buffers_.back().data(), decoded_buffers_.back().size()});
+			}
+			else if (path)
+			{
+				// Relative to the .gltf file. Percent-encoded URIs aren't decoded.
+				auto const path_string = std::string{path};
+				auto const directory_end = path_string.find_last_of("/\\");
+				auto const buffer_path = directory_end == std::string::npos ? uri : path_string.substr(0, directory_end + 1) + uri;
+
+				files_.emplace_back(buffer_path.c_str());
+				buffers_.push_back({files_.back().data(), files_.back().size()});
+			}
+			else {
+				throw std::runtime_error{"A .glb file referred to an external buffer."};
+			}
+
+			auto const declared_size = static_cast<std::size_t>(buffer["byteLength"].as_number());
+			if (buffers_.back().size() < declared_size) {
+				throw std::runtime_error{"A glTF buffer was smaller than its declared byte length."};
+			}
+		}
+	}
+
+	void find_node_parents_()
+	{
+		auto const& nodes = root_["nodes"];
+		node_parents_.assign(nodes.size(), no_parent);
+
+		for (auto i = std::size_t{}; i < nodes.size(); ++i) {
+			for (auto const& child : nodes[i]["children"].elements()) {
+				node_parents_.at(child.as_index()) = i;
+			}
+		}
+	}
+
+	template<typename Visitor_>
+	void visit_nodes_(std::size_t const node, Visitor_& visit) const
+	{
+		visit(node);
+		for (auto const& child : root_["nodes"][node]["children"].elements()) {
+			visit_nodes_(child.as_index(), visit);
+		}
+	}
+
+public:
+	explicit Document(char const* const path)
+	{
+		auto file = MappedFile{path};
+
+		if (file.size() >= 4 && detail::read_uint32(file.data()) == 0x46546c67) {
+			load_glb_(std::move(file));
+		}
+		else {
+			auto const* const text = reinterpret_cast<char const*>(file.data());
+			root_ = json::parse(text, text + file.size());
+			load_buffers_(path, {});
+		}
+
+		if (!root_.is_object() || root_["asset"]["version"].as_string().compare(0, 2, "2.")) {
+			throw std::runtime_error{"Only glTF version 2 is supported."};
+		}
+
+		find_node_parents_();
+	}
+
+	// The buffers point into the mapped files, so a document can't be copied.
+	Document(Document const&) = delete;
+	Document const& operator=(Document const&) = delete;
+
+	json::Value const& root() const {
+		return root_;
+	}
+
+	std::size_t node_parent(std::size_t const node) const {
+		return node_parents_.at(node);
+	}
+
+	// The node's name, with anything up to a namespace colon removed like util::trimmed_bone_name does for FBX nodes.
+	std::string node_name(std::size_t const node) const
+	{
+		auto const& name = root_["nodes"][node]["name"].as_string();
+		return name.substr(name.find(':') + 1);
+	}
+
+	glm::mat4 local_transform(std::size_t const node) const
+	{
+		auto const& value = root_["nodes"][node];
+
+		if (value.contains("matrix"))
+		{
+			auto matrix = glm::mat4{};
+			for (auto i = std::size_t{}; i < 16; ++i) {
+				glm::value_ptr(matrix)[i] = value["matrix"][i].as_float();
+			}
+			return matrix;
+		}
+
+		auto const component = [](json::Value const& array, std::size_t const index, float const default_value) {
+			return array[index].as_float(default_value);
+		};
+		auto const& t = value["translation"];
+		auto const& r = value["rotation"];
+		auto const& s = value["scale"];
+		return glm::translate(glm::mat4{1.f}, glm::vec3{component(t, 0, 0.f), component(t, 1, 0.f), component(t, 2, 0.f)}) *
+			glm::mat4_cast(glm::quat{component(r, 3, 1.f), component(r, 0, 0.f), component(r, 1, 0.f), component(r, 2, 0.f)}) *
+			glm::scale(glm::mat4{1.f}, glm::vec3{component(s, 0, 1.f), component(s, 1, 1.f), component(s, 2, 1.f)});
+	}
+
+	glm::mat4 global_transform(std::size_t const node) const
+	{
+		auto const parent = node_parent(node);
+		return parent == no_parent ? local_transform(node) : global_transform(parent)*local_transform(node);
+	}
+
+	Accessor accessor(std::size_t const index) const
+	{
+		auto const& accessor = root_["accessors"][index];
+		if (!accessor.is_object()) {
+			throw std::runtime_error{"A glTF accessor index was out of range."};
+		}
+		if (accessor.contains("sparse")) {
+			throw std::runtime_error{"Sparse glTF accessors aren't supported."};
+		}
+
+		auto result = Accessor{};
+		result.count = accessor["count"].as_index();
+		result.component_type = static_cast<std::uint32_t>(accessor["componentType"].as_index());
+		result.component_count = detail::component_count(accessor["type"].as_string());
+		result.is_normalized = accessor["normalized"].as_boolean();
+
+		auto const element_size = detail::component_size(result.component_type)*result.component_count;
+
+		auto const& view = root_["bufferViews"][accessor["bufferView"].as_index()];
+		auto const buffer = buffers_.at(view["buffer"].as_index());
+		auto const offset = static_cast<std::size_t>(view["byteOffset"].as_number() + accessor["byteOffset"].as_number());
+
+		result.stride = view.contains("byteStride") ? view["byteStride"].as_index() : element_size;
+		result.data = buffer.data() + offset;
+
+		if (result.count && offset + (result.count - 1)*result.stride + element_size > buffer.size()) {
+			throw std::runtime_error{"A glTF accessor extended past the end of its buffer."};
+		}
+		return result;
+	}
+
+	// Reads an accessor as floats (or vectors or matrices of floats), converting integer and normalized components.
+	// Tightly packed float data is returned in place, anything else is converted into the storage.
+	template<typename T>
+	util::Span<T const> read(std::size_t const accessor_index, std::vector<T>& storage) const
+	{
+		static_assert(sizeof(T) % sizeof(float) == 0 && std::is_trivially_copyable<T>::value, "Accessors are read as arrays of floats.");
+		constexpr auto components = sizeof(T)/sizeof(float);
+
+		auto const source = accessor(accessor_index);
+		if (source.component_count != components) {
+			throw std::runtime_error{"A glTF accessor had an unexpected type."};
+		}
+
+		if (source.component_type == component_type::float_ && source.stride == sizeof(T) &&
+			reinterpret_cast<std::uintptr_t>(source.data) % alignof(T) == 0)
+		{
+			return {reinterpret_cast<T const*>(source.data), source.count};
+		}
+
+		storage.resize(source.count);
+		auto const component_size = detail::component_size(source.component_type);
+		for (auto i = std::size_t{}; i < source.count; ++i)
+		{
+			auto* const element = reinterpret_cast<float*>(&storage[i]);
+			for (auto j = std::size_t{}; j < components; ++j) {
+				element[j] = detail::read_float_component(source.data + i*source.stride + j*component_size, source.component_type, source.is_normalized);
+			}
+		}
+		return {storage.data(), storage.size()};
+	}
+
+	// Reads an accessor with unsigned integer components, such as indices or joints, into a flat array.
+	std::vector<std::uint32_t> read_unsigned(std::size_t const accessor_index) const
+	{
+		auto const source = accessor(accessor_index);
+		auto const component_size = detail::component_size(source.component_type);
+
+		auto values = std::vector<std::uint32_t>(source.count*source.component_count);
+		for (auto i = std::size_t{}; i < source.count; ++i) {
+			for (auto j = std::size_t{}; j < source.component_count; ++j)
+			{
+				auto const* const bytes = source.data + i*source.stride + j*component_size;
+				auto& value = values[i*source.component_count + j];
+				switch (source.component_type) {
+					case component_type::unsigned_byte: value = *bytes; break;
+					case component_type::unsigned_short: { auto v = std::uint16_t{}; std::memcpy(&v, bytes, 2); value = v; break; }
+					case component_type::unsigned_int: std::memcpy(&value, bytes, 4); break;
+					default: throw std::runtime_error{"A glTF accessor was expected to have unsigned integer components."};
+				}
+			}
+		}
+		return values;
+	}
+
+	/*
+		Reads the keyframes of an animation sampler. Step interpolation is read as linear,
+		and cubic spline samplers keep only their values, leaving out the tangents.
+		Rotations are stored as x, y, z, w, which is converted to glm::quat.
+	*/
+	template<typename T>
+	Sampler<T> read_sampler(json::Value const& sampler, std::vector<float>& time_storage, std::vector<T>& value_storage) const
+	{
+		auto result = Sampler<T>{};
+		result.times = read(sampler["input"].as_index(), time_storage);
+
+		auto const is_cubic = sampler["interpolation"].as_string() == "CUBICSPLINE";
+
+		if constexpr (std::is_same<T, glm::quat>::value)
+		{
+			auto vector_storage = std::vector<glm::vec4>{};
+			auto const vectors = read(sampler["output"].as_index(), vector_storage);
+			value_storage.resize(result.times.size());
+			for (auto i = std::size_t{}; i < value_storage.size(); ++i) {
+				auto const vector = vectors[is_cubic ? i*3 + 1 : i];
+				value_storage[i] = glm::normalize(glm::quat{vector.w, vector.x, vector.y, vector.z});
+			}
+			result.values = {value_storage.data(), value_storage.size()};
+		}
+		else
+		{
+			result.values = read(sampler["output"].as_index(), value_storage);
+			if (is_cubic) {
+				auto values = std::vector<T>(result.times.size());
+				for (auto i = std::size_t{}; i < values.size(); ++i) {
+					values[i] = result.values[i*3 + 1];
+				}
+				value_storage = std::move(values);
+				result.values = {value_storage.data(), value_storage.size()};
+			}
+		}
+
+		if (result.values.size() < result.times.size()) {
+			throw std::runtime_error{"A glTF animation sampler had fewer values than keyframes."};
+		}
+		result.values = {result.values.data(), result.times.size()};
+		return result;
+	}
+
+	// Collects a skin's joints in scene order, which puts parents before their children.
+	Skin skin(std::size_t const index) const
+	{
+		auto const& skin = root_["skins"][index];
+		if (!skin.is_object()) {
+			throw std::runtime_error{"A glTF skin index was out of range."};
+		}
+
+		auto const& joint_nodes = skin["joints"];
+
+		auto inverse_bind_storage = std::vector<glm::mat4>{};
+		auto const inverse_bind_matrices = skin.contains("inverseBindMatrices") ?
+			read(skin["inverseBindMatrices"].as_index(), inverse_bind_storage) : util::Span<glm::mat4 const>{};
+
+		// The skin joint index of every node, or no_parent for nodes that aren't joints.
+		auto node_joints = std::vector<std::size_t>(node_parents_.size(), no_parent);
+		for (auto i = std::size_t{}; i < joint_nodes.size(); ++i) {
+			node_joints.at(joint_nodes[i].as_index()) = i;
+		}
+
+		auto result = Skin{};
+		result.joints.reserve(joint_nodes.size());
+
+		// The index in result.joints of each node's closest joint ancestor (or itself).
+		auto node_joint_indices = std::vector<std::size_t>(node_parents_.size(), no_parent);
+
+		auto visit = [&](std::size_t const node)
+		{
+			auto const parent_node = node_parents_[node];
+			auto const parent = parent_node == no_parent ? no_parent : node_joint_indices[parent_node];
+
+			if (node_joints[node] == no_parent) {
+				node_joint_indices[node] = parent;
+				return;
+			}
+
+			auto const skin_joint = node_joints[node];
+			node_joint_indices[node] = result.joints.size();
+			result.joints.push_back(Joint{
+				node_name(node),
+				skin_joint,
+				node,
+				parent,
+				skin_joint < inverse_bind_matrices.size() ? glm::inverse(inverse_bind_matrices[skin_joint]) : glm::mat4{1.f},
+				parent == no_parent && parent_node != no_parent ? global_transform(parent_node) : glm::mat4{1.f},
+			});
+		};
+
+		for (auto node = std::size_t{}; node < node_parents_.size(); ++node) {
+			if (node_parents_[node] == no_parent) {
+				visit_nodes_(node, visit);
+			}
+		}
+		return result;
+	}
+};
+
+} // namespace gltf
+} // namespace testing
+
+#endif
@@ -0,0 +1,321 @@
+// A small JSON reader, enough for asset formats such as glTF.
+
+#ifndef ANIMATION_RETARGETING_TESTING_JSON_HPP
+#define ANIMATION_RETARGETING_TESTING_JSON_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace testing {
+namespace json {
+
+enum class Type {
+	null,
+	boolean,
+	number,
+	string,
+	array,
+	object,
+};
+
+class Value {
+private:
+	friend class Parser;
+
+	Type type_{Type::null};
+	bool boolean_{};
+	double number_{};
+	std::string string_;
+	std::vector<Value> elements_;
+	// Object members keep the order they were written in. Lookups are linear, which is fine for the small objects in asset files.
+	std::vector<std::pair<std::string, Value>> members_;
+
+	static Value const& null_() {
+		static auto const null = Value{};
+		return null;
+	}
+
+public:
+	Type type() const {
+		return type_;
+	}
+	bool is_null() const {
+		return type_ == Type::null;
+	}
+	bool is_array() const {
+		return type_ == Type::array;
+	}
+	bool is_object() const {
+		return type_ == Type::object;
+	}
+
+	// Missing members and out of range elements are null.
+	Value const& operator[](char const* const name) const
+	{
+		for (auto const& member : members_) {
+			if (member.first == name) {
+				return member.second;
+			}
+		}
+		return null_();
+	}
+	Value const& operator[](std::size_t const index) const {
+		return index < elements_.size() ? elements_[index] : null_();
+	}
+	// Keeps literal indices like value[0] from being ambiguous with the member lookup.
+	Value const& operator[](int const index) const {
+		return (*this)[static_cast<std::size_t>(index)];
+	}
+	bool contains(char const* const name) const {
+		return !(*this)[name].is_null();
+	}
+
+	std::size_t size() const {
+		return type_ == Type::array ? elements_.size() : members_.size();
+	}
+	std::vector<Value> const& elements() const {
+		return elements_;
+	}
+	std::vector<std::pair<std::string, Value>> const& members() const {
+		return members_;
+	}
+
+	bool as_boolean(bool const default_value = false) const {
+		return type_ == Type::boolean ? boolean_ : default_value;
+	}
+	double as_number(double const default_value = 0) const {
+		return type_ == Type::number ? number_ : default_value;
+	}
+	float as_float(float const default_value = 0.f) const {
+		return type_ == Type::number ? static_cast<float>(number_) : default_value;
+	}
+	std::size_t as_index() const
+	{
+		if (type_ != Type::number || number_ < 0) {
+			throw std::runtime_error{"A JSON value was expected to be an index."};
+		}
+		return static_cast<std::size_t>(number_);
+	}
+	std::string const& as_string() const {
+		return string_;
+	}
+};
+
+class Parser {
+private:
+	char const* position_;
+	char const* end_;
+
+	[[noreturn]] void fail_(char const* const message) const {
+		throw std::runtime_error{std::string{"Invalid JSON: "} + message + "."};
+	}
+
+	void skip_whitespace_() {
+		while (position_ != end_ && (*position_ == ' ' || *position_ == '\t' || *position_ == '\n' || *position_ == '\r')) {
+			++position_;
+		}
+	}
+
+	char next_()
+	{
+		skip_whitespace_();
+		if (position_ == end_) {
+			fail_("unexpected end of input");
+		}
+		return *position_;
+	}
+
+	void expect_(char const character)
+	{
+		if (next_() != character) {
+			fail_("unexpected character");
+		}
+		++position_;
+	}
+
+	void expect_word_(char const* const word)
+	{
+		auto const length = std::strlen(word);
+		if (static_cast<std::size_t>(end_ - position_) < length || std::strncmp(position_, word, length)) {
+			fail_("unknown literal");
+		}
+		position_ += length;
+	}
+
+	void append_utf8_(std::string& string, unsigned long const code_point)
+	{
+		if (code_point < 0x80) {
+			string += static_cast<char>(code_point);
+		}
+		else if (code_point < 0x800) {
+			string += static_cast<char>(0xc0 | (code_point >> 6));
+			string += static_cast<char>(0x80 | (code_point & 0x3f));
+		}
+		else if (code_point < 0x10000) {
+			string += static_cast<char>(0xe0 | (code_point >> 12));
+			string += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+			string += static_cast<char>(0x80 | (code_point & 0x3f));
+		}
+		else {
+			string += static_cast<char>(0xf0 | (code_point >> 18));
+			string += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+			string += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+			string += static_cast<char>(0x80 | (code_point & 0x3f));
+		}
+	}
+
+	unsigned long parse_hex_4_()
+	{
+		if (end_ - position_ < 4) {
+			fail_("truncated unicode escape");
+		}
+		auto const digits = std::string{position_, 4};
+		position_ += 4;
+		return std::strtoul(digits.c_str(), nullptr, 16);
+	}
+
+	std::string parse_string_()
+	{
+		expect_('"');
+
+		auto string = std::string{};
+		while (true)
+		{
+			if (position_ == end_) {
+				fail_("unterminated string");
+			}
+			auto const character = *position_++;
+			if (character == '"') {
+				return string;
+			}
+			if (character != '\\') {
+				string += character;
+				continue;
+			}
+			if (position_ == end_) {
+				fail_("unterminated escape sequence");
+			}
+			switch (auto const escaped = *position_++) {
+				case 'b': string += '\b'; break;
+				case 'f': string += '\f'; break;
+				case 'n': string += '\n'; break;
+				case 'r': string += '\r'; break;
+				case 't': string += '\t'; break;
+				case 'u': {
+					auto code_point = parse_hex_4_();
+					// Surrogate pairs encode code points outside the basic multilingual plane.
+					if (code_point >= 0xd800 && code_point < 0xdc00 && end_ - position_ >= 6 && position_[0] == '\\' && position_[1] == 'u') {
+						position_ += 2;
+						code_point = 0x10000 + ((code_point - 0xd800) << 10) + (parse_hex_4_() - 0xdc00);
+					}
+					append_utf8_(string, code_point);
+					break;
+				}
+				default: string += escaped; break;
+			}
+		}
+	}
+
+	Value parse_value_()
+	{
+		auto value = Value{};
+
+		switch (next_()) {
+			case '{': {
+				++position_;
+				value.type_ = Type::object;
+				if (next_() == '}') {
+					++position_;
+					break;
+				}
+				while (true) {
+					auto name = parse_string_();
+					expect_(':');
+					value.members_.emplace_back(std::move(name), parse_value_());
+					if (next_() != ',') {
+						break;
+					}
+					++position_;
+				}
+				expect_('}');
+				break;
+			}
+			case '[': {
+				++position_;
+				value.type_ = Type::array;
+				if (next_() == ']') {
+					++position_;
+					break;
+				}
+				while (true) {
+					value.elements_.push_back(parse_value_());
+					if (next_() != ',') {
+						break;
+					}
+					++position_;
+				}
+				expect_(']');
+				break;
+			}
+			case '"':
+				value.type_ = Type::string;
+				value.string_ = parse_string_();
+				break;
+			case 't':
+				expect_word_("true");
+				value.type_ = Type::boolean;
+				value.boolean_ = true;
+				break;
+			case 'f':
+				expect_word_("false");
+				value.type_ = Type::boolean;
+				break;
+			case 'n':
+				expect_word_("null");
+				break;
+			default: {
+				// strtod stops at the end of the number. The input isn't null terminated, so the number is copied first.
+				auto const* number_end = position_;
+				while (number_end != end_ && *number_end && std::strchr("+-.0123456789eE", *number_end)) {
+					++number_end;
+				}
+				if (number_end == position_) {
+					fail_("unexpected character");
+				}
+				value.type_ = Type::number;
+				value.number_ = std::strtod(std::string{position_, number_end}.c_str(), nullptr);
+				position_ = number_end;
+				break;
+			}
+		}
+		return value;
+	}
+
+public:
+	Parser(char const* const begin, char const* const end) :
+		position_{begin}, end_{end}
+	{}
+
+	Value parse()
+	{
+		auto value = parse_value_();
+		skip_whitespace_();
+		if (position_ != end_ && *position_ != '\0') {
+			fail_("trailing characters after the document");
+		}
+		return value;
+	}
+};
+
+inline Value parse(char const* const begin, char const* const end) {
+	return Parser{begin, end}.parse();
+}
+
+} // namespace json
+} // namespace testing
+
+#endif
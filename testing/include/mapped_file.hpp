@@ -0,0 +1,207 @@
+// Read-only memory-mapped files and views into them.
+
+#ifndef ANIMATION_RETARGETING_TESTING_MAPPED_FILE_HPP
+#define ANIMATION_RETARGETING_TESTING_MAPPED_FILE_HPP
+
+#ifdef _WIN32
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+namespace testing {
+
+namespace util {
+
+// A non-owning view of a contiguous array.
+template<typename T>
+class Span {
+private:
+	T* data_{};
+	std::size_t size_{};
+
+public:
+	constexpr Span() = default;
+	constexpr Span(T* const data, std::size_t const size) :
+		data_{data}, size_{size}
+	{}
+
+	constexpr T* data() const {
+		return data_;
+	}
+	constexpr std::size_t size() const {
+		return size_;
+	}
+	constexpr bool empty() const {
+		return !size_;
+	}
+
+	constexpr T& operator[](std::size_t const index) const {
+		assert(index < size_);
+		return data_[index];
+	}
+
+	constexpr T& front() const {
+		assert(size_);
+		return data_[0];
+	}
+	constexpr T& back() const {
+		assert(size_);
+		return data_[size_ - 1];
+	}
+
+	constexpr T* begin() const {
+		return data_;
+	}
+	constexpr T* end() const {
+		return data_ + size_;
+	}
+};
+
+} // namespace util
+
+class MappedFile {
+private:
+	void const* data_{};
+	std::size_t size_{};
+
+#ifdef _WIN32
+	HANDLE file_{INVALID_HANDLE_VALUE};
+	HANDLE mapping_{};
+#endif
+
+	void unmap_()
+	{
+#ifdef _WIN32
+		if (data_) {
+			UnmapViewOfFile(data_);
+		}
+		if (mapping_) {
+			CloseHandle(mapping_);
+		}
+		if (file_ != INVALID_HANDLE_VALUE) {
+			CloseHandle(file_);
+		}
+		file_ = INVALID_HANDLE_VALUE;
+		mapping_ = nullptr;
+#else
+		if (data_) {
+			munmap(const_cast<void*>(data_), size_);
+		}
+#endif
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+public:
+	MappedFile() = default;
+	explicit MappedFile(char const* const path)
+	{
+#ifdef _WIN32
+		file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error{"Failed to open file " + std::string{path} + "."};
+		}
+
+		auto size = LARGE_INTEGER{};
+		GetFileSizeEx(file_, &size);
+		size_ = static_cast<std::size_t>(size.QuadPart);
+
+		if (size_) {
+			mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			data_ = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			if (!data_) {
+				unmap_();
+				throw std::runtime_error{"Failed to memory-map file " + std::string{path} + "."};
+			}
+		}
+#else
+		auto const file = open(path, O_RDONLY);
+		if (file < 0) {
+			throw std::runtime_error{"Failed to open file " + std::string{path} + "."};
+		}
+
+		struct stat status;
+		if (fstat(file, &status) != 0) {
+			close(file);
+			throw std::runtime_error{"Failed to read the size of file " + std::string{path} + "."};
+		}
+		size_ = static_cast<std::size_t>(status.st_size);
+
+		if (size_) {
+			auto* const data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+			if (data == MAP_FAILED) {
+				close(file);
+				throw std::runtime_error{"Failed to memory-map file " + std::string{path} + "."};
+			}
+			data_ = data;
+		}
+
+		// The mapping stays valid after the descriptor is closed.
+		close(file);
+#endif
+	}
+	~MappedFile() {
+		unmap_();
+	}
+
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	MappedFile(MappedFile&& other) :
+		data_{other.data_}, size_{other.size_}
+#ifdef _WIN32
+		, file_{other.file_}, mapping_{other.mapping_}
+#endif
+	{
+		other.data_ = nullptr;
+		other.size_ = 0;
+#ifdef _WIN32
+		other.file_ = INVALID_HANDLE_VALUE;
+		other.mapping_ = nullptr;
+#endif
+	}
+	MappedFile& operator=(MappedFile&& other)
+	{
+		if (this == &other) {
+			return *this;
+		}
+		unmap_();
+		data_ = other.data_;
+		size_ = other.size_;
+		other.data_ = nullptr;
+		other.size_ = 0;
+#ifdef _WIN32
+		file_ = other.file_;
+		mapping_ = other.mapping_;
+		other.file_ = INVALID_HANDLE_VALUE;
+		other.mapping_ = nullptr;
+#endif
+		return *this;
+	}
+
+	unsigned char const* data() const {
+		return static_cast<unsigned char const*>(data_);
+	}
+	std::size_t size() const {
+		return size_;
+	}
+};
+
+} // namespace testing
+
+#endif
@@ -1,12 +1,26 @@
 #ifndef ANIMATION_RETARGETING_TESTING_MODEL_HPP
 #define ANIMATION_RETARGETING_TESTING_MODEL_HPP
 
-#include "fbx.hpp"
+#include "arena.hpp"
+#include "bounds.hpp"
+#include "cooked.hpp"
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+#	include "fbx.hpp"
+#endif
+#include "gltf.hpp"
+#include "simd.hpp"
 #include "skeleton.hpp"
 #include "texture.hpp"
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
 namespace testing {
 
 struct Vertex {
@@ -18,87 +32,209 @@ struct Vertex {
 	std::array<Bone::Id, max_bone_influence> bone_ids{};
 	std::array<float, max_bone_influence> bone_weights{};
 
+	// When there are more influences than fit, the weakest one is replaced.
 	void add_bone(Bone::Id const id, float const weight)
 	{
 		if (weight < 0.02f) {
 			return;
 		}
+		auto const weakest = static_cast<std::size_t>(std::min_element(bone_weights.begin(), bone_weights.end()) - bone_weights.begin());
+		if (bone_weights[weakest] < weight) {
+			bone_ids[weakest] = id;
+			bone_weights[weakest] = weight;
+		}
+	}
+
+	// Keeps the strongest influences, sorted strongest first, and scales the weights to add up to one.
+	void prune_bone_influences(std::size_t const influence_count)
+	{
+		auto order = std::array<std::size_t, max_bone_influence>{};
+		std::iota(order.begin(), order.end(), std::size_t{});
+		std::sort(order.begin(), order.end(), [&](std::size_t const a, std::size_t const b) { return bone_weights[a] > bone_weights[b]; });
+
+		auto const ids = bone_ids;
+		auto const weights = bone_weights;
+		auto weight_sum = 0.f;
 		for (auto const i : util::indices(max_bone_influence)) {
-			if (bone_weights[i] == 0.f) {
-				bone_ids[i] = id;
-				bone_weights[i] = weight;
-				return;
+			bone_ids[i] = i < influence_count ? ids[order[i]] : Bone::Id{};
+			bone_weights[i] = i < influence_count ? weights[order[i]] : 0.f;
+			weight_sum += bone_weights[i];
+		}
+		if (weight_sum > 0.f) {
+			for (auto& weight : bone_weights) {
+				weight /= weight_sum;
 			}
 		}
-		fmt::print("Too many bone influences!!! Tried to add weight {}\n", weight);
+	}
+
+	// The number of influences with at least the given fraction of the total weight.
+	std::size_t significant_bone_influence_count(float const minimum_weight) const
+	{
+		auto const weight_sum = std::accumulate(bone_weights.begin(), bone_weights.end(), 0.f);
+		return static_cast<std::size_t>(std::count_if(bone_weights.begin(), bone_weights.end(), 
+			[&](float const weight) { return weight > 0.f && weight >= minimum_weight*weight_sum; }));
 	}
 };
 
+// A mesh's data on the CPU side, before it is uploaded or cooked. The arrays are in the import's arena if it had one.
+struct MeshData {
+	using Vertices = std::vector<Vertex, util::ArenaAllocator<Vertex>>;
+	using Indices = std::vector<GLuint, util::ArenaAllocator<GLuint>>;
+
+	Vertices vertices;
+	Indices indices;
+};
+
+/*
+	The numbers of bone influences that meshes can be skinned with. Each has its own vertex layout and shader.
+	The layouts store one weight less than influences, since the weights add up to one.
+*/
+constexpr std::array<std::size_t, 3> bone_influence_variants{1, 2, 4};
+
+// Influences with less weight than this, relative to the vertex's total, don't count when choosing the variants a mesh needs.
+constexpr auto negligible_bone_weight = 0.01f;
+
+// The size in bytes of a vertex in the variant's layout.
+constexpr std::size_t skinned_vertex_size(std::size_t const influence_count) {
+	return 8*sizeof(float) + influence_count*sizeof(Bone::Id) + (influence_count - 1)*sizeof(float);
+}
+
+// The index of the variant with the fewest influences that the vertices need.
+inline std::size_t required_bone_influence_variant(util::Span<Vertex const> const vertices)
+{
+	auto influence_count = std::size_t{1};
+	for (auto const& vertex : vertices) {
+		influence_count = std::max(influence_count, vertex.significant_bone_influence_count(negligible_bone_weight));
+	}
+	return static_cast<std::size_t>(std::find_if(bone_influence_variants.begin(), bone_influence_variants.end(), 
+		[&](std::size_t const variant) { return variant >= influence_count; }) - bone_influence_variants.begin());
+}
+
+// Packs the vertices in the variant's layout, with their influences pruned to the variant's count.
+inline std::vector<unsigned char> pack_skinned_vertices(util::Span<Vertex const> const vertices, std::size_t const influence_count)
+{
+	auto const vertex_size = skinned_vertex_size(influence_count);
+	auto bytes = std::vector<unsigned char>(vertices.size()*vertex_size);
+
+	auto* destination = bytes.data();
+	for (auto vertex : vertices)
+	{
+		vertex.prune_bone_influences(influence_count);
+
+		auto const write = [&](void const* const source, std::size_t const size) {
+			std::memcpy(destination, source, size);
+			destination += size;
+		};
+		write(&vertex.position, sizeof(vertex.position));
+		write(&vertex.normal, sizeof(vertex.normal));
+		write(&vertex.texture_coordinates, sizeof(vertex.texture_coordinates));
+		write(vertex.bone_ids.data(), influence_count*sizeof(Bone::Id));
+		write(vertex.bone_weights.data(), (influence_count - 1)*sizeof(float));
+	}
+	return bytes;
+}
+
 class Mesh {
 private:
+	struct Variant_ {
+		GLuint vao;
+		GLuint vbo;
+	};
+
 	GLsizei index_count_;
 	GLuint texture_id_;
 
-	GLuint vao_;
-	GLuint vbo_;
 	GLuint ebo_;
+	// Vertex buffers for the variants up to the one the mesh's weights need.
+	std::array<Variant_, bone_influence_variants.size()> variants_{};
+	std::size_t variant_count_;
 
-	void create_gpu_buffers_(std::vector<Vertex> const& vertices, std::vector<GLuint> const& indices)
+	void create_gpu_buffers_(util::Span<Vertex const> const vertices, util::Span<GLuint const> const indices)
 	{        
-		glGenVertexArrays(1, &vao_);
-		glBindVertexArray(vao_);
-
-		// Vertices.
-		glGenBuffers(1, &vbo_);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-		glBufferData(GL_ARRAY_BUFFER, util::vector_byte_size(vertices), vertices.data(), GL_STATIC_DRAW);
-
-		// Vertex indices.
+		// Vertex indices, shared by the variants.
 		glGenBuffers(1, &ebo_);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, util::vector_byte_size(indices), indices.data(), GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size()*sizeof(GLuint)), indices.data(), GL_STATIC_DRAW);
+
+		for (auto const i : util::indices(variant_count_))
+		{
+			auto& variant = variants_[i];
+			glGenVertexArrays(1, &variant.vao);
+			glBindVertexArray(variant.vao);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+
+			// Vertices.
+			auto const bytes = pack_skinned_vertices(vertices, bone_influence_variants[i]);
+			glGenBuffers(1, &variant.vbo);
+			glBindBuffer(GL_ARRAY_BUFFER, variant.vbo);
+			glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bytes.size()), bytes.data(), GL_STATIC_DRAW);
+
+			set_vertex_attributes_(bone_influence_variants[i]);
+		}
 	}
 
-	void set_vertex_attributes_()
+	void set_vertex_attributes_(std::size_t const influence_count)
 	{
+		auto const stride = static_cast<GLsizei>(skinned_vertex_size(influence_count));
+		auto const offset = [](std::size_t const float_count) {
+			return reinterpret_cast<void const*>(float_count*sizeof(float));
+		};
+
 		// Vertex positions.
 		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
 
 		// Vertex normals.
 		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void const*>(offsetof(Vertex, normal)));
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, offset(3));
 
 		// Vertex texture coordinates.
 		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void const*>(offsetof(Vertex, texture_coordinates)));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, offset(6));
 
 		// Influencing bone IDs.
 		glEnableVertexAttribArray(3);
-		glVertexAttribIPointer(3, Vertex::max_bone_influence, GL_UNSIGNED_INT, sizeof(Vertex), reinterpret_cast<void const*>(offsetof(Vertex, bone_ids)));
+		glVertexAttribIPointer(3, static_cast<GLint>(influence_count), GL_UNSIGNED_INT, stride, offset(8));
 		static_assert(std::is_same<Bone::Id, GLuint>::value);
 
-		// Influencing bone weights.
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, Vertex::max_bone_influence, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void const*>(offsetof(Vertex, bone_weights)));
+		// Influencing bone weights, except the last one.
+		if (influence_count > 1) {
+			glEnableVertexAttribArray(4);
+			glVertexAttribPointer(4, static_cast<GLint>(influence_count - 1), GL_FLOAT, GL_FALSE, stride, offset(8 + influence_count));
+		}
 	}
 
 public:
-	Mesh(std::vector<Vertex> const& vertices, std::vector<GLuint> const& indices, GLuint const texture_id) :
-		index_count_{static_cast<GLsizei>(indices.size())}, texture_id_{texture_id}
+	Mesh(util::Span<Vertex const> const vertices, util::Span<GLuint const> const indices, GLuint const texture_id) :
+		index_count_{static_cast<GLsizei>(indices.size())}, 
+		texture_id_{texture_id},
+		variant_count_{required_bone_influence_variant(vertices) + 1}
 	{
 		create_gpu_buffers_(vertices, indices);
-		set_vertex_attributes_();
+	}
+	Mesh(std::vector<Vertex> const& vertices, std::vector<GLuint> const& indices, GLuint const texture_id) :
+		Mesh{{vertices.data(), vertices.size()}, {indices.data(), indices.size()}, texture_id}
+	{}
+
+	// The index of the variant to draw with when skinning is limited to a number of influences.
+	std::size_t choose_variant(std::size_t const max_influence_count) const
+	{
+		auto variant = std::size_t{};
+		while (variant + 1 < variant_count_ && bone_influence_variants[variant + 1] <= max_influence_count) {
+			++variant;
+		}
+		return variant;
 	}
 
-	void draw() const 
+	// The shader for the variant has to be in use.
+	void draw(std::size_t const variant) const 
 	{
 		if (texture_id_) {
 			glActiveTexture(GL_TEXTURE0);
 			glBindTexture(GL_TEXTURE_2D, texture_id_);
 		}
 
-		glBindVertexArray(vao_);
+		glBindVertexArray(variants_[variant].vao);
 		glDrawElements(GL_TRIANGLES, index_count_, GL_UNSIGNED_INT, nullptr);
 	}
 };
@@ -108,7 +244,28 @@ private:
 	std::vector<Mesh> meshes_;
 	Texture texture_;
 	Skeleton skeleton_;
+	// The bounds of each bone's skinned vertices in the bind pose, indexed by bone id.
+	std::vector<Aabb> bone_vertex_bounds_;
+
+	void add_mesh_(util::Span<Vertex const> const vertices, util::Span<GLuint const> const indices)
+	{
+		meshes_.emplace_back(vertices, indices, texture_.id());
+		add_bone_vertex_bounds_(vertices);
+	}
+
+	void add_bone_vertex_bounds_(util::Span<Vertex const> const vertices)
+	{
+		bone_vertex_bounds_.resize(skeleton_.bone_count());
+		for (auto const& vertex : vertices) {
+			for (auto const i : util::indices(Vertex::max_bone_influence)) {
+				if (vertex.bone_weights[i] > 0.f && vertex.bone_ids[i] < bone_vertex_bounds_.size()) {
+					bone_vertex_bounds_[vertex.bone_ids[i]].add(vertex.position);
+				}
+			}
+		}
+	}
 
+#ifdef ANIMATION_RETARGETING_FBX_SDK
 	void set_bone_bind_transform_from_cluster(Bone::Id const bone_id, FbxCluster const* const cluster) 
 	{
 		auto* const bone = skeleton_.bone_by_id(bone_id);
@@ -119,7 +276,7 @@ private:
 		bone->bind_transform = util::fbx_to_glm(bind_matrix);
 	}
 
-	void connect_bones_to_vertices_(FbxMesh const* const mesh, std::vector<Vertex>& vertices)
+	void connect_bones_to_vertices_(FbxMesh const* const mesh, util::Span<Vertex> const vertices)
 	{
 		auto const* const skin = static_cast<FbxSkin const*>(mesh->GetDeformer(0, FbxDeformer::eSkin));
 
@@ -135,6 +292,10 @@ private:
 			}
 
 			auto const bone_id = skeleton_.bone_id_by_name(name.c_str());
+			// The cluster is linked to a node that isn't in the skeleton, so its influences are dropped.
+			if (bone_id == skeleton_.bone_count()) {
+				continue;
+			}
 
 			set_bone_bind_transform_from_cluster(bone_id, cluster);
 
@@ -149,65 +310,82 @@ private:
 		}
 	}
 
-	void load_mesh_(FbxMesh const* const mesh)
+	void load_mesh_(FbxMesh const* const mesh, fbx::CoordinateConversion const& conversion, std::vector<MeshData>& meshes, util::Arena* const arena)
 	{
-		auto const transform = util::fbx_to_glm(mesh->GetNode()->EvaluateGlobalTransform());
+		auto const transform = conversion.matrix()*util::fbx_to_glm(mesh->GetNode()->EvaluateGlobalTransform());
 		
-		auto const* const vertices_source = mesh->GetControlPoints();
-
 		auto const* const normal_layer = mesh->GetElementNormal();
 		auto const* const uv_layer = mesh->GetElementUV();
 		
-		auto vertices = std::vector<Vertex>(mesh->GetControlPointsCount());
+		auto mesh_data = MeshData{
+			MeshData::Vertices(static_cast<std::size_t>(mesh->GetControlPointsCount()), util::ArenaAllocator<Vertex>{arena}),
+			MeshData::Indices(util::ArenaAllocator<GLuint>{arena}),
+		};
+		auto& vertices = mesh_data.vertices;
 
-		for (auto const i : util::indices(vertices))
-		{
-			vertices[i].position = transform*glm::vec4{fbx::to_glm_vec(vertices_source[i]), 1.f};
+		simd::transform_points(mesh->GetControlPoints()->mData, vertices.size(), transform, &vertices.data()->position, sizeof(Vertex));
 
-			if (normal_layer->GetMappingMode() == FbxLayerElement::EMappingMode::eByControlPoint)
+		auto const set_vertex_attributes = [&](std::size_t const vertex_index, int const layer_index, FbxLayerElement::EMappingMode const mapping_mode) 
+		{
+			if (normal_layer->GetMappingMode() == mapping_mode)
 			{
-				vertices[i].normal = fbx::layer_element_at(normal_layer, static_cast<int>(i));
+				vertices[vertex_index].normal = conversion.convert_direction(fbx::layer_element_at(normal_layer, layer_index));
 			}
 			
-			if (uv_layer->GetMappingMode() == FbxLayerElement::EMappingMode::eByControlPoint)
+			if (uv_layer->GetMappingMode() == mapping_mode)
 			{
-				vertices[i].texture_coordinates = fbx::layer_element_at(uv_layer, static_cast<int>(i));
+				vertices[vertex_index].texture_coordinates = fbx::layer_element_at(uv_layer, layer_index);
 			}
+		};
+
+		for (auto const i : util::indices(vertices))
+		{
+			set_vertex_attributes(i, static_cast<int>(i), FbxLayerElement::EMappingMode::eByControlPoint);
 		}
 
 		auto const* const indices_source = mesh->GetPolygonVertices();
-		auto indices = std::vector<GLuint>(mesh->GetPolygonVertexCount());
 
-		for (auto const i : util::indices(indices))
+		for (auto const i : util::indices(mesh->GetPolygonVertexCount()))
 		{
-			indices[i] = static_cast<GLuint>(indices_source[i]);
+			set_vertex_attributes(static_cast<std::size_t>(indices_source[i]), i, FbxLayerElement::EMappingMode::eByPolygonVertex);
+		}
 
-			if (normal_layer->GetMappingMode() == FbxLayerElement::EMappingMode::eByPolygonVertex)
-			{
-				vertices[indices[i]].normal = fbx::layer_element_at(normal_layer, static_cast<int>(i));
-			}
-			
-			if (uv_layer->GetMappingMode() == FbxLayerElement::EMappingMode::eByPolygonVertex)
+		// Fan triangulation, which is a no-op for triangles. Polygons are assumed to be convex.
+		auto& indices = mesh_data.indices;
+		indices.reserve(static_cast<std::size_t>(mesh->GetPolygonVertexCount()));
+
+		for (auto const polygon : util::indices(mesh->GetPolygonCount()))
+		{
+			auto const* const polygon_indices = indices_source + mesh->GetPolygonVertexIndex(polygon);
+			for (auto corner = 2; corner < mesh->GetPolygonSize(polygon); ++corner)
 			{
-				vertices[indices[i]].texture_coordinates = fbx::layer_element_at(uv_layer, static_cast<int>(i));
+				indices.push_back(static_cast<GLuint>(polygon_indices[0]));
+				if (conversion.flips_handedness()) {
+					indices.push_back(static_cast<GLuint>(polygon_indices[corner]));
+					indices.push_back(static_cast<GLuint>(polygon_indices[corner - 1]));
+				}
+				else {
+					indices.push_back(static_cast<GLuint>(polygon_indices[corner - 1]));
+					indices.push_back(static_cast<GLuint>(polygon_indices[corner]));
+				}
 			}
 		}
 
-		connect_bones_to_vertices_(mesh, vertices);
+		connect_bones_to_vertices_(mesh, {vertices.data(), vertices.size()});
 		
-		meshes_.emplace_back(vertices, indices, texture_.id());
+		meshes.push_back(std::move(mesh_data));
 	}
 
-	void process_node_(FbxNode const* const node)
+	void process_node_(FbxNode const* const node, fbx::CoordinateConversion const& conversion, std::vector<MeshData>& meshes, util::Arena* const arena)
 	{
 		if (auto const* const attribute = node->GetNodeAttribute()) {
 			if (attribute->GetAttributeType() == FbxNodeAttribute::eMesh) {
-				load_mesh_(static_cast<FbxMesh const*>(attribute));
+				load_mesh_(static_cast<FbxMesh const*>(attribute), conversion, meshes, arena);
 			}
 		}
 
 		for (auto const i : util::indices(node->GetChildCount())) {
-			process_node_(node->GetChild(i));
+			process_node_(node->GetChild(i), conversion, meshes, arena);
 		}
 	}
 
@@ -226,11 +404,8 @@ private:
 		return settings;
 	}
 
-public:
-	Model() = default;
-
-	Model(char const* const fbx_path, Texture texture) :
-		texture_{std::move(texture)}
+	// Loads the skeleton and mesh data without touching the GPU.
+	void import_fbx_(char const* const fbx_path, std::vector<MeshData>& meshes, fbx::SceneConversion const scene_conversion, util::Arena* const arena)
 	{
 		auto manager = fbx::create<FbxManager>();
 		
@@ -239,9 +414,14 @@ public:
 		
 		auto scene = fbx::import_scene(manager.get(), fbx_path);
 
-		FbxAxisSystem::OpenGL.DeepConvertScene(scene.get());
-
-		FbxGeometryConverter{manager.get()}.Triangulate(scene.get(), true);
+		auto conversion = fbx::CoordinateConversion{};
+		if (scene_conversion == fbx::SceneConversion::sdk) {
+			FbxAxisSystem::OpenGL.DeepConvertScene(scene.get());
+			FbxGeometryConverter{manager.get()}.Triangulate(scene.get(), true);
+		}
+		else {
+			conversion = fbx::CoordinateConversion::to_opengl(scene.get());
+		}
 
 		auto* const root_node = scene->GetRootNode();
 
@@ -252,12 +432,252 @@ public:
 		skeleton_.load_from_fbx_node(root_node);
 
 		for (auto const i : util::indices(root_node->GetChildCount())) {
-			process_node_(root_node->GetChild(i));
+			process_node_(root_node->GetChild(i), conversion, meshes, arena);
+		}
+
+		// Cluster bind matrices are read in scene coordinates too, so the bones are converted after the meshes.
+		skeleton_.convert_coordinates(conversion);
+		skeleton_.calculate_local_bind_components();
+	}
+#endif
+
+	// Without the FBX SDK, FBX files can't be loaded and throw.
+	void import_fbx_(char const* const fbx_path, std::vector<MeshData>& meshes, util::Arena* const arena)
+	{
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+		import_fbx_(fbx_path, meshes, fbx::SceneConversion::bulk, arena);
+#else
+		static_cast<void>(meshes);
+		static_cast<void>(arena);
+		throw std::runtime_error{std::string{"FBX files can't be loaded without the FBX SDK: "} + fbx_path};
+#endif
+	}
+
+	static constexpr auto invalid_bone_id_ = static_cast<Bone::Id>(-1);
+
+	void load_gltf_primitive_(gltf::Document const& document, json::Value const& primitive, glm::mat4 const& transform, 
+		std::vector<Bone::Id> const& joint_bone_ids, std::vector<MeshData>& meshes, util::Arena* const arena)
+	{
+		// Only triangle lists, which is the default mode.
+		if (primitive["mode"].as_number(4) != 4) {
+			return;
+		}
+
+		auto const& attributes = primitive["attributes"];
+		if (!attributes.contains("POSITION")) {
+			return;
+		}
+
+		auto vec3_storage = std::vector<glm::vec3>{};
+		auto const positions = document.read(attributes["POSITION"].as_index(), vec3_storage);
+
+		auto mesh_data = MeshData{
+			MeshData::Vertices(positions.size(), util::ArenaAllocator<Vertex>{arena}),
+			MeshData::Indices(util::ArenaAllocator<GLuint>{arena}),
+		};
+		auto& vertices = mesh_data.vertices;
+
+		for (auto const i : util::indices(vertices)) {
+			vertices[i].position = transform*glm::vec4{positions[i], 1.f};
+		}
+
+		if (attributes.contains("NORMAL")) 
+		{
+			auto const normals = document.read(attributes["NORMAL"].as_index(), vec3_storage);
+			// The inverse transpose keeps normals perpendicular to the surface when the node is scaled non-uniformly.
+			auto const normal_transform = glm::transpose(glm::inverse(glm::mat3{transform}));
+			for (auto const i : util::indices(std::min(vertices.size(), normals.size()))) {
+				vertices[i].normal = glm::normalize(normal_transform*normals[i]);
+			}
+		}
+
+		if (attributes.contains("TEXCOORD_0")) 
+		{
+			auto vec2_storage = std::vector<glm::vec2>{};
+			auto const texture_coordinates = document.read(attributes["TEXCOORD_0"].as_index(), vec2_storage);
+			for (auto const i : util::indices(std::min(vertices.size(), texture_coordinates.size()))) {
+				// glTF puts the origin at the top left, and textures are flipped when they are loaded.
+				vertices[i].texture_coordinates = glm::vec2{texture_coordinates[i].x, 1.f - texture_coordinates[i].y};
+			}
+		}
+
+		if (attributes.contains("JOINTS_0") && attributes.contains("WEIGHTS_0"))
+		{
+			auto const joints = document.read_unsigned(attributes["JOINTS_0"].as_index());
+			auto weight_storage = std::vector<glm::vec4>{};
+			auto const weights = document.read(attributes["WEIGHTS_0"].as_index(), weight_storage);
+
+			for (auto const i : util::indices(std::min({vertices.size(), weights.size(), joints.size()/4}))) {
+				for (auto const j : {0, 1, 2, 3})
+				{
+					auto const joint = joints[i*4 + static_cast<std::size_t>(j)];
+					if (joint < joint_bone_ids.size() && joint_bone_ids[joint] != invalid_bone_id_) {
+						vertices[i].add_bone(joint_bone_ids[joint], weights[i][j]);
+					}
+				}
+			}
+		}
+
+		auto& indices = mesh_data.indices;
+		if (primitive.contains("indices")) {
+			auto const source_indices = document.read_unsigned(primitive["indices"].as_index());
+			indices.assign(source_indices.begin(), source_indices.end());
+		}
+		else {
+			indices.resize(vertices.size());
+			std::iota(indices.begin(), indices.end(), GLuint{});
+		}
+
+		meshes.push_back(std::move(mesh_data));
+	}
+
+	// Loads the skeleton of the first skin, and the meshes of every node. glTF is already in OpenGL's axis system.
+	void import_gltf_(char const* const gltf_path, std::vector<MeshData>& meshes, util::Arena* const arena)
+	{
+		static_assert(std::is_same<GLuint, std::uint32_t>::value, "glTF indices are read as 32-bit.");
+
+		auto const document = gltf::Document{gltf_path};
+		auto const& root = document.root();
+
+		// The bone ID of every joint in the skin's joint array.
+		auto joint_bone_ids = std::vector<Bone::Id>{};
+
+		if (root["skins"].size())
+		{
+			auto const skin = document.skin(0);
+			skeleton_.load_from_gltf(skin);
+
+			joint_bone_ids.assign(root["skins"][0]["joints"].size(), invalid_bone_id_);
+			for (auto const& joint : skin.joints) {
+				if (auto const* const bone = skeleton_.bone_by_name(joint.name.c_str())) {
+					joint_bone_ids.at(joint.skin_joint) = bone->id;
+				}
+			}
+		}
+
+		auto const& nodes = root["nodes"];
+		for (auto const node : util::indices(nodes.size()))
+		{
+			if (!nodes[node].contains("mesh")) {
+				continue;
+			}
+			// Skinned meshes ignore their node's transform; the inverse bind matrices place them instead.
+			auto const transform = nodes[node].contains("skin") ? glm::mat4{1.f} : document.global_transform(node);
+
+			for (auto const& primitive : root["meshes"][nodes[node]["mesh"].as_index()]["primitives"].elements()) {
+				load_gltf_primitive_(document, primitive, transform, joint_bone_ids, meshes, arena);
+			}
 		}
 
 		skeleton_.calculate_local_bind_components();
 	}
 
+	// Uploads the vertex and index buffers straight from the mapped file.
+	void load_cooked_(char const* const cooked_path)
+	{
+		static_assert(std::is_same<GLuint, std::uint32_t>::value, "Cooked indices are 32-bit.");
+
+		auto const file = cooked::File{cooked_path};
+
+		skeleton_.load_from_cooked(file);
+
+		for (auto const& mesh : file.meshes()) {
+			add_mesh_(file.vertices<Vertex>(mesh), file.indices(mesh));
+		}
+	}
+
+public:
+	Model() = default;
+
+	// The path can point to an FBX, glTF or cooked file. The mesh data only lives until it is uploaded, in an arena that is freed at once.
+	Model(char const* const fbx_path, Texture texture) :
+		texture_{std::move(texture)}
+	{
+		if (cooked::is_cooked_path(fbx_path)) {
+			load_cooked_(fbx_path);
+			return;
+		}
+
+		auto arena = util::Arena{};
+		auto meshes = std::vector<MeshData>{};
+		if (gltf::is_gltf_path(fbx_path)) {
+			import_gltf_(fbx_path, meshes, &arena);
+		}
+		else {
+			import_fbx_(fbx_path, meshes, &arena);
+		}
+
+		for (auto const& mesh : meshes) {
+			add_mesh_({mesh.vertices.data(), mesh.vertices.size()}, {mesh.indices.data(), mesh.indices.size()});
+		}
+	}
+
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+	/*
+		Imports the skeleton and mesh data in an FBX file without creating any GPU resources.
+		With an arena, the mesh data is allocated in it and has to be dropped before the arena is reset.
+	*/
+	static Model import_fbx(char const* const fbx_path, std::vector<MeshData>& meshes, 
+		fbx::SceneConversion const scene_conversion = fbx::SceneConversion::bulk, util::Arena* const arena = nullptr)
+	{
+		auto model = Model{};
+		model.import_fbx_(fbx_path, meshes, scene_conversion, arena);
+		return model;
+	}
+#endif
+
+	// Imports the skeleton and mesh data in a glTF file without creating any GPU resources. See import_fbx for the arena.
+	static Model import_gltf(char const* const gltf_path, std::vector<MeshData>& meshes, util::Arena* const arena = nullptr)
+	{
+		auto model = Model{};
+		model.import_gltf_(gltf_path, meshes, arena);
+		return model;
+	}
+
+	/*
+		Reads the skeleton and mesh data in a cooked file without creating any GPU resources. See import_fbx for the arena.
+		Unlike the other imports it also finds the bone vertex bounds, so that skin_radius works headless.
+	*/
+	static Model import_cooked(char const* const cooked_path, std::vector<MeshData>& meshes, util::Arena* const arena = nullptr)
+	{
+		auto model = Model{};
+		auto const file = cooked::File{cooked_path};
+
+		model.skeleton_.load_from_cooked(file);
+
+		for (auto const& mesh : file.meshes())
+		{
+			auto const vertices = file.vertices<Vertex>(mesh);
+			auto const indices = file.indices(mesh);
+			meshes.push_back(MeshData{
+				MeshData::Vertices(vertices.begin(), vertices.end(), util::ArenaAllocator<Vertex>{arena}),
+				MeshData::Indices(indices.begin(), indices.end(), util::ArenaAllocator<GLuint>{arena}),
+			});
+			model.add_bone_vertex_bounds_(vertices);
+		}
+		return model;
+	}
+
+	// Imports the skeleton and meshes in an FBX or glTF file and adds them to a cooked file.
+	static void cook(char const* const path, cooked::Writer& writer)
+	{
+		auto arena = util::Arena{};
+		auto meshes = std::vector<MeshData>{};
+		auto model = Model{};
+		if (gltf::is_gltf_path(path)) {
+			model.import_gltf_(path, meshes, &arena);
+		}
+		else {
+			model.import_fbx_(path, meshes, &arena);
+		}
+
+		model.skeleton_.cook(writer);
+
+		for (auto const& mesh : meshes) {
+			writer.add_mesh(util::Span<Vertex const>{mesh.vertices.data(), mesh.vertices.size()}, util::Span<GLuint const>{mesh.indices.data(), mesh.indices.size()});
+		}
+	}
+
 	Skeleton const& skeleton() const {
 		return skeleton_;
 	}
@@ -265,10 +685,20 @@ public:
 	Skeleton& skeleton() {
 		return skeleton_;
 	}
+
+	// See calculate_skin_radius. Uses the skeleton's current bind pose.
+	float skin_radius() const {
+		return calculate_skin_radius(skeleton_, {bone_vertex_bounds_.data(), bone_vertex_bounds_.size()});
+	}
 	
-	void draw() const {
+	// Calls use_shader(variant) before drawing each mesh, with the index of the bone influence variant it is drawn with.
+	template<typename ShaderSelector_>
+	void draw(std::size_t const max_bone_influence_count, ShaderSelector_ const& use_shader) const 
+	{
 		for (auto const& mesh : meshes_) {
-			mesh.draw();
+			auto const variant = mesh.choose_variant(max_bone_influence_count);
+			use_shader(variant);
+			mesh.draw(variant);
 		}
 	}
 };
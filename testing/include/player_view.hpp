@@ -68,6 +68,9 @@ public:
 	glm::mat4 view_matrix() const {
 		return view_matrix_;
 	}
+	glm::vec3 position() const {
+		return position_;
+	}
 };
 
 } // namespace testing
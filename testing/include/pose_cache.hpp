@@ -0,0 +1,161 @@
+#ifndef ANIMATION_RETARGETING_TESTING_POSE_CACHE_HPP
+#define ANIMATION_RETARGETING_TESTING_POSE_CACHE_HPP
+
+#include "animation.hpp"
+#include "arena.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace testing {
+
+/*
+	Shares the bone matrices of animations that play the same clip on the same skeleton at the same time, within a frame.
+	Times are rounded to a step, so instances that are nearly in sync share too. The first lookup of a pose evaluates it
+	and later lookups in the frame return the same matrices, which must be treated as read-only.
+
+	Lookups may run concurrently. begin_frame may not run concurrently with lookups, and invalidates the matrices they returned.
+*/
+class PoseCache {
+private:
+	struct Key_ {
+		Skeleton const* clip;
+		Skeleton const* skeleton;
+		std::int64_t time_step;
+
+		bool operator==(Key_ const& other) const {
+			return clip == other.clip && skeleton == other.skeleton && time_step == other.time_step;
+		}
+	};
+	struct Entry_ {
+		Key_ key;
+		std::mutex mutex;
+		bool is_evaluated{};
+		util::CacheAlignedVector<glm::mat4> global_transforms;
+		util::CacheAlignedVector<glm::mat4> animation_transforms;
+	};
+
+	float steps_per_second_;
+
+	std::mutex mutex_;
+	/*
+		The entries used in the frame, by key, with open addressing. There are always at least twice as many slots as entries.
+		Entries and slots are reused from frame to frame, so they, and the entries' matrix arrays, are only allocated while the cache warms up.
+	*/
+	std::vector<Entry_*> slots_;
+	std::deque<Entry_> entries_;
+	std::size_t used_entry_count_{};
+
+	std::atomic<std::size_t> lookup_count_{};
+	std::atomic<std::size_t> hit_count_{};
+
+	std::size_t first_slot_(Key_ const& key) const
+	{
+		auto hash = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key.clip));
+		hash = hash*31 + static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key.skeleton));
+		hash = hash*31 + static_cast<std::uint64_t>(key.time_step);
+		// Fibonacci hashing, since the pointers' low bits are always zero and time steps are consecutive.
+		return static_cast<std::size_t>((hash*0x9e3779b97f4a7c15) >> 32) & (slots_.size() - 1);
+	}
+	void add_slot_(Entry_& entry)
+	{
+		auto i = first_slot_(entry.key);
+		while (slots_[i]) {
+			i = (i + 1) & (slots_.size() - 1);
+		}
+		slots_[i] = &entry;
+	}
+
+	Entry_& find_entry_(Key_ const& key)
+	{
+		auto const lock = std::lock_guard{mutex_};
+
+		if (!slots_.empty()) {
+			for (auto i = first_slot_(key); slots_[i]; i = (i + 1) & (slots_.size() - 1)) {
+				if (slots_[i]->key == key) {
+					return *slots_[i];
+				}
+			}
+		}
+
+		if ((used_entry_count_ + 1)*2 > slots_.size())
+		{
+			slots_.assign(std::max(std::size_t{16}, slots_.size()*2), nullptr);
+			for (auto i = std::size_t{}; i < used_entry_count_; ++i) {
+				add_slot_(entries_[i]);
+			}
+		}
+		if (used_entry_count_ == entries_.size()) {
+			entries_.emplace_back();
+		}
+		auto& entry = entries_[used_entry_count_++];
+		entry.key = key;
+		entry.is_evaluated = false;
+		add_slot_(entry);
+		return entry;
+	}
+
+public:
+	// Times closer together than one step share a pose.
+	explicit PoseCache(float const steps_per_second = 120.f) :
+		steps_per_second_{steps_per_second}
+	{}
+
+	PoseCache(PoseCache const&) = delete;
+	PoseCache const& operator=(PoseCache const&) = delete;
+
+	void begin_frame()
+	{
+		std::fill(slots_.begin(), slots_.end(), nullptr);
+		used_entry_count_ = 0;
+	}
+
+	// Returns the animation's bone matrices (Bone::animation_transform) at the time, indexed by bone id.
+	util::Span<glm::mat4 const> animation_transforms(Animation const& animation, Seconds const time)
+	{
+		auto const time_step = static_cast<std::int64_t>(std::llround(time.count()*steps_per_second_));
+		auto& entry = find_entry_(Key_{&animation.clip_skeleton(), &animation.skeleton(), time_step});
+
+		++lookup_count_;
+
+		auto const lock = std::lock_guard{entry.mutex};
+		if (entry.is_evaluated) {
+			++hit_count_;
+		}
+		else {
+			auto const bone_count = animation.skeleton().bone_count();
+			entry.global_transforms.resize(bone_count);
+			entry.animation_transforms.resize(bone_count);
+			animation.evaluate_bone_matrices(Seconds{static_cast<float>(time_step)/steps_per_second_},
+				{entry.global_transforms.data(), bone_count}, {entry.animation_transforms.data(), bone_count});
+			entry.is_evaluated = true;
+		}
+		return {entry.animation_transforms.data(), entry.animation_transforms.size()};
+	}
+
+	std::size_t lookup_count() const {
+		return lookup_count_;
+	}
+	std::size_t hit_count() const {
+		return hit_count_;
+	}
+	// The fraction of lookups that didn't evaluate a pose, since the cache was created or the counts were reset.
+	float hit_rate() const {
+		return lookup_count_ ? static_cast<float>(hit_count_)/static_cast<float>(lookup_count_) : 0.f;
+	}
+	void reset_counts() {
+		lookup_count_ = 0;
+		hit_count_ = 0;
+	}
+};
+
+} // namespace testing
+
+#endif
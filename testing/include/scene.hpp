@@ -2,6 +2,7 @@
 #define ANIMATION_RETARGETING_TESTING_SCENE_HPP
 
 #include "animated_character.hpp"
+#include "animation_lod.hpp"
 #include "player_view.hpp"
 
 namespace testing {
@@ -10,23 +11,53 @@ class Scene {
 private:
 	static constexpr auto player_position = glm::vec3{0.f, 8.f, 0.f};
 
+	// Baked retargeting stores a retargeted copy of the clip per character, live retargeting corrects the source clip as it's sampled.
+	enum class Retargeting { baked, live };
+	static constexpr auto retargeting = Retargeting::live;
+
 	static constexpr auto animation_path = "testing/data/animations/mmakick.fbx";
+	// Live retargeted characters don't need their own copy of the clip.
+	static constexpr auto target_animation_path = retargeting == Retargeting::baked ? animation_path : "";
+
+	// The rate to bake the retargeted characters' bone matrices at, or zero to sample their clip every frame.
+	static constexpr auto palette_frames_per_second = 0.f;
+	static constexpr auto palette_precision = PalettePrecision::full;
+
+	// How far the characters' tracks may stray from their original keys, in bone space, to drop keys. Zero keeps every key.
+	static constexpr auto keyframe_tolerance = 0.f;
+	static constexpr auto keyframe_interpolation = Interpolation::cubic;
 
 	std::array<AnimatedCharacter, 6> characters_{
 		AnimatedCharacter{Model{"testing/data/animations/mmakick.fbx", Texture{}}, animation_path},
-		AnimatedCharacter{Model{"testing/data/models/archer.fbx", Texture{"testing/data/models/archer.png"}}, animation_path},
-		AnimatedCharacter{Model{"testing/data/models/praying.fbx", Texture{"testing/data/models/human.png"}}, animation_path},
-		AnimatedCharacter{Model{"testing/data/models/vampire.fbx", Texture{"testing/data/models/vampire.png"}}, animation_path},
-		AnimatedCharacter{Model{"testing/data/models/human.fbx", Texture{"testing/data/models/human.png"}}, animation_path},
-		AnimatedCharacter{Model{"testing/data/models/troll.fbx", Texture{"testing/data/models/human.png"}}, animation_path, 1e-2f},
+		AnimatedCharacter{Model{"testing/data/models/archer.fbx", Texture{"testing/data/models/archer.png"}}, target_animation_path},
+		AnimatedCharacter{Model{"testing/data/models/praying.fbx", Texture{"testing/data/models/human.png"}}, target_animation_path},
+		AnimatedCharacter{Model{"testing/data/models/vampire.fbx", Texture{"testing/data/models/vampire.png"}}, target_animation_path},
+		AnimatedCharacter{Model{"testing/data/models/human.fbx", Texture{"testing/data/models/human.png"}}, target_animation_path},
+		AnimatedCharacter{Model{"testing/data/models/troll.fbx", Texture{"testing/data/models/human.png"}}, target_animation_path, 1e-2f},
 	};
 	Skeleton const& source_skeleton_ = characters_[0].model().skeleton();
 	
 	PlayerView view_{player_position};
+	glm::mat4 projection_{1.f};
+
+	// Characters further away than these distances update every 2, 4 and 8 frames, within a budget of animation time per frame.
+	AnimationLod animation_lod_{AnimationLod::Milliseconds{2.f}, {40.f, 80.f, 160.f}};
+
 	bool are_skeletons_visible_{true};
 
+	// Scratch memory for drawing, reset at the start of every frame.
+	util::Arena frame_arena_;
+
+	struct CullingStats_ {
+		std::size_t drawn_count;
+		std::size_t culled_count;
+		std::chrono::steady_clock::duration draw_time;
+	};
+	CullingStats_ culling_stats_{};
+
 	void update_projection_(glm::vec2 const size) {
 		auto const new_projection = glm::perspective(glm::radians(50.f), size.x/size.y, 0.1f, 100.f);
+		projection_ = new_projection;
 
 		for (auto& character : characters_) {
 			character.projection_matrix(new_projection);
@@ -40,7 +71,7 @@ private:
 		auto x = -(static_cast<float>(characters_.size()) - 1.f)*spacing/2.f;
 
 		auto const source_pose = source_skeleton_.extract_pose();
-		auto const source_animation = source_skeleton_.extract_animation();
+		auto const source_animation = retargeting == Retargeting::baked ? source_skeleton_.extract_animation() : animation_retargeting::Animation{};
 
 		for (auto& character : characters_) 
 		{
@@ -48,14 +79,31 @@ private:
 			auto& skeleton = character.model().skeleton();
 			if (&skeleton != &source_skeleton_) 
 			{
-				auto const result = animation_retargeting::retarget(source_animation, source_pose, skeleton.extract_pose());
-				skeleton.set_animation_values(result.animation);
-				skeleton.set_bind_pose(result.bind_pose);
-				character.update_skeleton_mesh();
+				if (retargeting == Retargeting::live) {
+					character.retarget_animation_from(source_skeleton_);
+				}
+				else {
+					auto const result = animation_retargeting::retarget(source_animation, source_pose, skeleton.extract_pose(), 
+						animation_retargeting::ConstantChannels::collapse);
+					skeleton.set_animation_values(result.animation);
+					skeleton.set_bind_pose(result.bind_pose);
+					character.update_skeleton_mesh();
+				}
+			}
+
+			// After retargeting, which needs the keys of the source and target tracks to match.
+			if (keyframe_tolerance > 0.f) {
+				skeleton.reduce_keyframes(keyframe_tolerance, keyframe_interpolation, 1.f);
 			}
 
-			character.restart_animation();
+			if (&skeleton != &source_skeleton_ && palette_frames_per_second > 0.f) {
+				character.animated_model().bake_animation(palette_frames_per_second, palette_precision);
+			}
+
+			character.animated_model().restart_animation();
 			character.position_scale(glm::vec3{x, 0.f, -30.f}, 1.f/15.f);
+			animation_lod_.add_character(character.animated_model());
+			character.animated_model().calculate_bounds();
 			x += spacing;
 		}
 	}
@@ -76,28 +124,63 @@ public:
 		if (key == GLFW_KEY_F1) {
 			are_skeletons_visible_ = !are_skeletons_visible_;
 		}
+		else if (key == GLFW_KEY_F2) {
+			animation_lod_.print_report();
+		}
+		else if (key == GLFW_KEY_F3) {
+			print_culling_stats();
+		}
 	}
 
 	void update(glfw::InputState const& input_state) {
 		view_.update_movement(input_state);
 
-		for (auto& character : characters_) {
-			character.update_animation();
-		}
+		animation_lod_.update(view_.position());
 	}
 
-	void draw() {
-		for (auto& character : characters_) {
-			character.draw_model(view_.view_matrix());
+	void draw() 
+	{
+		frame_arena_.reset();
+
+		// Culled characters skip uploading their bone matrices as well as drawing.
+		auto const frustum = Frustum::from_matrix(projection_*view_.view_matrix());
+		auto is_visible = std::array<bool, std::tuple_size<decltype(characters_)>::value>{};
+		for (auto const i : util::indices(characters_)) {
+			is_visible[i] = characters_[i].animated_model().is_visible(frustum);
+		}
+
+		auto const start_time = std::chrono::steady_clock::now();
+
+		for (auto const i : util::indices(characters_)) {
+			if (is_visible[i]) {
+				characters_[i].draw_model(view_.view_matrix(), frame_arena_);
+			}
 		}
 
 		if (are_skeletons_visible_) {
 			glClear(GL_DEPTH_BUFFER_BIT);
 
-			for (auto& character : characters_) {
-				character.draw_skeleton(view_.view_matrix());
+			for (auto const i : util::indices(characters_)) {
+				if (is_visible[i]) {
+					characters_[i].draw_skeleton(view_.view_matrix(), frame_arena_);
+				}
 			}
 		}
+
+		culling_stats_.drawn_count = static_cast<std::size_t>(std::count(is_visible.begin(), is_visible.end(), true));
+		culling_stats_.culled_count = characters_.size() - culling_stats_.drawn_count;
+		culling_stats_.draw_time = std::chrono::steady_clock::now() - start_time;
+	}
+
+	void print_culling_stats() const
+	{
+		using Milliseconds = std::chrono::duration<double, std::milli>;
+		auto const draw_time = Milliseconds{culling_stats_.draw_time}.count();
+		// Estimated from the time the drawn characters took.
+		auto const saved_time = culling_stats_.drawn_count ? 
+			draw_time/static_cast<double>(culling_stats_.drawn_count)*static_cast<double>(culling_stats_.culled_count) : 0.;
+		fmt::print("Drew {} characters and culled {}. Drawing took {:.3f} ms, culling saved about {:.3f} ms.\n",
+			culling_stats_.drawn_count, culling_stats_.culled_count, draw_time, saved_time);
 	}
 };
 
@@ -125,6 +125,12 @@ public:
 	void set_mat4(char const* const name, glm::mat4 const& matrix) {
 		glUniformMatrix4fv(glGetUniformLocation(id_, name), 1, GL_FALSE, &matrix[0][0]);
 	}
+	// Sets the first elements of a uniform array with one call, without naming each element.
+	void set_mat4_array(char const* const name, glm::mat4 const* const matrices, std::size_t const count) {
+		if (count) {
+			glUniformMatrix4fv(glGetUniformLocation(id_, name), static_cast<GLsizei>(count), GL_FALSE, &matrices[0][0][0]);
+		}
+	}
 };
 
 } // namespace testing 
@@ -0,0 +1,637 @@
+/*
+	Batched math kernels over structure-of-arrays inputs.
+	The quaternion and matrix kernels are compiled for SSE2, AVX2 and AVX-512 next to a scalar version, and the widest
+	instruction set that the CPU supports is chosen at runtime, so the program itself only needs to target SSE2.
+*/
+
+#ifndef ANIMATION_RETARGETING_TESTING_SIMD_HPP
+#define ANIMATION_RETARGETING_TESTING_SIMD_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 2
+#	define ANIMATION_RETARGETING_SSE2
+#	include <emmintrin.h>
+#endif
+
+// AVX2 and AVX-512 kernels are compiled with function level target options, which GCC, Clang and MSVC all allow.
+#if defined(ANIMATION_RETARGETING_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#	define ANIMATION_RETARGETING_AVX
+#	include <immintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	endif
+#endif
+
+namespace testing {
+namespace simd {
+
+#ifdef ANIMATION_RETARGETING_SSE2
+
+namespace detail {
+
+// Four-wide sine and cosine, using the range reduction and polynomials from the Cephes library.
+// The error is within a few ulp for angles up to several thousand radians.
+inline void sincos(__m128 const angle, __m128& sine, __m128& cosine)
+{
+	auto const sign_mask = _mm_set1_ps(-0.f);
+	auto const abs_angle = _mm_andnot_ps(sign_mask, angle);
+
+	// The octant of each angle, rounded up to an even number.
+	auto octant = _mm_cvttps_epi32(_mm_mul_ps(abs_angle, _mm_set1_ps(1.27323954473516f)));
+	octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+	auto const octant_float = _mm_cvtepi32_ps(octant);
+
+	// Extended precision modular arithmetic: x - octant*pi/4.
+	auto x = _mm_sub_ps(abs_angle, _mm_mul_ps(octant_float, _mm_set1_ps(0.78515625f)));
+	x = _mm_sub_ps(x, _mm_mul_ps(octant_float, _mm_set1_ps(2.4187564849853515625e-4f)));
+	x = _mm_sub_ps(x, _mm_mul_ps(octant_float, _mm_set1_ps(3.77489497744594108e-8f)));
+
+	auto const sine_sign = _mm_xor_ps(_mm_and_ps(angle, sign_mask),
+		_mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+	auto const cosine_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+	auto const swap_mask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+	auto const z = _mm_mul_ps(x, x);
+
+	auto cosine_polynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), z), _mm_set1_ps(-1.388731625493765e-3f));
+	cosine_polynomial = _mm_add_ps(_mm_mul_ps(cosine_polynomial, z), _mm_set1_ps(4.166664568298827e-2f));
+	cosine_polynomial = _mm_mul_ps(_mm_mul_ps(cosine_polynomial, z), z);
+	cosine_polynomial = _mm_add_ps(_mm_sub_ps(cosine_polynomial, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.f));
+
+	auto sine_polynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), z), _mm_set1_ps(8.3321608736e-3f));
+	sine_polynomial = _mm_add_ps(_mm_mul_ps(sine_polynomial, z), _mm_set1_ps(-1.6666654611e-1f));
+	sine_polynomial = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sine_polynomial, z), x), x);
+
+	sine = _mm_or_ps(_mm_and_ps(swap_mask, sine_polynomial), _mm_andnot_ps(swap_mask, cosine_polynomial));
+	cosine = _mm_or_ps(_mm_and_ps(swap_mask, cosine_polynomial), _mm_andnot_ps(swap_mask, sine_polynomial));
+
+	sine = _mm_xor_ps(sine, sine_sign);
+	cosine = _mm_xor_ps(cosine, cosine_sign);
+}
+
+} // namespace detail
+
+#endif
+
+// Converts XYZ Euler angles in radians to quaternions, matching glm::quat{glm::vec3{x, y, z}}.
+inline void euler_xyz_to_quat(float const* const x, float const* const y, float const* const z, std::size_t const count, glm::quat* const out)
+{
+	auto i = std::size_t{};
+
+#ifdef ANIMATION_RETARGETING_SSE2
+	auto const half = _mm_set1_ps(0.5f);
+
+	alignas(16) float w_out[4], x_out[4], y_out[4], z_out[4];
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 sx, cx, sy, cy, sz, cz;
+		detail::sincos(_mm_mul_ps(_mm_loadu_ps(x + i), half), sx, cx);
+		detail::sincos(_mm_mul_ps(_mm_loadu_ps(y + i), half), sy, cy);
+		detail::sincos(_mm_mul_ps(_mm_loadu_ps(z + i), half), sz, cz);
+
+		auto const cy_cz = _mm_mul_ps(cy, cz);
+		auto const sy_sz = _mm_mul_ps(sy, sz);
+		auto const sy_cz = _mm_mul_ps(sy, cz);
+		auto const cy_sz = _mm_mul_ps(cy, sz);
+
+		_mm_store_ps(w_out, _mm_add_ps(_mm_mul_ps(cx, cy_cz), _mm_mul_ps(sx, sy_sz)));
+		_mm_store_ps(x_out, _mm_sub_ps(_mm_mul_ps(sx, cy_cz), _mm_mul_ps(cx, sy_sz)));
+		_mm_store_ps(y_out, _mm_add_ps(_mm_mul_ps(cx, sy_cz), _mm_mul_ps(sx, cy_sz)));
+		_mm_store_ps(z_out, _mm_sub_ps(_mm_mul_ps(cx, cy_sz), _mm_mul_ps(sx, sy_cz)));
+
+		for (auto const j : {0, 1, 2, 3}) {
+			out[i + j] = glm::quat{w_out[j], x_out[j], y_out[j], z_out[j]};
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		out[i] = glm::quat{glm::vec3{x[i], y[i], z[i]}};
+	}
+}
+
+// Converts double precision points (x, y, z, w with a stride of four doubles, like FbxVector4) to float and
+// transforms them. The results are written as glm::vec3 with the given byte stride, for example into vertices.
+inline void transform_points(double const* const points, std::size_t const count, glm::mat4 const& transform, void* const out, std::size_t const out_stride)
+{
+	auto* const out_bytes = static_cast<unsigned char*>(out);
+	auto i = std::size_t{};
+
+#ifdef ANIMATION_RETARGETING_SSE2
+	auto const column_0 = _mm_loadu_ps(&transform[0][0]);
+	auto const column_1 = _mm_loadu_ps(&transform[1][0]);
+	auto const column_2 = _mm_loadu_ps(&transform[2][0]);
+	auto const column_3 = _mm_loadu_ps(&transform[3][0]);
+
+	alignas(16) float result[4];
+
+	for (; i < count; ++i)
+	{
+		auto const xy = _mm_cvtpd_ps(_mm_loadu_pd(points + i*4));
+		auto const zw = _mm_cvtpd_ps(_mm_loadu_pd(points + i*4 + 2));
+		auto const point = _mm_movelh_ps(xy, zw);
+
+		auto transformed = _mm_mul_ps(column_0, _mm_shuffle_ps(point, point, _MM_SHUFFLE(0, 0, 0, 0)));
+		transformed = _mm_add_ps(transformed, _mm_mul_ps(column_1, _mm_shuffle_ps(point, point, _MM_SHUFFLE(1, 1, 1, 1))));
+		transformed = _mm_add_ps(transformed, _mm_mul_ps(column_2, _mm_shuffle_ps(point, point, _MM_SHUFFLE(2, 2, 2, 2))));
+		transformed = _mm_add_ps(transformed, column_3);
+		_mm_store_ps(result, transformed);
+
+		*reinterpret_cast<glm::vec3*>(out_bytes + i*out_stride) = glm::vec3{result[0], result[1], result[2]};
+	}
+#endif
+
+	for (; i < count; ++i) {
+		auto const* const point = points + i*4;
+		*reinterpret_cast<glm::vec3*>(out_bytes + i*out_stride) = glm::vec3{transform*glm::vec4{point[0], point[1], point[2], 1.0}};
+	}
+}
+
+//---------------------------------------------------
+
+// Pointers to the components of an array of vectors, one array per component. T_ is float or float const.
+template<typename T_>
+struct Vec3Arrays {
+	T_* x;
+	T_* y;
+	T_* z;
+};
+template<typename T_>
+struct QuatArrays {
+	T_* x;
+	T_* y;
+	T_* z;
+	T_* w;
+};
+
+enum class InstructionSet { scalar, sse2, avx2, avx512 };
+
+// The widest instruction set that both the CPU and the compiler support, read from CPUID once.
+inline InstructionSet supported_instruction_set()
+{
+	static auto const supported = [] {
+#if defined(ANIMATION_RETARGETING_AVX) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		auto const leaf_count = info[0];
+		__cpuid(info, 1);
+		auto const has_fma = (info[2] & (1 << 12)) != 0;
+		auto const has_os_saved_state = (info[2] & (1 << 27)) != 0;
+		if (leaf_count < 7 || !has_os_saved_state) {
+			return InstructionSet::sse2;
+		}
+		// The operating system has to save the YMM registers, and also the ZMM and mask registers for AVX-512.
+		auto const saved_state = _xgetbv(0);
+		__cpuidex(info, 7, 0);
+		if ((info[1] & (1 << 16)) != 0 && (saved_state & 0xe6) == 0xe6) {
+			return InstructionSet::avx512;
+		}
+		if ((info[1] & (1 << 5)) != 0 && has_fma && (saved_state & 0x6) == 0x6) {
+			return InstructionSet::avx2;
+		}
+		return InstructionSet::sse2;
+#elif defined(ANIMATION_RETARGETING_AVX)
+		// These read CPUID and check that the operating system saves the wider registers.
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) {
+			return InstructionSet::avx512;
+		}
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+			return InstructionSet::avx2;
+		}
+		return InstructionSet::sse2;
+#elif defined(ANIMATION_RETARGETING_SSE2)
+		return InstructionSet::sse2;
+#else
+		return InstructionSet::scalar;
+#endif
+	}();
+	return supported;
+}
+
+namespace detail {
+
+inline InstructionSet& selected_instruction_set() {
+	static auto selected = supported_instruction_set();
+	return selected;
+}
+
+} // namespace detail
+
+// The instruction set that the kernels below run with.
+inline InstructionSet instruction_set() {
+	return detail::selected_instruction_set();
+}
+// Makes the kernels run with a narrower instruction set, to compare them or measure them. Instruction sets that aren't
+// supported fall back to the supported one. Not thread safe: no kernels can run at the same time.
+inline void set_instruction_set(InstructionSet const instruction_set) {
+	detail::selected_instruction_set() = std::min(instruction_set, supported_instruction_set());
+}
+
+namespace detail {
+
+// Each kernel processes the elements from begin to end in whole batches of its instruction set's width, and returns
+// where it stopped so that the scalar kernel can finish the rest.
+struct Kernels {
+	std::size_t (*rotate)(QuatArrays<float const>, Vec3Arrays<float const>, Vec3Arrays<float>, std::size_t, std::size_t);
+	std::size_t (*normalize)(QuatArrays<float const>, QuatArrays<float>, std::size_t, std::size_t);
+	std::size_t (*nlerp)(QuatArrays<float const>, QuatArrays<float const>, float const*, QuatArrays<float>, std::size_t, std::size_t);
+	std::size_t (*slerp)(QuatArrays<float const>, QuatArrays<float const>, float const*, QuatArrays<float>, std::size_t, std::size_t);
+	std::size_t (*compose)(Vec3Arrays<float const>, QuatArrays<float const>, Vec3Arrays<float const>, glm::mat4*, std::size_t, std::size_t);
+	std::size_t (*multiply)(glm::mat4 const*, glm::mat4 const*, glm::mat4*, std::size_t, std::size_t);
+	std::size_t (*inverse_affine)(glm::mat4 const*, glm::mat4*, std::size_t, std::size_t);
+	std::size_t (*decompose)(glm::mat4 const*, Vec3Arrays<float>, QuatArrays<float>, Vec3Arrays<float>, std::size_t, std::size_t);
+};
+
+namespace scalar {
+
+constexpr std::size_t width = 1;
+
+struct Float {
+	float value;
+};
+using Mask = bool;
+inline Float load(float const* const source) { return {*source}; }
+inline void store(float* const destination, Float const a) { *destination = a.value; }
+inline Float splat(float const a) { return {a}; }
+inline Float operator+(Float const a, Float const b) { return {a.value + b.value}; }
+inline Float operator-(Float const a, Float const b) { return {a.value - b.value}; }
+inline Float operator*(Float const a, Float const b) { return {a.value*b.value}; }
+inline Float operator/(Float const a, Float const b) { return {a.value/b.value}; }
+inline Float multiply_add(Float const a, Float const b, Float const c) { return {a.value*b.value + c.value}; }
+inline Float sqrt(Float const a) { return {std::sqrt(a.value)}; }
+inline Float abs(Float const a) { return {std::abs(a.value)}; }
+// 1 or -1 with the sign of a, including for zeros.
+inline Float sign(Float const a) { return {std::copysign(1.f, a.value)}; }
+inline Mask operator<(Float const a, Float const b) { return a.value < b.value; }
+inline Float select(Mask const mask, Float const if_true, Float const if_false) { return mask ? if_true : if_false; }
+
+inline std::size_t multiply(glm::mat4 const* const a, glm::mat4 const* const b, glm::mat4* const out, std::size_t const begin, std::size_t const end)
+{
+	for (auto i = begin; i < end; ++i) {
+		out[i] = a[i]*b[i];
+	}
+	return end;
+}
+
+#include "simd_kernels.hpp"
+
+} // namespace scalar
+
+#ifdef ANIMATION_RETARGETING_SSE2
+
+namespace sse2 {
+
+constexpr std::size_t width = 4;
+
+struct Float {
+	__m128 value;
+};
+struct Mask {
+	__m128 value;
+};
+inline Float load(float const* const source) { return {_mm_loadu_ps(source)}; }
+inline void store(float* const destination, Float const a) { _mm_storeu_ps(destination, a.value); }
+inline Float splat(float const a) { return {_mm_set1_ps(a)}; }
+inline Float operator+(Float const a, Float const b) { return {_mm_add_ps(a.value, b.value)}; }
+inline Float operator-(Float const a, Float const b) { return {_mm_sub_ps(a.value, b.value)}; }
+inline Float operator*(Float const a, Float const b) { return {_mm_mul_ps(a.value, b.value)}; }
+inline Float operator/(Float const a, Float const b) { return {_mm_div_ps(a.value, b.value)}; }
+inline Float multiply_add(Float const a, Float const b, Float const c) { return {_mm_add_ps(_mm_mul_ps(a.value, b.value), c.value)}; }
+inline Float sqrt(Float const a) { return {_mm_sqrt_ps(a.value)}; }
+inline Float abs(Float const a) { return {_mm_andnot_ps(_mm_set1_ps(-0.f), a.value)}; }
+inline Float sign(Float const a) { return {_mm_or_ps(_mm_and_ps(a.value, _mm_set1_ps(-0.f)), _mm_set1_ps(1.f))}; }
+inline Mask operator<(Float const a, Float const b) { return {_mm_cmplt_ps(a.value, b.value)}; }
+inline Float select(Mask const mask, Float const if_true, Float const if_false) {
+	return {_mm_or_ps(_mm_and_ps(mask.value, if_true.value), _mm_andnot_ps(mask.value, if_false.value))};
+}
+
+inline std::size_t multiply(glm::mat4 const* const a, glm::mat4 const* const b, glm::mat4* const out, std::size_t const begin, std::size_t const end)
+{
+	for (auto i = begin; i < end; ++i)
+	{
+		auto const* const left = &a[i][0][0];
+		auto const* const right = &b[i][0][0];
+		auto* const result = &out[i][0][0];
+
+		auto const column_0 = _mm_loadu_ps(left);
+		auto const column_1 = _mm_loadu_ps(left + 4);
+		auto const column_2 = _mm_loadu_ps(left + 8);
+		auto const column_3 = _mm_loadu_ps(left + 12);
+
+		// Each column of the result is the left matrix's columns weighted by the right column's components.
+		for (auto const column : {0, 4, 8, 12})
+		{
+			auto const weights = _mm_loadu_ps(right + column);
+			auto sum = _mm_mul_ps(column_0, _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(0, 0, 0, 0)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(column_1, _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(1, 1, 1, 1))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(column_2, _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(2, 2, 2, 2))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(column_3, _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(3, 3, 3, 3))));
+			_mm_storeu_ps(result + column, sum);
+		}
+	}
+	return end;
+}
+
+#include "simd_kernels.hpp"
+
+} // namespace sse2
+
+#endif
+
+#ifdef ANIMATION_RETARGETING_AVX
+
+// Everything up to the matching pop is compiled for AVX2, and only runs once the CPU is known to support it.
+#if defined(__clang__)
+#	pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#	pragma GCC push_options
+#	pragma GCC target("avx2,fma")
+#endif
+
+namespace avx2 {
+
+constexpr std::size_t width = 8;
+
+struct Float {
+	__m256 value;
+};
+struct Mask {
+	__m256 value;
+};
+inline Float load(float const* const source) { return {_mm256_loadu_ps(source)}; }
+inline void store(float* const destination, Float const a) { _mm256_storeu_ps(destination, a.value); }
+inline Float splat(float const a) { return {_mm256_set1_ps(a)}; }
+inline Float operator+(Float const a, Float const b) { return {_mm256_add_ps(a.value, b.value)}; }
+inline Float operator-(Float const a, Float const b) { return {_mm256_sub_ps(a.value, b.value)}; }
+inline Float operator*(Float const a, Float const b) { return {_mm256_mul_ps(a.value, b.value)}; }
+inline Float operator/(Float const a, Float const b) { return {_mm256_div_ps(a.value, b.value)}; }
+inline Float multiply_add(Float const a, Float const b, Float const c) { return {_mm256_fmadd_ps(a.value, b.value, c.value)}; }
+inline Float sqrt(Float const a) { return {_mm256_sqrt_ps(a.value)}; }
+inline Float abs(Float const a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.value)}; }
+inline Float sign(Float const a) { return {_mm256_or_ps(_mm256_and_ps(a.value, _mm256_set1_ps(-0.f)), _mm256_set1_ps(1.f))}; }
+inline Mask operator<(Float const a, Float const b) { return {_mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ)}; }
+inline Float select(Mask const mask, Float const if_true, Float const if_false) { return {_mm256_blendv_ps(if_false.value, if_true.value, mask.value)}; }
+
+inline __m256 broadcast_column_(float const* const column)
+{
+	auto const half = _mm_loadu_ps(column);
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(half), half, 1);
+}
+
+inline std::size_t multiply(glm::mat4 const* const a, glm::mat4 const* const b, glm::mat4* const out, std::size_t const begin, std::size_t const end)
+{
+	// Each register holds two columns, so a left column is repeated in both halves and the right column's
+	// components are repeated within each half.
+	for (auto i = begin; i < end; ++i)
+	{
+		auto const* const left = &a[i][0][0];
+		auto const* const right = &b[i][0][0];
+		auto* const result = &out[i][0][0];
+
+		auto const column_0 = broadcast_column_(left);
+		auto const column_1 = broadcast_column_(left + 4);
+		auto const column_2 = broadcast_column_(left + 8);
+		auto const column_3 = broadcast_column_(left + 12);
+
+		for (auto const columns : {0, 8})
+		{
+			auto const weights = _mm256_loadu_ps(right + columns);
+			auto sum = _mm256_mul_ps(column_0, _mm256_permute_ps(weights, _MM_SHUFFLE(0, 0, 0, 0)));
+			sum = _mm256_fmadd_ps(column_1, _mm256_permute_ps(weights, _MM_SHUFFLE(1, 1, 1, 1)), sum);
+			sum = _mm256_fmadd_ps(column_2, _mm256_permute_ps(weights, _MM_SHUFFLE(2, 2, 2, 2)), sum);
+			sum = _mm256_fmadd_ps(column_3, _mm256_permute_ps(weights, _MM_SHUFFLE(3, 3, 3, 3)), sum);
+			_mm256_storeu_ps(result + columns, sum);
+		}
+	}
+	return end;
+}
+
+#include "simd_kernels.hpp"
+
+} // namespace avx2
+
+#if defined(__clang__)
+#	pragma clang attribute pop
+#	pragma clang attribute push(__attribute__((target("avx512f,avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#	pragma GCC pop_options
+#	pragma GCC push_options
+#	pragma GCC target("avx512f,avx2,fma")
+#endif
+
+namespace avx512 {
+
+constexpr std::size_t width = 16;
+
+struct Float {
+	__m512 value;
+};
+struct Mask {
+	__mmask16 value;
+};
+inline Float load(float const* const source) { return {_mm512_loadu_ps(source)}; }
+inline void store(float* const destination, Float const a) { _mm512_storeu_ps(destination, a.value); }
+inline Float splat(float const a) { return {_mm512_set1_ps(a)}; }
+inline Float operator+(Float const a, Float const b) { return {_mm512_add_ps(a.value, b.value)}; }
+inline Float operator-(Float const a, Float const b) { return {_mm512_sub_ps(a.value, b.value)}; }
+inline Float operator*(Float const a, Float const b) { return {_mm512_mul_ps(a.value, b.value)}; }
+inline Float operator/(Float const a, Float const b) { return {_mm512_div_ps(a.value, b.value)}; }
+inline Float multiply_add(Float const a, Float const b, Float const c) { return {_mm512_fmadd_ps(a.value, b.value, c.value)}; }
+inline Float sqrt(Float const a) { return {_mm512_sqrt_ps(a.value)}; }
+inline Float abs(Float const a) { return {_mm512_abs_ps(a.value)}; }
+// The floating point bitwise operations need AVX-512DQ, so this uses the integer ones.
+inline Float sign(Float const a) {
+	auto const sign_bits = _mm512_and_epi32(_mm512_castps_si512(a.value), _mm512_set1_epi32(static_cast<int>(0x80000000u)));
+	return {_mm512_castsi512_ps(_mm512_or_epi32(sign_bits, _mm512_castps_si512(_mm512_set1_ps(1.f))))};
+}
+inline Mask operator<(Float const a, Float const b) { return {_mm512_cmp_ps_mask(a.value, b.value, _CMP_LT_OQ)}; }
+inline Float select(Mask const mask, Float const if_true, Float const if_false) { return {_mm512_mask_blend_ps(mask.value, if_false.value, if_true.value)}; }
+
+inline std::size_t multiply(glm::mat4 const* const a, glm::mat4 const* const b, glm::mat4* const out, std::size_t const begin, std::size_t const end)
+{
+	// One register holds a whole matrix. Each left column is repeated four times, and the right columns' components
+	// are repeated within each column.
+	for (auto i = begin; i < end; ++i)
+	{
+		auto const columns = _mm512_loadu_ps(&a[i][0][0]);
+		auto const weights = _mm512_loadu_ps(&b[i][0][0]);
+
+		auto sum = _mm512_mul_ps(_mm512_shuffle_f32x4(columns, columns, _MM_SHUFFLE(0, 0, 0, 0)), _mm512_shuffle_ps(weights, weights, _MM_SHUFFLE(0, 0, 0, 0)));
+		sum = _mm512_fmadd_ps(_mm512_shuffle_f32x4(columns, columns, _MM_SHUFFLE(1, 1, 1, 1)), _mm512_shuffle_ps(weights, weights, _MM_SHUFFLE(1, 1, 1, 1)), sum);
+		sum = _mm512_fmadd_ps(_mm512_shuffle_f32x4(columns, columns, _MM_SHUFFLE(2, 2, 2, 2)), _mm512_shuffle_ps(weights, weights, _MM_SHUFFLE(2, 2, 2, 2)), sum);
+		sum = _mm512_fmadd_ps(_mm512_shuffle_f32x4(columns, columns, _MM_SHUFFLE(3, 3, 3, 3)), _mm512_shuffle_ps(weights, weights, _MM_SHUFFLE(3, 3, 3, 3)), sum);
+		_mm512_storeu_ps(&out[i][0][0], sum);
+	}
+	return end;
+}
+
+#include "simd_kernels.hpp"
+
+} // namespace avx512
+
+#if defined(__clang__)
+#	pragma clang attribute pop
+#elif defined(__GNUC__)
+#	pragma GCC pop_options
+#endif
+
+#endif
+
+inline Kernels const& kernels(InstructionSet const instruction_set)
+{
+	static auto const scalar_kernels = Kernels{scalar::rotate, scalar::normalize, scalar::nlerp, scalar::slerp, scalar::compose, scalar::multiply, scalar::inverse_affine, scalar::decompose};
+#ifdef ANIMATION_RETARGETING_SSE2
+	static auto const sse2_kernels = Kernels{sse2::rotate, sse2::normalize, sse2::nlerp, sse2::slerp, sse2::compose, sse2::multiply, sse2::inverse_affine, sse2::decompose};
+#endif
+#ifdef ANIMATION_RETARGETING_AVX
+	static auto const avx2_kernels = Kernels{avx2::rotate, avx2::normalize, avx2::nlerp, avx2::slerp, avx2::compose, avx2::multiply, avx2::inverse_affine, avx2::decompose};
+	static auto const avx512_kernels = Kernels{avx512::rotate, avx512::normalize, avx512::nlerp, avx512::slerp, avx512::compose, avx512::multiply, avx512::inverse_affine, avx512::decompose};
+#endif
+
+	switch (instruction_set) {
+#ifdef ANIMATION_RETARGETING_AVX
+		case InstructionSet::avx512: return avx512_kernels;
+		case InstructionSet::avx2: return avx2_kernels;
+#endif
+#ifdef ANIMATION_RETARGETING_SSE2
+		case InstructionSet::sse2: return sse2_kernels;
+#endif
+		default: return scalar_kernels;
+	}
+}
+
+inline Kernels const& kernels() {
+	return kernels(instruction_set());
+}
+
+} // namespace detail
+
+// Rotates each vector by the quaternion at the same index. The output may be the same arrays as the vectors.
+inline void rotate(QuatArrays<float const> const rotations, Vec3Arrays<float const> const vectors, std::size_t const count, Vec3Arrays<float> const out)
+{
+	auto const done = detail::kernels().rotate(rotations, vectors, out, 0, count);
+	detail::scalar::rotate(rotations, vectors, out, done, count);
+}
+
+// Normalizes non-zero quaternions. The output may be the same arrays as the input.
+inline void normalize(QuatArrays<float const> const quaternions, std::size_t const count, QuatArrays<float> const out)
+{
+	auto const done = detail::kernels().normalize(quaternions, out, 0, count);
+	detail::scalar::normalize(quaternions, out, done, count);
+}
+
+// Normalized linear interpolation along the shortest path, like glm::normalize(glm::lerp(a, ±b, weight)).
+// It follows the same path as slerp, at a speed that varies by a few percent for the angles between animation keys.
+inline void nlerp(QuatArrays<float const> const a, QuatArrays<float const> const b, float const* const weights, std::size_t const count, QuatArrays<float> const out)
+{
+	auto const done = detail::kernels().nlerp(a, b, weights, out, 0, count);
+	detail::scalar::nlerp(a, b, weights, out, done, count);
+}
+
+// Spherical interpolation along the shortest path, like glm::slerp, for unit quaternions. The error is within 1e-7 for
+// rotations up to 90 degrees apart, which covers animation keys, and within 2e-5 for any two rotations.
+inline void slerp(QuatArrays<float const> const a, QuatArrays<float const> const b, float const* const weights, std::size_t const count, QuatArrays<float> const out)
+{
+	auto const done = detail::kernels().slerp(a, b, weights, out, 0, count);
+	detail::scalar::slerp(a, b, weights, out, done, count);
+}
+
+// Matrices of translate * rotate * scale, like glm::translate(translation) * glm::mat4_cast(rotation) * glm::scale(scale).
+inline void compose(Vec3Arrays<float const> const scales, QuatArrays<float const> const rotations, Vec3Arrays<float const> const translations, 
+	std::size_t const count, glm::mat4* const out)
+{
+	auto const done = detail::kernels().compose(scales, rotations, translations, out, 0, count);
+	detail::scalar::compose(scales, rotations, translations, out, done, count);
+}
+
+// out[i] = a[i]*b[i]. The output may be the same array as either input.
+inline void multiply(glm::mat4 const* const a, glm::mat4 const* const b, std::size_t const count, glm::mat4* const out) {
+	detail::kernels().multiply(a, b, out, 0, count);
+}
+
+// Inverts matrices whose last row is (0, 0, 0, 1), like bind transforms, with less work than glm::inverse.
+// The output may be the same array as the input.
+inline void inverse_affine(glm::mat4 const* const matrices, std::size_t const count, glm::mat4* const out)
+{
+	auto const done = detail::kernels().inverse_affine(matrices, out, 0, count);
+	detail::scalar::inverse_affine(matrices, out, done, count);
+}
+
+// Splits matrices whose last row is (0, 0, 0, 1) into scale, rotation and translation, like glm::decompose.
+// Sheared matrices lose their shear, and mirrored ones get negative scales.
+inline void decompose(glm::mat4 const* const matrices, std::size_t const count, 
+	Vec3Arrays<float> const scales, QuatArrays<float> const rotations, Vec3Arrays<float> const translations)
+{
+	auto const done = detail::kernels().decompose(matrices, scales, rotations, translations, 0, count);
+	detail::scalar::decompose(matrices, scales, rotations, translations, done, count);
+}
+
+// One array for each component of glm vectors or quaternions, for passing them to the kernels above.
+struct ComponentArrays {
+	std::array<std::vector<float>, 4> components;
+
+	ComponentArrays() = default;
+	explicit ComponentArrays(std::size_t const size) {
+		for (auto& component : components) {
+			component.resize(size);
+		}
+	}
+	template<typename T_>
+	explicit ComponentArrays(std::vector<T_> const& values) :
+		ComponentArrays{values.size()}
+	{
+		for (auto i = std::size_t{}; i < values.size(); ++i) {
+			set(i, values[i]);
+		}
+	}
+
+	std::size_t size() const {
+		return components[0].size();
+	}
+
+	Vec3Arrays<float const> vec3() const {
+		return {components[0].data(), components[1].data(), components[2].data()};
+	}
+	Vec3Arrays<float> vec3() {
+		return {components[0].data(), components[1].data(), components[2].data()};
+	}
+	QuatArrays<float const> quat() const {
+		return {components[0].data(), components[1].data(), components[2].data(), components[3].data()};
+	}
+	QuatArrays<float> quat() {
+		return {components[0].data(), components[1].data(), components[2].data(), components[3].data()};
+	}
+
+	glm::vec3 vec3(std::size_t const i) const {
+		return {components[0][i], components[1][i], components[2][i]};
+	}
+	glm::quat quat(std::size_t const i) const {
+		return {components[3][i], components[0][i], components[1][i], components[2][i]};
+	}
+	void set(std::size_t const i, glm::vec3 const value) {
+		components[0][i] = value.x;
+		components[1][i] = value.y;
+		components[2][i] = value.z;
+	}
+	void set(std::size_t const i, glm::quat const value) {
+		components[0][i] = value.x;
+		components[1][i] = value.y;
+		components[2][i] = value.z;
+		components[3][i] = value.w;
+	}
+};
+
+} // namespace simd
+} // namespace testing
+
+#endif
@@ -0,0 +1,307 @@
+/*
+	The kernels that are the same for every instruction set, written against Float, width and the operations on Float.
+	simd.hpp includes this file once for each instruction set, inside the namespace that defines those, so it has no include guard.
+*/
+
+struct Vec3_ {
+	Float x, y, z;
+};
+struct Quat_ {
+	Float x, y, z, w;
+};
+
+inline Vec3_ load_(Vec3Arrays<float const> const source, std::size_t const i) {
+	return {load(source.x + i), load(source.y + i), load(source.z + i)};
+}
+inline Quat_ load_(QuatArrays<float const> const source, std::size_t const i) {
+	return {load(source.x + i), load(source.y + i), load(source.z + i), load(source.w + i)};
+}
+inline void store_(Vec3Arrays<float> const destination, std::size_t const i, Vec3_ const& value) {
+	store(destination.x + i, value.x);
+	store(destination.y + i, value.y);
+	store(destination.z + i, value.z);
+}
+inline void store_(QuatArrays<float> const destination, std::size_t const i, Quat_ const& value) {
+	store(destination.x + i, value.x);
+	store(destination.y + i, value.y);
+	store(destination.z + i, value.z);
+	store(destination.w + i, value.w);
+}
+
+inline Float dot_(Vec3_ const& a, Vec3_ const& b) {
+	return multiply_add(a.x, b.x, multiply_add(a.y, b.y, a.z*b.z));
+}
+inline Float dot_(Quat_ const& a, Quat_ const& b) {
+	return multiply_add(a.x, b.x, multiply_add(a.y, b.y, multiply_add(a.z, b.z, a.w*b.w)));
+}
+inline Vec3_ cross_(Vec3_ const& a, Vec3_ const& b) {
+	return {a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x};
+}
+inline Vec3_ scaled_(Vec3_ const& v, Float const factor) {
+	return {v.x*factor, v.y*factor, v.z*factor};
+}
+// The part of the vector perpendicular to a unit vector.
+inline Vec3_ rejected_(Vec3_ const& v, Vec3_ const& unit)
+{
+	auto const projection = dot_(v, unit);
+	return {v.x - unit.x*projection, v.y - unit.y*projection, v.z - unit.z*projection};
+}
+inline Quat_ select_(Mask const mask, Quat_ const& if_true, Quat_ const& if_false) {
+	return {select(mask, if_true.x, if_false.x), select(mask, if_true.y, if_false.y), select(mask, if_true.z, if_false.z), select(mask, if_true.w, if_false.w)};
+}
+inline Quat_ normalized_(Quat_ const& q)
+{
+	auto const inverse_length = splat(1.f)/sqrt(dot_(q, q));
+	return {q.x*inverse_length, q.y*inverse_length, q.z*inverse_length, q.w*inverse_length};
+}
+
+// Matrices go through a block of twelve arrays, the upper three rows of each column, since the last row of an affine matrix is known.
+struct MatrixBlock_ {
+	alignas(64) float values[12][width];
+};
+inline void write_matrices_(MatrixBlock_ const& block, glm::mat4* const out)
+{
+	for (auto lane = std::size_t{}; lane < width; ++lane)
+	{
+		auto* const matrix = &out[lane][0][0];
+		for (auto const column : {0, 1, 2, 3}) {
+			matrix[column*4] = block.values[column*3][lane];
+			matrix[column*4 + 1] = block.values[column*3 + 1][lane];
+			matrix[column*4 + 2] = block.values[column*3 + 2][lane];
+			matrix[column*4 + 3] = column == 3 ? 1.f : 0.f;
+		}
+	}
+}
+inline void read_matrices_(glm::mat4 const* const matrices, MatrixBlock_& block)
+{
+	for (auto lane = std::size_t{}; lane < width; ++lane)
+	{
+		auto const* const matrix = &matrices[lane][0][0];
+		for (auto const column : {0, 1, 2, 3}) {
+			block.values[column*3][lane] = matrix[column*4];
+			block.values[column*3 + 1][lane] = matrix[column*4 + 1];
+			block.values[column*3 + 2][lane] = matrix[column*4 + 2];
+		}
+	}
+}
+inline Vec3_ load_column_(MatrixBlock_ const& block, int const column) {
+	return {load(block.values[column*3]), load(block.values[column*3 + 1]), load(block.values[column*3 + 2])};
+}
+inline void store_column_(MatrixBlock_& block, int const column, Vec3_ const& value) {
+	store(block.values[column*3], value.x);
+	store(block.values[column*3 + 1], value.y);
+	store(block.values[column*3 + 2], value.z);
+}
+
+/*
+	The terms of Eberly's polynomial approximation of slerp, from "A Fast and Accurate Algorithm for Computing SLERP".
+	Slerp's coefficients are series in (cos(angle) - 1), and eight terms with the last one corrected for the rest of the
+	series need no trigonometric functions or branches.
+*/
+inline Float slerp_coefficient_(Float const weight, Float const cosine_minus_1)
+{
+	constexpr float u[8] = {1.f/3.f, 1.f/10.f, 1.f/21.f, 1.f/36.f, 1.f/55.f, 1.f/78.f, 1.f/105.f, 1.85298109240830f/136.f};
+	constexpr float v[8] = {1.f/3.f, 2.f/5.f, 3.f/7.f, 4.f/9.f, 5.f/11.f, 6.f/13.f, 7.f/15.f, 1.85298109240830f*8.f/17.f};
+
+	auto const squared_weight = weight*weight;
+	auto const one = splat(1.f);
+	auto series = one;
+	for (auto i = 7; i >= 0; --i) {
+		series = multiply_add((splat(u[i])*squared_weight - splat(v[i]))*cosine_minus_1, series, one);
+	}
+	return weight*series;
+}
+
+inline std::size_t rotate(QuatArrays<float const> const rotations, Vec3Arrays<float const> const vectors, Vec3Arrays<float> const out,
+	std::size_t const begin, std::size_t const end)
+{
+	auto i = begin;
+	for (; i + width <= end; i += width)
+	{
+		auto const q = load_(rotations, i);
+		auto const v = load_(vectors, i);
+
+		// v + w*t + cross(q.xyz, t), where t = 2*cross(q.xyz, v).
+		auto const axis = Vec3_{q.x, q.y, q.z};
+		auto const half_t = cross_(axis, v);
+		auto const t = Vec3_{half_t.x + half_t.x, half_t.y + half_t.y, half_t.z + half_t.z};
+		auto const second = cross_(axis, t);
+		store_(out, i, {multiply_add(q.w, t.x, v.x) + second.x, multiply_add(q.w, t.y, v.y) + second.y, multiply_add(q.w, t.z, v.z) + second.z});
+	}
+	return i;
+}
+
+inline std::size_t normalize(QuatArrays<float const> const quaternions, QuatArrays<float> const out, std::size_t const begin, std::size_t const end)
+{
+	auto i = begin;
+	for (; i + width <= end; i += width) {
+		store_(out, i, normalized_(load_(quaternions, i)));
+	}
+	return i;
+}
+
+inline std::size_t nlerp(QuatArrays<float const> const a, QuatArrays<float const> const b, float const* const weights, QuatArrays<float> const out,
+	std::size_t const begin, std::size_t const end)
+{
+	auto i = begin;
+	for (; i + width <= end; i += width)
+	{
+		auto const start = load_(a, i);
+		auto const end_value = load_(b, i);
+		auto const weight = load(weights + i);
+		auto const end_sign = sign(dot_(start, end_value));
+
+		store_(out, i, normalized_(Quat_{
+			multiply_add(weight, end_value.x*end_sign - start.x, start.x),
+			multiply_add(weight, end_value.y*end_sign - start.y, start.y),
+			multiply_add(weight, end_value.z*end_sign - start.z, start.z),
+			multiply_add(weight, end_value.w*end_sign - start.w, start.w),
+		}));
+	}
+	return i;
+}
+
+inline std::size_t slerp(QuatArrays<float const> const a, QuatArrays<float const> const b, float const* const weights, QuatArrays<float> const out,
+	std::size_t const begin, std::size_t const end)
+{
+	auto i = begin;
+	for (; i + width <= end; i += width)
+	{
+		auto const start = load_(a, i);
+		auto const end_value = load_(b, i);
+		auto const weight = load(weights + i);
+
+		auto const cosine = dot_(start, end_value);
+		auto const cosine_minus_1 = abs(cosine) - splat(1.f);
+		auto const start_coefficient = slerp_coefficient_(splat(1.f) - weight, cosine_minus_1);
+		auto const end_coefficient = slerp_coefficient_(weight, cosine_minus_1)*sign(cosine);
+
+		store_(out, i, Quat_{
+			multiply_add(start.x, start_coefficient, end_value.x*end_coefficient),
+			multiply_add(start.y, start_coefficient, end_value.y*end_coefficient),
+			multiply_add(start.z, start_coefficient, end_value.z*end_coefficient),
+			multiply_add(start.w, start_coefficient, end_value.w*end_coefficient),
+		});
+	}
+	return i;
+}
+
+inline std::size_t compose(Vec3Arrays<float const> const scales, QuatArrays<float const> const rotations, Vec3Arrays<float const> const translations,
+	glm::mat4* const out, std::size_t const begin, std::size_t const end)
+{
+	auto block = MatrixBlock_{};
+	auto i = begin;
+	for (; i + width <= end; i += width)
+	{
+		auto const scale = load_(scales, i);
+		auto const q = load_(rotations, i);
+		auto const one = splat(1.f);
+
+		auto const x2 = q.x + q.x;
+		auto const y2 = q.y + q.y;
+		auto const z2 = q.z + q.z;
+		auto const xx = q.x*x2;
+		auto const yy = q.y*y2;
+		auto const zz = q.z*z2;
+		auto const xy = q.x*y2;
+		auto const xz = q.x*z2;
+		auto const yz = q.y*z2;
+		auto const wx = q.w*x2;
+		auto const wy = q.w*y2;
+		auto const wz = q.w*z2;
+
+		store_column_(block, 0, {(one - yy - zz)*scale.x, (xy + wz)*scale.x, (xz - wy)*scale.x});
+		store_column_(block, 1, {(xy - wz)*scale.y, (one - xx - zz)*scale.y, (yz + wx)*scale.y});
+		store_column_(block, 2, {(xz + wy)*scale.z, (yz - wx)*scale.z, (one - xx - yy)*scale.z});
+		store_column_(block, 3, load_(translations, i));
+		write_matrices_(block, out + i);
+	}
+	return i;
+}
+
+inline std::size_t inverse_affine(glm::mat4 const* const matrices, glm::mat4* const out, std::size_t const begin, std::size_t const end)
+{
+	auto block = MatrixBlock_{};
+	auto i = begin;
+	for (; i + width <= end; i += width)
+	{
+		read_matrices_(matrices + i, block);
+		auto const column_0 = load_column_(block, 0);
+		auto const column_1 = load_column_(block, 1);
+		auto const column_2 = load_column_(block, 2);
+		auto const translation = load_column_(block, 3);
+
+		// The rows of the inverse of the 3x3 part are the cross products of its columns over the determinant.
+		auto row_0 = cross_(column_1, column_2);
+		auto row_1 = cross_(column_2, column_0);
+		auto row_2 = cross_(column_0, column_1);
+		auto const inverse_determinant = splat(1.f)/dot_(column_0, row_0);
+		row_0 = {row_0.x*inverse_determinant, row_0.y*inverse_determinant, row_0.z*inverse_determinant};
+		row_1 = {row_1.x*inverse_determinant, row_1.y*inverse_determinant, row_1.z*inverse_determinant};
+		row_2 = {row_2.x*inverse_determinant, row_2.y*inverse_determinant, row_2.z*inverse_determinant};
+
+		auto const zero = splat(0.f);
+		store_column_(block, 0, {row_0.x, row_1.x, row_2.x});
+		store_column_(block, 1, {row_0.y, row_1.y, row_2.y});
+		store_column_(block, 2, {row_0.z, row_1.z, row_2.z});
+		store_column_(block, 3, {zero - dot_(row_0, translation), zero - dot_(row_1, translation), zero - dot_(row_2, translation)});
+		write_matrices_(block, out + i);
+	}
+	return i;
+}
+
+inline std::size_t decompose(glm::mat4 const* const matrices, Vec3Arrays<float> const scales, QuatArrays<float> const rotations, Vec3Arrays<float> const translations,
+	std::size_t const begin, std::size_t const end)
+{
+	auto block = MatrixBlock_{};
+	auto i = begin;
+	for (; i + width <= end; i += width)
+	{
+		read_matrices_(matrices + i, block);
+		auto const one = splat(1.f);
+		auto const zero = splat(0.f);
+
+		// Like glm::decompose, the columns are made orthonormal in order and a mirrored matrix gets negative scales.
+		auto column_0 = load_column_(block, 0);
+		auto const scale_x = sqrt(dot_(column_0, column_0));
+		column_0 = scaled_(column_0, one/scale_x);
+
+		auto column_1 = rejected_(load_column_(block, 1), column_0);
+		auto const scale_y = sqrt(dot_(column_1, column_1));
+		column_1 = scaled_(column_1, one/scale_y);
+
+		auto column_2 = rejected_(rejected_(load_column_(block, 2), column_0), column_1);
+		auto const scale_z = sqrt(dot_(column_2, column_2));
+		column_2 = scaled_(column_2, one/scale_z);
+
+		auto const handedness = sign(dot_(column_0, cross_(column_1, column_2)));
+		column_0 = scaled_(column_0, handedness);
+		column_1 = scaled_(column_1, handedness);
+		column_2 = scaled_(column_2, handedness);
+
+		/*
+			The rotation from the largest of 4x^2, 4y^2, 4z^2 and 4w^2, chosen without branches as in Mike Day's
+			"Converting a Rotation Matrix to a Quaternion". Each candidate is 4 times the quaternion times one of its components.
+		*/
+		auto const xx = column_0.x;
+		auto const yy = column_1.y;
+		auto const zz = column_2.z;
+		auto const x_candidate = Quat_{one + xx - yy - zz, column_1.x + column_0.y, column_2.x + column_0.z, column_1.z - column_2.y};
+		auto const y_candidate = Quat_{column_1.x + column_0.y, one - xx + yy - zz, column_2.y + column_1.z, column_2.x - column_0.z};
+		auto const z_candidate = Quat_{column_2.x + column_0.z, column_2.y + column_1.z, one - xx - yy + zz, column_0.y - column_1.x};
+		auto const w_candidate = Quat_{column_1.z - column_2.y, column_2.x - column_0.z, column_0.y - column_1.x, one + xx + yy + zz};
+
+		auto const x_or_y = select_(yy < xx, x_candidate, y_candidate);
+		auto const z_or_w = select_(xx < zero - yy, z_candidate, w_candidate);
+		auto const is_z_negative = zz < zero;
+		auto const rotation = select_(is_z_negative, x_or_y, z_or_w);
+		// The candidate's own squared component, which is the largest one.
+		auto const square = select(is_z_negative, select(yy < xx, x_or_y.x, x_or_y.y), select(xx < zero - yy, z_or_w.z, z_or_w.w));
+		auto const factor = splat(0.5f)/sqrt(square);
+
+		store_(scales, i, {scale_x*handedness, scale_y*handedness, scale_z*handedness});
+		store_(rotations, i, {rotation.x*factor, rotation.y*factor, rotation.z*factor, rotation.w*factor});
+		store_(translations, i, load_column_(block, 3));
+	}
+	return i;
+}
@@ -1,7 +1,12 @@
 #ifndef ANIMATION_RETARGETING_TESTING_SKELETON_HPP
 #define ANIMATION_RETARGETING_TESTING_SKELETON_HPP
 
-#include "fbx.hpp"
+#include "cooked.hpp"
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+#	include "fbx.hpp"
+#endif
+#include "gltf.hpp"
+#include "simd.hpp"
 #include "util.hpp"
 
 #include "animation_retargeting.hpp"
@@ -10,29 +15,115 @@
 #include <glad/glad.h>
 #include <glm/ext.hpp>
 #include <glm/gtx/component_wise.hpp>
-#include <glm/gtx/matrix_decompose.hpp>
 
 #include <algorithm>
 #include <array>
+#include <cassert>
 #include <chrono>
+#include <cmath>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace testing {
 
 using Seconds = std::chrono::duration<float>;
 
+// A bone's local scale, rotation and translation, which Bone::calculate_local_transform makes into a matrix.
+struct LocalTransform {
+	glm::vec3 scale{1.f};
+	glm::quat rotation{1.f, 0.f, 0.f, 0.f};
+	glm::vec3 translation{};
+};
+
 template<typename T>
 struct Keyframe {
 	Seconds time;
 	T value;
 };
 
+// Cubic interpolation follows a Catmull-Rom spline through the keys, which can take far fewer keys for smooth motion.
+enum class Interpolation { linear, cubic };
+
 template<typename T>
 class AnimationTrack {
 private:
 	std::vector<Keyframe<T>> keyframes_;
+	Interpolation interpolation_{Interpolation::linear};
+	// For rotations, whether the segment ending at each key turns too far to use nlerp instead of slerp.
+	std::vector<bool> slerp_segments_;
+
+	// Segments turning by more than this use slerp. Below it, nlerp strays from slerp by less than 0.01 degrees.
+	static constexpr float max_nlerp_degrees_ = 20.f;
 
+	// -1 if the value is on the other side of the quaternion hypersphere from the reference, so that the shorter way around is taken.
+	static float alignment_(glm::vec3, glm::vec3) {
+		return 1.f;
+	}
+	static float alignment_(glm::quat const reference, glm::quat const value) {
+		return glm::dot(reference, value) < 0.f ? -1.f : 1.f;
+	}
+	static bool is_close_(glm::vec3 const a, glm::vec3 const b) {
+		return glm::compMax(glm::abs(a - b)) <= 1e-6f;
+	}
+	static bool is_close_(glm::quat const a, glm::quat const b) {
+		return std::abs(glm::dot(a, b)) >= 1.f - 1e-6f;
+	}
+	static glm::vec3 normalized_(glm::vec3 const value) {
+		return value;
+	}
+	static glm::quat normalized_(glm::quat const rotation) {
+		return glm::normalize(rotation);
+	}
+	static glm::vec3 interpolate_linear_(glm::vec3 const start, glm::vec3 const end, float const weight, bool) {
+		return start + (end - start)*weight;
+	}
+	// The keys are in the same hemisphere, so nlerp takes the short way around like slerp.
+	static glm::quat interpolate_linear_(glm::quat const start, glm::quat const end, float const weight, bool const is_slerp_segment) {
+		return is_slerp_segment ? glm::slerp(start, end, weight) : glm::normalize(start*(1.f - weight) + end*weight);
+	}
+
+	static void align_keys_(std::vector<Keyframe<glm::vec3>>&, std::vector<bool>& slerp_segments) {
+		slerp_segments.clear();
+	}
+	// Flips the sign of rotation keys where needed, which doesn't change the rotation, so that each key is in the same
+	// hemisphere as the previous one, and flags the segments that turn too far for nlerp.
+	static void align_keys_(std::vector<Keyframe<glm::quat>>& keyframes, std::vector<bool>& slerp_segments)
+	{
+		auto const min_nlerp_cosine = std::cos(glm::radians(max_nlerp_degrees_)*0.5f);
+		slerp_segments.assign(keyframes.size(), false);
+		for (auto i = std::size_t{1}; i < keyframes.size(); ++i)
+		{
+			auto& value = keyframes[i].value;
+			auto cosine = glm::dot(keyframes[i - 1].value, value);
+			if (cosine < 0.f) {
+				value = -value;
+				cosine = -cosine;
+			}
+			slerp_segments[i] = cosine < min_nlerp_cosine;
+		}
+	}
+	void align_keys_() {
+		align_keys_(keyframes_, slerp_segments_);
+	}
+
+	// The slope at a key from its neighbours, as in a Catmull-Rom spline with unevenly spaced keys.
+	T tangent_(std::size_t const key) const
+	{
+		auto const previous = key ? key - 1 : key;
+		auto const next = std::min(key + 1, keyframes_.size() - 1);
+		auto const& value = keyframes_[key].value;
+		auto const span = (keyframes_[next].time - keyframes_[previous].time).count();
+		if (span <= 0.f) {
+			return value*0.f;
+		}
+		auto const next_value = keyframes_[next].value*alignment_(value, keyframes_[next].value);
+		auto const previous_value = keyframes_[previous].value*alignment_(value, keyframes_[previous].value);
+		return (next_value - previous_value)*(1.f/span);
+	}
+
+#ifdef ANIMATION_RETARGETING_FBX_SDK
 	template<typename U = T>
 	static auto create_value_(FbxDouble3 const vector)
 		-> std::enable_if_t<std::is_same<U, glm::vec3>::value, U>
@@ -46,12 +137,62 @@ private:
 		return glm::quat{glm::radians(util::fbx_to_glm(vector))};
 	}
 
+	template<typename U = T>
+	static auto create_values_(fbx::PropertyKeys& keys)
+		-> std::enable_if_t<std::is_same<U, glm::vec3>::value, std::vector<U>>
+	{
+		auto values = std::vector<U>(keys.times.size());
+		for (auto const i : util::indices(values)) {
+			values[i] = U{keys.components[0][i], keys.components[1][i], keys.components[2][i]};
+		}
+		return values;
+	}
+	template<typename U = T>
+	static auto create_values_(fbx::PropertyKeys& keys)
+		-> std::enable_if_t<std::is_same<U, glm::quat>::value, std::vector<U>>
+	{
+		for (auto& component : keys.components) {
+			for (auto& angle : component) {
+				angle = glm::radians(angle);
+			}
+		}
+		auto values = std::vector<U>(keys.times.size());
+		simd::euler_xyz_to_quat(keys.components[0].data(), keys.components[1].data(), keys.components[2].data(), values.size(), values.data());
+		return values;
+	}
+#endif
+
 public:
 	AnimationTrack() = default;
 
 	explicit AnimationTrack(std::vector<Keyframe<T>> keyframes) :
 		keyframes_{std::move(keyframes)}
-	{}
+	{
+		align_keys_();
+	}
+	AnimationTrack(util::Span<float const> const times, util::Span<T const> const values)
+	{
+		assert(times.size() == values.size());
+
+		keyframes_.reserve(times.size());
+		for (auto const i : util::indices(times)) {
+			keyframes_.push_back(Keyframe<T>{Seconds{times[i]}, values[i]});
+		}
+		align_keys_();
+	}
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+	// Builds the track from raw curve keys. This is much faster than evaluating the property at every key.
+	explicit AnimationTrack(fbx::PropertyKeys keys)
+	{
+		auto const values = create_values_(keys);
+
+		keyframes_.reserve(values.size());
+		for (auto const i : util::indices(values)) {
+			keyframes_.push_back(Keyframe<T>{Seconds{keys.times[i]}, values[i]});
+		}
+		align_keys_();
+	}
+	// Builds the track by evaluating the property with the FBX SDK at every key.
 	AnimationTrack(FbxAnimLayer* const layer, FbxPropertyT<FbxDouble3>& property)
 	{
 		auto const curves = std::array<FbxAnimCurve const*, 3>{
@@ -93,9 +234,29 @@ public:
 					create_value_(property.EvaluateValue(time))
 				});
 			}
+			align_keys_();
+		}
+	}
+#endif
+
+	template<typename Function_>
+	void transform_values(Function_ const& function) {
+		for (auto& keyframe : keyframes_) {
+			keyframe.value = function(keyframe.value);
 		}
+		align_keys_();
 	}
 
+	std::vector<float> extract_times() const
+	{
+		auto times = std::vector<float>{};
+		times.reserve(keyframes_.size());
+
+		for (auto const& keyframe : keyframes_) {
+			times.push_back(keyframe.time.count());
+		}
+		return times;
+	}
 	std::vector<T> extract_values() const
 	{
 		auto values = std::vector<T>{};
@@ -106,15 +267,73 @@ public:
 		}
 		return values;
 	}
-	void set_values(std::vector<T> const& values) {
-		for (auto const i : util::indices(keyframes_)) {
-			keyframes_[i].value = values[i];
+	/*
+		Replaces the keys' values, keeping their times. The track is rebuilt from the number of values, since a channel can be 
+		collapsed differently on each side of retargeting: no values clear the track and a single value makes it one key at 
+		time 0, whatever it had before. Any other number of values has to match the number of keys.
+	*/
+	void set_values(std::vector<T> const& values)
+	{
+		if (values.size() <= 1)
+		{
+			keyframes_.clear();
+			if (!values.empty()) {
+				keyframes_.push_back(Keyframe<T>{Seconds{}, values.front()});
+			}
+		}
+		else if (values.size() == keyframes_.size()) {
+			for (auto const i : util::indices(keyframes_)) {
+				keyframes_[i].value = values[i];
+			}
+		}
+		else {
+			throw std::runtime_error{fmt::format("Can't set {} values on an animation track with {} keys.", values.size(), keyframes_.size())};
+		}
+		align_keys_();
+	}
+
+	/*
+		Keeps only the first key if every key has the same value, within a small tolerance. If that value is also the
+		default value, which is what an empty track evaluates to, no key is kept at all.
+	*/
+	void collapse_if_constant(T const default_value)
+	{
+		if (!collapse_if_constant()) {
+			return;
+		}
+		if (is_close_(keyframes_.front().value, default_value)) {
+			keyframes_.clear();
+		}
+	}
+	// Returns whether the track has at most one key now.
+	bool collapse_if_constant()
+	{
+		if (keyframes_.size() > 1 && std::all_of(keyframes_.begin() + 1, keyframes_.end(), [&](Keyframe<T> const& key) { return is_close_(key.value, keyframes_.front().value); })) {
+			keyframes_.resize(1);
+			align_keys_();
 		}
+		return keyframes_.size() <= 1;
 	}
 
 	bool is_empty() const {
 		return keyframes_.empty();
 	}
+	Interpolation interpolation() const {
+		return interpolation_;
+	}
+	void set_interpolation(Interpolation const interpolation) {
+		interpolation_ = interpolation;
+	}
+	std::size_t key_count() const {
+		return keyframes_.size();
+	}
+	std::vector<Keyframe<T>> const& keyframes() const {
+		return keyframes_;
+	}
+	// Whether linear interpolation between the key before end_key and end_key uses slerp instead of nlerp.
+	bool is_slerp_segment(std::size_t const end_key) const {
+		return end_key < slerp_segments_.size() && slerp_segments_[end_key];
+	}
 
 	Seconds duration() const {
 		return keyframes_.empty() ? Seconds{} : keyframes_.back().time;
@@ -133,9 +352,114 @@ public:
 			return keyframes_.back().value;
 		}
 
-		auto const start_key = end_key - 1;
+		return evaluate_segment(static_cast<std::size_t>(end_key - keyframes_.begin()), time);
+	}
+
+	// Interpolates between the key before end_key and end_key, for callers that find the keys themselves.
+	T evaluate_segment(std::size_t const end_key, Seconds const time) const
+	{
+		auto const& start = keyframes_[end_key - 1];
+		auto const& end = keyframes_[end_key];
+
+		if (interpolation_ == Interpolation::linear) {
+			return interpolate_linear_(start.value, end.value, (time - start.time)/(end.time - start.time), is_slerp_segment(end_key));
+		}
+
+		// Cubic Hermite basis functions, with the tangents scaled to the length of the segment.
+		auto const length = (end.time - start.time).count();
+		auto const s = length > 0.f ? (time - start.time).count()/length : 0.f;
+		auto const s2 = s*s;
+		auto const s3 = s2*s;
+		auto const end_alignment = alignment_(start.value, end.value);
+
+		return normalized_(
+			start.value*(2.f*s3 - 3.f*s2 + 1.f) + 
+			tangent_(end_key - 1)*((s3 - 2.f*s2 + s)*length) + 
+			end.value*((3.f*s2 - 2.f*s3)*end_alignment) + 
+			tangent_(end_key)*((s3 - s2)*length*end_alignment)
+		);
+	}
+
+	/*
+		Removes keys while the track stays within the tolerance of every original key, where error(a, b) measures the
+		difference between two values. The interpolation is set first, so with cubic interpolation the kept keys are
+		the ones a spline through them needs.
+	*/
+	template<typename Error_>
+	void reduce(float const tolerance, Interpolation const interpolation, Error_ const& error)
+	{
+		interpolation_ = interpolation;
+
+		auto const key_count = keyframes_.size();
+		if (key_count <= 2) {
+			return;
+		}
+		auto const original = keyframes_;
+
+		// The kept keys as a linked list over the original keys. The ends link to themselves.
+		auto previous = std::vector<std::size_t>(key_count);
+		auto next = std::vector<std::size_t>(key_count);
+		for (auto const i : util::indices(key_count)) {
+			previous[i] = i ? i - 1 : i;
+			next[i] = std::min(i + 1, key_count - 1);
+		}
+		auto const step = [](std::vector<std::size_t> const& links, std::size_t key, int const count) {
+			for (auto i = 0; i < count; ++i) {
+				key = links[key];
+			}
+			return key;
+		};
+
+		// Removing a key changes the segments next to it, and with cubic interpolation also the tangents of its neighbours.
+		auto const reach = interpolation == Interpolation::cubic ? 2 : 1;
+
+		auto local = AnimationTrack{};
+		local.interpolation_ = interpolation;
+
+		for (auto was_reduced = true; was_reduced;)
+		{
+			was_reduced = false;
+			for (auto key = next[0]; key != key_count - 1;)
+			{
+				auto const following = next[key];
+
+				// The kept keys around the key, without it.
+				local.keyframes_.clear();
+				auto const last_key = step(next, key, reach + 1);
+				for (auto k = step(previous, key, reach + 1);; k = next[k])
+				{
+					if (k != key) {
+						local.keyframes_.push_back(original[k]);
+					}
+					if (k == last_key) {
+						break;
+					}
+				}
+				local.align_keys_();
+
+				auto is_within_tolerance = true;
+				auto const last_checked_key = step(next, key, reach);
+				for (auto k = step(previous, key, reach); k <= last_checked_key && is_within_tolerance; ++k) {
+					is_within_tolerance = error(original[k].value, local.evaluate(original[k].time)) <= tolerance;
+				}
+				if (is_within_tolerance) {
+					next[previous[key]] = next[key];
+					previous[next[key]] = previous[key];
+					was_reduced = true;
+				}
+				key = following;
+			}
+		}
 
-		return util::map(start_key->time.count(), end_key->time.count(), start_key->value, end_key->value, time.count());
+		keyframes_.clear();
+		for (auto key = std::size_t{};; key = next[key])
+		{
+			keyframes_.push_back(original[key]);
+			if (key == key_count - 1) {
+				break;
+			}
+		}
+		align_keys_();
 	}
 
 	T evaluate(Seconds const time, T const default_value) const {
@@ -148,9 +472,13 @@ public:
 
 struct Bone {
 	using Id = unsigned int;
+	static constexpr auto no_parent = static_cast<Id>(-1);
 
-	Bone const* parent;
+	// The parent's id, so that bones don't point into the skeleton's storage and it can move.
+	Id parent{no_parent};
 	std::string name;
+	// The name interned with animation_retargeting::intern_name.
+	animation_retargeting::NameId name_id{animation_retargeting::no_name};
 
 	// The bone's index in the skeleton's bone array.
 	Id id;
@@ -186,11 +514,23 @@ struct Bone {
 	{
 		return post_translation * glm::translate(glm::mat4{1.f}, translation) * pre_translation * glm::mat4_cast(rotation) * pre_rotation * glm::scale(glm::mat4{1.f}, scale) * pre_scaling;
 	}
+	bool has_parent() const {
+		return parent != no_parent;
+	}
+
+	// Whether the local transform is just translation * rotation * scale, without pivots.
+	bool has_identity_pivots() const
+	{
+		auto const identity = glm::mat4{1.f};
+		return pre_scaling == identity && pre_rotation == identity && pre_translation == identity && post_translation == identity;
+	}
 
 	Bone() = default;
-	Bone(Bone const* parent, std::string name, Id const id, FbxNode* const bone_node) :
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+	Bone(Id const parent, std::string name, Id const id, FbxNode* const bone_node) :
 		parent{parent},
 		name{std::move(name)},
+		name_id{animation_retargeting::intern_name(this->name)},
 		id{id},
 		bind_transform{util::fbx_to_glm(bone_node->EvaluateGlobalTransform())}
 	{
@@ -213,7 +553,7 @@ struct Bone {
 		pre_translation = glm::translate(glm::mat4{1.f}, util::fbx_to_glm(bone_node->GetRotationOffset(FbxNode::eSourcePivot)) + fbx_rotation_pivot) * fbx_pre_rotation;
 
 		// Add the parent node's global transform if this is a root bone.
-		post_translation = parent ? glm::mat4{1.f} : util::fbx_to_glm(bone_node->GetParent()->EvaluateGlobalTransform());
+		post_translation = parent != no_parent ? glm::mat4{1.f} : util::fbx_to_glm(bone_node->GetParent()->EvaluateGlobalTransform());
 
 		// bone.local_bind_scale = util::fbx_to_glm(bone_node->LclScaling.Get());
 		// bone.local_bind_rotation = glm::quat{glm::radians(util::fbx_to_glm(bone_node->LclRotation.Get()))};
@@ -223,14 +563,65 @@ struct Bone {
 
 		// bone.bind_transform = parent ? parent->bind_transform * local_transform : local_transform;
 	}
+#endif
+	Bone(Id const parent, std::string name, Id const id, cooked::BoneRecord const& record) :
+		parent{parent},
+		name{std::move(name)},
+		name_id{animation_retargeting::intern_name(this->name)},
+		id{id},
+		bind_transform{record.bind_transform},
+		pre_scaling{record.pre_scaling},
+		pre_rotation{record.pre_rotation},
+		pre_translation{record.pre_translation},
+		post_translation{record.post_translation},
+		local_bind_scale{record.local_bind_scale},
+		local_bind_rotation{record.local_bind_rotation},
+		local_bind_translation{record.local_bind_translation}
+	{
+		inverse_bind_transform = glm::inverse(bind_transform);
+	}
+	// glTF nodes have no pivots, so only a root bone's parent node transform is kept.
+	Bone(Id const parent, Id const id, gltf::Joint const& joint) :
+		parent{parent},
+		name{joint.name},
+		name_id{animation_retargeting::intern_name(name)},
+		id{id},
+		bind_transform{joint.bind_transform},
+		pre_scaling{1.f},
+		pre_rotation{1.f},
+		pre_translation{1.f},
+		post_translation{joint.parent_transform}
+	{}
 };
 
+/*
+	Bones are stored parents first in a vector sized to the rig, and refer to their parents by id.
+	Nothing points into the storage, so a skeleton can be moved and copied like any value and has no bone limit.
+*/
 class Skeleton {
+public:
+	// A set of bones, where bit n is the bone with id n.
+	using BoneMask = util::BitSet;
+
 private:
-	using Bones_ = util::StaticVector<Bone, 256>;
-	std::unique_ptr<Bones_> bones_ = std::make_unique<Bones_>();
+	std::vector<Bone> bones_;
+
+	// Bone ids by interned name, so that finding a bone by name hashes the name once instead of comparing it with every bone's.
+	animation_retargeting::NameIndex bone_ids_by_name_;
 
-	void add_bone_(FbxNode* const bone_node, Bone const* parent)
+	// Bones whose tracks have at most one key, and their local transforms, which never change. See update_static_bones.
+	BoneMask static_bones_;
+	std::vector<glm::mat4> static_local_transforms_;
+
+	Bone::Id push_bone_(Bone bone)
+	{
+		bone_ids_by_name_.add(bone.name_id, bone.id);
+		bones_.push_back(std::move(bone));
+		return bones_.back().id;
+	}
+
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+	void add_bone_(FbxNode* const bone_node, Bone::Id parent)
 	{
 		auto const name = util::trimmed_bone_name(bone_node);
 		
@@ -238,31 +629,23 @@ private:
 			return;
 		}
 
-		bones_->push_back(Bone{parent, name, static_cast<Bone::Id>(bones_->size()), bone_node});
-
-		parent = &bones_->back();
+		parent = push_bone_(Bone{parent, name, static_cast<Bone::Id>(bones_.size()), bone_node});
 
 		for (auto const i : util::indices(bone_node->GetChildCount())) {
 			add_bone_(bone_node->GetChild(i), parent);
 		}    
 	}
-	
-	auto bone_iterator_by_name_(char const* const name) const
-	{
-		return std::find_if(bones_->begin(), bones_->end(), [&](Bone const& bone) { return bone.name == name; });
-	}
-	auto bone_iterator_by_name_(char const* const name)
-	{
-		return std::find_if(bones_->begin(), bones_->end(), [&](Bone const& bone) { return bone.name == name; });
-	}
+#endif
 	
 public:
+#ifdef ANIMATION_RETARGETING_FBX_SDK
 	void load_from_fbx_node(FbxNode* const node) 
 	{
 		
 		if (auto const* const attribute = node->GetNodeAttribute()) {
 			if (attribute->GetAttributeType() == FbxNodeAttribute::eSkeleton) {
-				add_bone_(node, nullptr);
+				add_bone_(node, Bone::no_parent);
+				bones_.shrink_to_fit();
 				return;
 			}
 		}
@@ -271,30 +654,180 @@ public:
 			load_from_fbx_node(node->GetChild(i));
 		}		
 	}
+#endif
+
+	// Bones are stored parents first, so parent indices always refer to bones that were already added.
+	void load_from_cooked(cooked::File const& file)
+	{
+		bones_.reserve(bones_.size() + file.bones().size());
+		for (auto const& record : file.bones())
+		{
+			if (record.parent != cooked::no_parent && record.parent >= bones_.size()) {
+				throw std::runtime_error{"A cooked bone refers to a parent that comes after it."};
+			}
+			auto const parent = record.parent == cooked::no_parent ? Bone::no_parent : static_cast<Bone::Id>(record.parent);
+			push_bone_(Bone{parent, file.string(record.name), static_cast<Bone::Id>(bones_.size()), record});
+		}
+	}
+
+	// Joints are ordered parents first. End bones and everything below them are left out, like in FBX skeletons.
+	void load_from_gltf(gltf::Skin const& skin)
+	{
+		// The bone of each joint, or no_parent for the joints that were left out.
+		auto bone_ids = std::vector<Bone::Id>(skin.joints.size(), Bone::no_parent);
+
+		for (auto const i : util::indices(skin.joints))
+		{
+			auto const& joint = skin.joints[i];
+			auto const parent = joint.parent == gltf::no_parent ? Bone::no_parent : bone_ids[joint.parent];
+
+			if (util::is_end_bone(joint.name) || (joint.parent != gltf::no_parent && parent == Bone::no_parent)) {
+				continue;
+			}
+			bone_ids[i] = push_bone_(Bone{parent, static_cast<Bone::Id>(bones_.size()), joint});
+		}
+		bones_.shrink_to_fit();
+	}
+
+	void cook(cooked::Writer& writer) const
+	{
+		for (auto const& bone : bones_)
+		{
+			writer.add_bone(bone.name.c_str(), bone.has_parent() ? bone.parent : cooked::no_parent, cooked::BoneRecord{
+				0, 0,
+				bone.bind_transform,
+				bone.pre_scaling,
+				bone.pre_rotation,
+				bone.pre_translation,
+				bone.post_translation,
+				bone.local_bind_scale,
+				bone.local_bind_rotation,
+				bone.local_bind_translation,
+			});
+		}
+	}
+
+	// Adds the bones' non-empty tracks to a cooked file.
+	void cook_animation(cooked::Writer& writer) const
+	{
+		for (auto const& bone : bones_)
+		{
+			auto const add_track = [&](cooked::Channel const channel, auto const& track) {
+				if (!track.is_empty()) {
+					writer.add_track(bone.name.c_str(), channel, track.extract_times(), track.extract_values());
+				}
+			};
+			add_track(cooked::Channel::scale, bone.scale_track);
+			add_track(cooked::Channel::rotation, bone.rotation_track);
+			add_track(cooked::Channel::translation, bone.translation_track);
+		}
+	}
+
+	/*
+		Removes the keys that the tracks can do without, keeping the bones' tracks within the tolerance of the original keys
+		in bone space. Rotation and scale error is measured at the bone's furthest descendant, or min_distance away from it if that is further.
+		Retargeting needs the keys of the source and target tracks to match, so this runs after it.
+	*/
+	void reduce_keyframes(float const tolerance, Interpolation const interpolation, float const min_distance)
+	{
+		auto distances = std::vector<float>(bones_.size(), min_distance);
+		for (auto const& bone : bones_) {
+			for (auto ancestor = bone.parent; ancestor != Bone::no_parent; ancestor = bones_[ancestor].parent) {
+				distances[ancestor] = std::max(distances[ancestor], glm::length(glm::vec3{bone.bind_transform[3] - bones_[ancestor].bind_transform[3]}));
+			}
+		}
+
+		for (auto& bone : bones_)
+		{
+			auto const distance = distances[bone.id];
+			bone.scale_track.reduce(tolerance, interpolation, [&](glm::vec3 const a, glm::vec3 const b) {
+				return glm::length(a - b)*distance;
+			});
+			// |a - b| is about half the angle between close rotations.
+			bone.rotation_track.reduce(tolerance, interpolation, [&](glm::quat const a, glm::quat const b) {
+				return 2.f*distance*std::min(glm::length(a - b), glm::length(a + b));
+			});
+			bone.translation_track.reduce(tolerance, interpolation, [](glm::vec3 const a, glm::vec3 const b) {
+				return glm::length(a - b);
+			});
+		}
+	}
+
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+	// Brings bones loaded from an unconverted FBX scene into the target coordinate system.
+	void convert_coordinates(fbx::CoordinateConversion const& conversion)
+	{
+		if (conversion.is_identity()) {
+			return;
+		}
+		for (auto& bone : bones_) {
+			bone.bind_transform = conversion.convert_matrix(bone.bind_transform);
+			bone.pre_scaling = conversion.convert_matrix(bone.pre_scaling);
+			bone.pre_rotation = conversion.convert_matrix(bone.pre_rotation);
+			bone.pre_translation = conversion.convert_matrix(bone.pre_translation);
+			bone.post_translation = conversion.convert_matrix(bone.post_translation);
+		}
+	}
+#endif
 
+	// Each step is one batch over the whole skeleton: the inverse bind transforms, then the local bind transforms, then their components.
 	void calculate_local_bind_components() 
 	{
-		for (auto& bone : *bones_) {
-			bone.inverse_bind_transform = glm::inverse(bone.bind_transform);
+		auto& bones = bones_;
+		auto const bone_count = bones.size();
+
+		auto bind_transforms = std::vector<glm::mat4>(bone_count);
+		for (auto const& bone : bones) {
+			bind_transforms[bone.id] = bone.bind_transform;
+		}
+		auto inverse_bind_transforms = std::vector<glm::mat4>(bone_count);
+		simd::inverse_affine(bind_transforms.data(), bone_count, inverse_bind_transforms.data());
 
-			auto const local = bone.parent ? bone.parent->inverse_bind_transform * bone.bind_transform : glm::inverse(bone.post_translation) * bone.bind_transform;
-			glm::vec3 skew;
-			glm::vec4 perspective;
-			glm::decompose(local, bone.local_bind_scale, bone.local_bind_rotation, bone.local_bind_translation, skew, perspective);
+		// A local bind transform is the parent's inverse bind transform times the bind transform, and roots use their post-translation instead.
+		auto parent_inverses = std::vector<glm::mat4>(bone_count);
+		for (auto& bone : bones)
+		{
+			bone.inverse_bind_transform = inverse_bind_transforms[bone.id];
+			if (bone.has_parent()) {
+				parent_inverses[bone.id] = inverse_bind_transforms[bone.parent];
+			}
+			else {
+				simd::inverse_affine(&bone.post_translation, 1, &parent_inverses[bone.id]);
+			}
 		}
+		auto local_transforms = std::vector<glm::mat4>(bone_count);
+		simd::multiply(parent_inverses.data(), bind_transforms.data(), bone_count, local_transforms.data());
+
+		auto scales = simd::ComponentArrays{bone_count};
+		auto rotations = simd::ComponentArrays{bone_count};
+		auto translations = simd::ComponentArrays{bone_count};
+		simd::decompose(local_transforms.data(), bone_count, scales.vec3(), rotations.quat(), translations.vec3());
+		for (auto& bone : bones) {
+			bone.local_bind_scale = scales.vec3(bone.id);
+			bone.local_bind_rotation = rotations.quat(bone.id);
+			bone.local_bind_translation = translations.vec3(bone.id);
+		}
+		update_static_bones();
 	}
 
+	// Tracks with the same key times share a time axis.
 	auto extract_animation() const 
 		-> animation_retargeting::Animation
 	{
 		auto animation = animation_retargeting::Animation{};
-		animation.bones.reserve(bones_->size());
+		animation.bones.reserve(bones_.size());
 		
-		for (auto const& bone : *bones_) {
+		auto const add_time_axis = [&](auto const& track) {
+			return track.is_empty() ? animation_retargeting::AnimatedBone::no_time_axis : animation_retargeting::add_time_axis(animation, track.extract_times());
+		};
+		for (auto const& bone : bones_) {
 			animation.bones.push_back(animation_retargeting::AnimatedBone{
 				bone.scale_track.extract_values(),
 				bone.rotation_track.extract_values(),
-				bone.translation_track.extract_values()
+				bone.translation_track.extract_values(),
+				add_time_axis(bone.scale_track),
+				add_time_axis(bone.rotation_track),
+				add_time_axis(bone.translation_track),
 			});
 		}
 		return animation;
@@ -303,12 +836,12 @@ public:
 		-> animation_retargeting::Pose
 	{
 		auto pose = animation_retargeting::Pose{};
-		pose.bones.reserve(bones_->size());
+		pose.bones.reserve(bones_.size());
 		
-		for (auto const& bone : *bones_) {
+		for (auto const& bone : bones_) {
 			pose.bones.push_back(animation_retargeting::PoseBone{
-				bone.name,
-				bone.parent ? bone.parent->id : animation_retargeting::PoseBone::no_parent,
+				bone.name_id,
+				bone.has_parent() ? std::size_t{bone.parent} : animation_retargeting::PoseBone::no_parent,
 				bone.local_bind_scale,
 				bone.local_bind_rotation,
 				bone.local_bind_translation,
@@ -322,67 +855,175 @@ public:
 	{
 		for (auto const i : util::indices(animation.bones))
 		{
-			auto& bone = (*bones_)[i];
+			auto& bone = bones_[i];
 			auto const& animation_bone = animation.bones[i];
 			bone.scale_track.set_values(animation_bone.scales);
 			bone.rotation_track.set_values(animation_bone.rotations);
 			bone.translation_track.set_values(animation_bone.translations);
 		}
+		update_static_bones();
+	}
+
+	void clear_animation()
+	{
+		for (auto& bone : bones_) {
+			bone.scale_track = {};
+			bone.rotation_track = {};
+			bone.translation_track = {};
+		}
+		update_static_bones();
+	}
+
+	// Collapses the tracks that never change to a single key, or to none if that is the bind value. See AnimationTrack::collapse_if_constant.
+	void collapse_constant_tracks()
+	{
+		for (auto& bone : bones_) {
+			bone.scale_track.collapse_if_constant(bone.local_bind_scale);
+			bone.rotation_track.collapse_if_constant(bone.local_bind_rotation);
+			bone.translation_track.collapse_if_constant(bone.local_bind_translation);
+		}
+		update_static_bones();
+	}
+
+	/*
+		Finds the bones whose local transforms never change and calculates them, so that sampling can skip them.
+		Has to be called again when the tracks or the bind pose change, which the skeleton's own functions do.
+	*/
+	void update_static_bones()
+	{
+		static_bones_.reset();
+		static_local_transforms_.resize(bones_.size());
+		for (auto const& bone : bones_)
+		{
+			if (bone.scale_track.key_count() > 1 || bone.rotation_track.key_count() > 1 || bone.translation_track.key_count() > 1) {
+				continue;
+			}
+			static_bones_.set(bone.id);
+			static_local_transforms_[bone.id] = bone.calculate_local_transform(
+				bone.scale_track.evaluate(Seconds{}, bone.local_bind_scale), 
+				bone.rotation_track.evaluate(Seconds{}, bone.local_bind_rotation), 
+				bone.translation_track.evaluate(Seconds{}, bone.local_bind_translation)
+			);
+		}
 	}
 
+	// The local transforms are composed and the bind transforms inverted in batches. Only bones with pivots compose their own.
 	void set_bind_pose(animation_retargeting::Pose const& pose)
 	{
+		auto const bone_count = pose.bones.size();
+
+		auto scales = simd::ComponentArrays{bone_count};
+		auto rotations = simd::ComponentArrays{bone_count};
+		auto translations = simd::ComponentArrays{bone_count};
+		for (auto const i : util::indices(pose.bones)) {
+			scales.set(i, pose.bones[i].scale);
+			rotations.set(i, pose.bones[i].rotation);
+			translations.set(i, pose.bones[i].translation);
+		}
+		auto local_transforms = std::vector<glm::mat4>(bone_count);
+		simd::compose(std::as_const(scales).vec3(), std::as_const(rotations).quat(), std::as_const(translations).vec3(), bone_count, local_transforms.data());
+
+		auto bind_transforms = std::vector<glm::mat4>(bone_count);
 		for (auto const i : util::indices(pose.bones))
 		{
-			auto& bone = (*bones_)[i];
+			auto& bone = bones_[i];
 			bone.local_bind_scale = pose.bones[i].scale;
 			bone.local_bind_rotation = pose.bones[i].rotation;
 			bone.local_bind_translation = pose.bones[i].translation;
 			
-			auto const local = bone.calculate_local_transform(bone.local_bind_scale, bone.local_bind_rotation, bone.local_bind_translation);
+			auto& local = local_transforms[i];
+			if (!bone.has_identity_pivots()) {
+				local = bone.calculate_local_transform(bone.local_bind_scale, bone.local_bind_rotation, bone.local_bind_translation);
+			}
+			bone.bind_transform = bone.has_parent() ? bones_[bone.parent].bind_transform * local : local;
+			bind_transforms[i] = bone.bind_transform;
+		}
 
-			bone.bind_transform = bone.parent ? bone.parent->bind_transform * local : local;
-			bone.inverse_bind_transform = glm::inverse(bone.bind_transform);
+		auto inverse_bind_transforms = std::vector<glm::mat4>(bone_count);
+		simd::inverse_affine(bind_transforms.data(), bone_count, inverse_bind_transforms.data());
+		for (auto const i : util::indices(pose.bones)) {
+			bones_[i].inverse_bind_transform = inverse_bind_transforms[i];
 		}
+		update_static_bones();
 	}
 
-	Bone const* bone_by_name(char const* const name) const
+	// Returns bone_count() if there is no bone with the name.
+	Bone::Id bone_id_by_name(animation_retargeting::NameId const name) const
 	{
-		auto const pos = bone_iterator_by_name_(name);
-		if (pos != bones_->end()) {
-			return &*pos;
-		}
-		return nullptr;
+		auto const id = bone_ids_by_name_.find(name);
+		return static_cast<Bone::Id>(id == animation_retargeting::NameIndex::not_found ? bones_.size() : id);
 	}
-	Bone* bone_by_name(char const* const name)
-	{
-		auto pos = bone_iterator_by_name_(name);
-		if (pos != bones_->end()) {
-			return &*pos;
-		}
-		return nullptr;
+	// Names that were never interned can't be a bone's, so they aren't added to the interned names.
+	Bone::Id bone_id_by_name(char const* const name) const {
+		return bone_id_by_name(animation_retargeting::find_name(name));
 	}
 
-	Bone::Id bone_id_by_name(char const* const name) const {
-		return static_cast<Bone::Id>(bone_iterator_by_name_(name) - bones_->begin());
+	Bone const* bone_by_name(animation_retargeting::NameId const name) const
+	{
+		auto const id = bone_id_by_name(name);
+		return id < bones_.size() ? &bones_[id] : nullptr;
+	}
+	Bone* bone_by_name(animation_retargeting::NameId const name)
+	{
+		auto const id = bone_id_by_name(name);
+		return id < bones_.size() ? &bones_[id] : nullptr;
+	}
+	Bone const* bone_by_name(char const* const name) const {
+		return bone_by_name(animation_retargeting::find_name(name));
+	}
+	Bone* bone_by_name(char const* const name) {
+		return bone_by_name(animation_retargeting::find_name(name));
 	}
 
 	Bone const* bone_by_id(Bone::Id const id) const {
-		return &(*bones_)[id];
+		assert(id < bones_.size());
+		return &bones_[id];
 	}
 	Bone* bone_by_id(Bone::Id const id) {
-		return &(*bones_)[id];
+		assert(id < bones_.size());
+		return &bones_[id];
 	}
 
 	std::size_t bone_count() const {
-		return bones_->size();
+		return bones_.size();
+	}
+
+	// The memory used by the bones and the tables indexed by bone, without the names and tracks that bones own.
+	std::size_t byte_size() const {
+		return bones_.capacity()*sizeof(Bone) + static_local_transforms_.capacity()*sizeof(glm::mat4) + bone_ids_by_name_.byte_size();
+	}
+
+	// The end of the latest track. Constant tracks have at most one key, so a single bone's tracks may end early.
+	Seconds animation_duration() const
+	{
+		auto duration = Seconds{};
+		for (auto const& bone : bones_) {
+			duration = std::max({duration, bone.scale_track.duration(), bone.rotation_track.duration(), bone.translation_track.duration()});
+		}
+		return duration;
+	}
+
+	// The bones whose local transforms can change over time. Bones count as animated until update_static_bones has found otherwise.
+	BoneMask animated_bones() const
+	{
+		auto mask = BoneMask{};
+		for (auto const i : util::indices(bones_.size())) {
+			mask.set(i, !static_bones_.test(i));
+		}
+		return mask;
+	}
+	bool is_static(Bone::Id const id) const {
+		return static_bones_.test(id);
+	}
+	glm::mat4 const& static_local_transform(Bone::Id const id) const {
+		return static_local_transforms_[id];
 	}
 
 	auto const& bones() const {
-		return *bones_;
+		return bones_;
 	}
 	auto& bones() {
-		return *bones_;
+		return bones_;
 	}
 };
 
@@ -407,8 +1048,8 @@ private:
 		
 		for (auto const& bone : skeleton.bones()) 
 		{
-			if (bone.parent) {
-				indices_.push_back(bone.parent->id);
+			if (bone.has_parent()) {
+				indices_.push_back(bone.parent);
 				indices_.push_back(bone.id);
 			}
 
@@ -0,0 +1,149 @@
+#ifndef ANIMATION_RETARGETING_TESTING_SKELETON_LOD_HPP
+#define ANIMATION_RETARGETING_TESTING_SKELETON_LOD_HPP
+
+#include "model.hpp"
+#include "skeleton.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace testing {
+
+/*
+	A reduced skeleton for distant characters. Some bones are collapsed into their parents. The skin they moved
+	follows the parent rigidly, and their tracks are never sampled. A bone is only collapsed after all of its children,
+	so the kept bones always include their parents and can be evaluated on their own.
+*/
+struct SkeletonLod {
+	// The full skeleton's ids of the kept bones, parents first. A bone's index in this array is its id in the LOD.
+	std::vector<Bone::Id> kept_bone_ids;
+	// For each bone of the full skeleton, the LOD id of the kept bone it was collapsed into, or of itself if it was kept.
+	std::vector<Bone::Id> lod_bone_ids;
+
+	std::size_t bone_count() const {
+		return kept_bone_ids.size();
+	}
+
+	// Moves the vertices' weights onto the kept bones and changes their bone ids to LOD ids.
+	void remap_vertices(util::Span<Vertex> const vertices) const
+	{
+		for (auto& vertex : vertices)
+		{
+			auto remapped = Vertex{};
+			for (auto const i : util::indices(Vertex::max_bone_influence))
+			{
+				if (vertex.bone_weights[i] == 0.f) {
+					continue;
+				}
+				auto const id = lod_bone_ids[vertex.bone_ids[i]];
+				// Weights of bones that were collapsed into the same bone are added together.
+				for (auto const j : util::indices(Vertex::max_bone_influence)) {
+					if (remapped.bone_weights[j] == 0.f || remapped.bone_ids[j] == id) {
+						remapped.bone_ids[j] = id;
+						remapped.bone_weights[j] += vertex.bone_weights[i];
+						break;
+					}
+				}
+			}
+			vertex.bone_ids = remapped.bone_ids;
+			vertex.bone_weights = remapped.bone_weights;
+		}
+	}
+};
+
+// Fingers, toes, faces and twist bones add little at a distance, so they are collapsed before other bones with as much skin.
+inline bool is_detail_bone(std::string name)
+{
+	std::transform(name.begin(), name.end(), name.begin(), [](unsigned char const character) { return static_cast<char>(std::tolower(character)); });
+
+	constexpr char const* detail_words[] = {
+		"finger", "thumb", "index", "middle", "ring", "pinky", "toe",
+		"eye", "jaw", "face", "brow", "lip", "cheek", "tongue", "twist", "roll",
+	};
+	return std::any_of(std::begin(detail_words), std::end(detail_words), [&](char const* const word) { return name.find(word) != std::string::npos; });
+}
+
+// The sum of each bone's skin weights over all vertices, indexed by bone id.
+inline std::vector<float> calculate_bone_influences(Skeleton const& skeleton, util::Span<MeshData const> const meshes)
+{
+	auto influences = std::vector<float>(skeleton.bone_count());
+	for (auto const& mesh : meshes) {
+		for (auto const& vertex : mesh.vertices) {
+			for (auto const i : util::indices(Vertex::max_bone_influence)) {
+				influences[vertex.bone_ids[i]] += vertex.bone_weights[i];
+			}
+		}
+	}
+	return influences;
+}
+
+/*
+	Collapses bones until at most max_bone_count are left, or only the roots. The bone with the least skin influence
+	in its subtree goes first, out of the bones whose children have all been collapsed.
+*/
+inline SkeletonLod create_skeleton_lod(Skeleton const& skeleton, util::Span<float const> const influences, std::size_t const max_bone_count)
+{
+	constexpr auto detail_bone_cost_factor = 0.1f;
+
+	auto const bone_count = skeleton.bone_count();
+	auto const& bones = skeleton.bones();
+
+	auto child_counts = std::vector<std::size_t>(bone_count);
+	for (auto const& bone : bones) {
+		if (bone.has_parent()) {
+			++child_counts[bone.parent];
+		}
+	}
+	auto subtree_influences = std::vector<float>(influences.begin(), influences.end());
+	auto is_kept = std::vector<bool>(bone_count, true);
+
+	using Candidate = std::pair<float, Bone::Id>;
+	auto candidates = std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>>{};
+	auto const add_candidate = [&](Bone const& bone) {
+		// Roots are never collapsed.
+		if (bone.has_parent() && !child_counts[bone.id]) {
+			candidates.emplace(subtree_influences[bone.id]*(is_detail_bone(bone.name) ? detail_bone_cost_factor : 1.f), bone.id);
+		}
+	};
+	for (auto const& bone : bones) {
+		add_candidate(bone);
+	}
+
+	auto kept_count = bone_count;
+	while (kept_count > max_bone_count && !candidates.empty())
+	{
+		auto const& bone = bones[candidates.top().second];
+		candidates.pop();
+
+		is_kept[bone.id] = false;
+		--kept_count;
+
+		subtree_influences[bone.parent] += subtree_influences[bone.id];
+		--child_counts[bone.parent];
+		add_candidate(bones[bone.parent]);
+	}
+
+	auto lod = SkeletonLod{};
+	lod.lod_bone_ids.resize(bone_count);
+	for (auto const& bone : bones)
+	{
+		if (is_kept[bone.id]) {
+			lod.lod_bone_ids[bone.id] = static_cast<Bone::Id>(lod.kept_bone_ids.size());
+			lod.kept_bone_ids.push_back(bone.id);
+		}
+		else {
+			// Parents come first, so the parent has already been mapped to a kept bone.
+			lod.lod_bone_ids[bone.id] = lod.lod_bone_ids[bone.parent];
+		}
+	}
+	return lod;
+}
+
+} // namespace testing
+
+#endif
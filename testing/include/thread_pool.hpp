@@ -0,0 +1,123 @@
+#ifndef ANIMATION_RETARGETING_TESTING_THREAD_POOL_HPP
+#define ANIMATION_RETARGETING_TESTING_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace testing {
+
+/*
+	Worker threads that stay alive between parallel loops, for work that runs every frame where starting threads
+	would cost more than the work itself. The calling thread takes part in every loop.
+*/
+class ThreadPool {
+private:
+	std::vector<std::thread> threads_;
+
+	std::mutex mutex_;
+	std::condition_variable work_available_;
+	std::condition_variable work_done_;
+
+	// The current loop. The function is type-erased without allocating since it only lives for the duration of parallel_for.
+	void const* function_{};
+	void (*invoke_)(void const*, std::size_t){};
+	std::size_t count_{};
+	std::atomic<std::size_t> next_{};
+
+	std::size_t generation_{};
+	std::size_t active_worker_count_{};
+	bool is_stopping_{};
+
+	void run_loop_() {
+		for (auto i = next_++; i < count_; i = next_++) {
+			invoke_(function_, i);
+		}
+	}
+
+	void work_()
+	{
+		auto seen_generation = std::size_t{};
+		while (true)
+		{
+			{
+				auto lock = std::unique_lock{mutex_};
+				work_available_.wait(lock, [&] { return is_stopping_ || generation_ != seen_generation; });
+				if (is_stopping_) {
+					return;
+				}
+				seen_generation = generation_;
+			}
+
+			run_loop_();
+
+			auto const lock = std::lock_guard{mutex_};
+			if (--active_worker_count_ == 0) {
+				work_done_.notify_one();
+			}
+		}
+	}
+
+public:
+	// The thread count includes the calling thread, so a pool of one thread runs everything inline.
+	explicit ThreadPool(unsigned const thread_count = std::thread::hardware_concurrency())
+	{
+		for (auto i = 1u; i < std::max(thread_count, 1u); ++i) {
+			threads_.emplace_back([this] { work_(); });
+		}
+	}
+	~ThreadPool()
+	{
+		{
+			auto const lock = std::lock_guard{mutex_};
+			is_stopping_ = true;
+		}
+		work_available_.notify_all();
+		for (auto& thread : threads_) {
+			thread.join();
+		}
+	}
+
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool const& operator=(ThreadPool const&) = delete;
+
+	unsigned thread_count() const {
+		return static_cast<unsigned>(threads_.size()) + 1;
+	}
+
+	// Runs function(i) for i in [0, count) and returns when all calls have finished.
+	template<typename Function_>
+	void parallel_for(std::size_t const count, Function_ const& function)
+	{
+		if (threads_.empty() || count <= 1) {
+			for (auto i = std::size_t{}; i < count; ++i) {
+				function(i);
+			}
+			return;
+		}
+
+		{
+			auto const lock = std::lock_guard{mutex_};
+			function_ = &function;
+			invoke_ = [](void const* const function, std::size_t const i) { (*static_cast<Function_ const*>(function))(i); };
+			count_ = count;
+			next_ = 0;
+			active_worker_count_ = threads_.size();
+			++generation_;
+		}
+		work_available_.notify_all();
+
+		run_loop_();
+
+		auto lock = std::unique_lock{mutex_};
+		work_done_.wait(lock, [&] { return active_worker_count_ == 0; });
+	}
+};
+
+} // namespace testing
+
+#endif
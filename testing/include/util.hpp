@@ -1,12 +1,19 @@
 #ifndef ANIMATION_RETARGETING_TESTING_UTIL_HPP
 #define ANIMATION_RETARGETING_TESTING_UTIL_HPP
 
-#include <fbxsdk.h>
+// Defined for targets that link the FBX SDK, see cmake/FindFbxSdk.cmake. Without it, models and clips load from glTF and cooked files only.
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+#	include <fbxsdk.h>
+#endif
 #include <glm/ext.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include <array>
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 namespace testing {
@@ -29,6 +36,8 @@ glm::quat map(T const from_start, T const from_end, glm::quat const to_start, gl
 	return glm::slerp(to_start, to_end, (from - from_start)/(from_end - from_start));
 }
 
+#ifdef ANIMATION_RETARGETING_FBX_SDK
+
 inline glm::mat4 fbx_to_glm(FbxAMatrix const& m) {
 	return glm::make_mat4(static_cast<double const*>(m));
 }
@@ -39,15 +48,17 @@ inline glm::vec3 fbx_to_glm(FbxDouble4 const vector) {
 	return glm::vec3{vector.mData[0], vector.mData[1], vector.mData[2]};
 }
 
-inline glm::mat4 euler_angles_to_mat4_xyz(glm::vec3 const euler) {
-	return glm::eulerAngleXYZ(euler.x, euler.y, euler.z);
-}
-
 inline std::string trimmed_bone_name(FbxNode const* const bone_node) {
 	auto const name = bone_node->GetNameOnly();
 	return std::string{name.Mid(name.Find(':') + 1)};
 }
 
+#endif
+
+inline glm::mat4 euler_angles_to_mat4_xyz(glm::vec3 const euler) {
+	return glm::eulerAngleXYZ(euler.x, euler.y, euler.z);
+}
+
 inline bool string_ends_with(std::string const& string, std::string const& end) {
 	return string.size() >= end.size() && !string.compare(string.size() - end.size(), end.size(), end);
 }
@@ -64,61 +75,6 @@ inline bool is_end_bone(std::string const& bone_name) {
 //     }
 // }
 
-template<typename T, std::size_t capacity_>
-class StaticVector {
-private:
-	std::array<T, capacity_> array_;
-	std::size_t size_{};
-
-public:
-	static constexpr auto capacity = capacity_;
-
-	std::size_t size() const {
-		return size_;
-	}
-
-	void push_back(T&& element) {
-		assert(size_ < capacity_);        
-		array_[size_++] = std::move(element);
-	}
-	void pop_back() {
-		assert(size_);
-		--size_;
-	}
-
-	T const& operator[](std::size_t const index) const {
-		assert(index < size_);
-		return array_[index];
-	}
-	T& operator[](std::size_t const index) {
-		assert(index < size_);
-		return array_[index];
-	}
-
-	T const& back() const {
-		assert(size_);
-		return array_[size_ - 1];
-	}
-	T& back() {
-		assert(size_);
-		return array_[size_ - 1];
-	}
-
-	auto begin() const {
-		return array_.begin();
-	}
-	auto begin() {
-		return array_.begin();
-	}
-
-	auto end() const {
-		return array_.begin() + size_;
-	}
-	auto end() {
-		return array_.begin() + size_;
-	}
-};
-
 template<typename Index_>
 class Indices {
 private:
@@ -168,6 +124,57 @@ constexpr Indices<std::size_t> indices(Container_ const& container) {
 	return Indices<std::size_t>{container};
 }
 
+// A set of indices that grows to fit the largest one set. Indices past the end are not in the set.
+class BitSet {
+private:
+	using Word_ = std::uint64_t;
+	static constexpr auto word_bits_ = std::size_t{64};
+
+	std::vector<Word_> words_;
+
+public:
+	bool test(std::size_t const index) const {
+		return index/word_bits_ < words_.size() && (words_[index/word_bits_] >> index%word_bits_ & 1);
+	}
+
+	void set(std::size_t const index, bool const value = true)
+	{
+		if (index/word_bits_ >= words_.size()) {
+			if (!value) {
+				return;
+			}
+			words_.resize(index/word_bits_ + 1);
+		}
+		auto const bit = Word_{1} << index%word_bits_;
+		words_[index/word_bits_] = value ? words_[index/word_bits_] | bit : words_[index/word_bits_] & ~bit;
+	}
+
+	// Keeps the memory, so that sets can be refilled without allocating.
+	void reset() {
+		std::fill(words_.begin(), words_.end(), Word_{});
+	}
+
+	std::size_t count() const
+	{
+		auto count = std::size_t{};
+		for (auto const word : words_) {
+			count += std::bitset<word_bits_>{word}.count();
+		}
+		return count;
+	}
+
+	BitSet& operator|=(BitSet const& other)
+	{
+		if (other.words_.size() > words_.size()) {
+			words_.resize(other.words_.size());
+		}
+		for (auto const i : util::indices(other.words_.size())) {
+			words_[i] |= other.words_[i];
+		}
+		return *this;
+	}
+};
+
 } // namespace util
 
 } // namespace testing
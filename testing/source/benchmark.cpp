@@ -0,0 +1,1418 @@
+// Headless benchmarks of the import and playback code. Usage: benchmark <name> [arguments...]
+
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "animation.hpp"
+#include "baked_palette.hpp"
+#include "bvh.hpp"
+#include "clip.hpp"
+#include "compressed_clip.hpp"
+#include "crowd.hpp"
+#include "model.hpp"
+#include "pose_cache.hpp"
+#include "simd.hpp"
+#include "skeleton_lod.hpp"
+#include "thread_pool.hpp"
+
+#include <fmt/format.h>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtx/norm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+testing::Model import_model(char const* const path, std::vector<testing::MeshData>& meshes) {
+	return testing::gltf::is_gltf_path(path) ? testing::Model::import_gltf(path, meshes) : testing::Model::import_fbx(path, meshes);
+}
+
+float rotation_difference_degrees(glm::quat const a, glm::quat const b) {
+	return glm::degrees(2.f*std::acos(std::min(1.f, std::abs(glm::dot(a, b)))));
+}
+
+// Compares building tracks by evaluating properties with the SDK against reading the raw curve keys.
+int benchmark_curve_import(std::vector<std::string> const& arguments)
+{
+	if (arguments.empty()) {
+		fmt::print("Usage: benchmark curve-import <fbx path> [repetitions]\n");
+		return 1;
+	}
+	auto const repetitions = arguments.size() > 1 ? std::stoi(arguments[1]) : 10;
+
+	auto evaluating_time = Clock::duration{};
+	auto raw_time = Clock::duration{};
+	auto key_count = std::size_t{};
+	auto max_translation_difference = 0.f;
+	auto max_rotation_difference = 0.f;
+
+	// Both variants read unconverted keys from a scene converted by the SDK, so they are directly comparable.
+	testing::Animation::for_each_animated_bone(arguments[0].c_str(), [&](std::string const&, FbxNode* const node, FbxAnimLayer* const layer, testing::fbx::CoordinateConversion const&) 
+	{
+		auto evaluating_translations = testing::AnimationTrack<glm::vec3>{};
+		auto evaluating_rotations = testing::AnimationTrack<glm::quat>{};
+
+		auto start_time = Clock::now();
+		for (auto i = 0; i < repetitions; ++i) {
+			evaluating_translations = testing::AnimationTrack<glm::vec3>{layer, node->LclTranslation};
+			evaluating_rotations = testing::AnimationTrack<glm::quat>{layer, node->LclRotation};
+		}
+		evaluating_time += Clock::now() - start_time;
+
+		auto raw_translations = testing::AnimationTrack<glm::vec3>{};
+		auto raw_rotations = testing::AnimationTrack<glm::quat>{};
+
+		start_time = Clock::now();
+		for (auto i = 0; i < repetitions; ++i) {
+			raw_translations = testing::AnimationTrack<glm::vec3>{testing::fbx::read_property_keys(layer, node->LclTranslation)};
+			raw_rotations = testing::AnimationTrack<glm::quat>{testing::fbx::read_property_keys(layer, node->LclRotation)};
+		}
+		raw_time += Clock::now() - start_time;
+
+		auto const translations = raw_translations.extract_values();
+		for (auto const& keyframe_time : raw_translations.extract_times()) {
+			auto const time = testing::Seconds{keyframe_time};
+			max_translation_difference = std::max(max_translation_difference, 
+				glm::length(evaluating_translations.evaluate(time) - raw_translations.evaluate(time)));
+		}
+		for (auto const& keyframe_time : raw_rotations.extract_times()) {
+			auto const time = testing::Seconds{keyframe_time};
+			max_rotation_difference = std::max(max_rotation_difference, 
+				rotation_difference_degrees(evaluating_rotations.evaluate(time), raw_rotations.evaluate(time)));
+		}
+		key_count += translations.size() + raw_rotations.extract_times().size();
+	}, testing::fbx::SceneConversion::sdk);
+
+	auto const evaluating_milliseconds = Milliseconds{evaluating_time}.count()/repetitions;
+	auto const raw_milliseconds = Milliseconds{raw_time}.count()/repetitions;
+
+	fmt::print("{} translation and rotation keys.\n", key_count);
+	fmt::print("Evaluating the properties: {:.3f} ms per import.\n", evaluating_milliseconds);
+	fmt::print("Reading raw curve keys: {:.3f} ms per import ({:.1f}x faster).\n", raw_milliseconds, evaluating_milliseconds/raw_milliseconds);
+	fmt::print("Max difference: {} units in translation, {} degrees in rotation.\n", max_translation_difference, max_rotation_difference);
+	return 0;
+}
+
+// Compares converting whole scenes with the SDK against converting only the extracted arrays.
+int benchmark_scene_conversion(std::vector<std::string> const& arguments)
+{
+	if (arguments.empty()) {
+		fmt::print("Usage: benchmark scene-conversion <fbx path> [repetitions]\n");
+		return 1;
+	}
+	auto const repetitions = arguments.size() > 1 ? std::stoi(arguments[1]) : 10;
+
+	struct Result {
+		Clock::duration model_time;
+		Clock::duration animation_time;
+		std::vector<testing::MeshData> meshes;
+		std::vector<glm::vec3> translations;
+	};
+
+	auto const run = [&](testing::fbx::SceneConversion const scene_conversion)
+	{
+		auto result = Result{};
+		for (auto i = 0; i < repetitions; ++i) 
+		{
+			result.meshes.clear();
+			auto start_time = Clock::now();
+			testing::Model::import_fbx(arguments[0].c_str(), result.meshes, scene_conversion);
+			result.model_time += Clock::now() - start_time;
+
+			result.translations.clear();
+			start_time = Clock::now();
+			testing::Animation::for_each_animated_bone(arguments[0].c_str(), 
+				[&](std::string const&, FbxNode* const node, FbxAnimLayer* const layer, testing::fbx::CoordinateConversion const& conversion) {
+					auto const values = testing::Animation::read_translation_track(node, layer, conversion).extract_values();
+					result.translations.insert(result.translations.end(), values.begin(), values.end());
+				}, scene_conversion);
+			result.animation_time += Clock::now() - start_time;
+		}
+		return result;
+	};
+
+	auto const sdk = run(testing::fbx::SceneConversion::sdk);
+	auto const bulk = run(testing::fbx::SceneConversion::bulk);
+
+	auto const print_times = [&](char const* const name, Clock::duration const sdk_time, Clock::duration const bulk_time) {
+		auto const sdk_milliseconds = Milliseconds{sdk_time}.count()/repetitions;
+		auto const bulk_milliseconds = Milliseconds{bulk_time}.count()/repetitions;
+		fmt::print("{} import: {:.3f} ms with the SDK, {:.3f} ms with bulk conversion ({:.1f}x faster).\n", 
+			name, sdk_milliseconds, bulk_milliseconds, sdk_milliseconds/bulk_milliseconds);
+	};
+	print_times("Model", sdk.model_time, bulk.model_time);
+	print_times("Animation", sdk.animation_time, bulk.animation_time);
+
+	auto max_position_difference = 0.f;
+	auto index_count = std::array<std::size_t, 2>{};
+	for (auto const i : testing::util::indices(std::min(sdk.meshes.size(), bulk.meshes.size()))) 
+	{
+		auto const& sdk_vertices = sdk.meshes[i].vertices;
+		auto const& bulk_vertices = bulk.meshes[i].vertices;
+		for (auto const j : testing::util::indices(std::min(sdk_vertices.size(), bulk_vertices.size()))) {
+			max_position_difference = std::max(max_position_difference, glm::length(sdk_vertices[j].position - bulk_vertices[j].position));
+		}
+		index_count[0] += sdk.meshes[i].indices.size();
+		index_count[1] += bulk.meshes[i].indices.size();
+	}
+
+	auto max_translation_difference = 0.f;
+	for (auto const i : testing::util::indices(std::min(sdk.translations.size(), bulk.translations.size()))) {
+		max_translation_difference = std::max(max_translation_difference, glm::length(sdk.translations[i] - bulk.translations[i]));
+	}
+
+	fmt::print("{} and {} indices, {} and {} translation keys.\n", index_count[0], index_count[1], sdk.translations.size(), bulk.translations.size());
+	fmt::print("Max difference: {} units in vertex positions, {} units in translation keys.\n", max_position_difference, max_translation_difference);
+	return 0;
+}
+
+// Compares importing the same model and clip from FBX and from glTF.
+int benchmark_gltf_import(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark gltf-import <fbx path> <gltf or glb path> [repetitions]\n");
+		return 1;
+	}
+	auto const repetitions = arguments.size() > 2 ? std::stoi(arguments[2]) : 10;
+
+	struct Result {
+		Clock::duration model_time;
+		Clock::duration animation_time;
+		std::size_t bone_count;
+		std::size_t vertex_count;
+		std::size_t key_count;
+	};
+
+	auto const run = [&](auto const& import_model, auto const& import_animation)
+	{
+		auto result = Result{};
+		for (auto i = 0; i < repetitions; ++i) 
+		{
+			auto meshes = std::vector<testing::MeshData>{};
+			auto start_time = Clock::now();
+			auto const model = import_model(meshes);
+			result.model_time += Clock::now() - start_time;
+
+			result.bone_count = model.skeleton().bone_count();
+			result.vertex_count = 0;
+			for (auto const& mesh : meshes) {
+				result.vertex_count += mesh.vertices.size();
+			}
+
+			start_time = Clock::now();
+			result.key_count = import_animation();
+			result.animation_time += Clock::now() - start_time;
+		}
+		return result;
+	};
+
+	auto const fbx = run(
+		[&](std::vector<testing::MeshData>& meshes) { return testing::Model::import_fbx(arguments[0].c_str(), meshes); },
+		[&] {
+			auto key_count = std::size_t{};
+			testing::Animation::for_each_animated_bone(arguments[0].c_str(), 
+				[&](std::string const&, FbxNode* const node, FbxAnimLayer* const layer, testing::fbx::CoordinateConversion const& conversion) {
+					key_count += testing::Animation::read_scale_track(node, layer, conversion).extract_times().size();
+					key_count += testing::Animation::read_rotation_track(node, layer, conversion).extract_times().size();
+					key_count += testing::Animation::read_translation_track(node, layer, conversion).extract_times().size();
+				});
+			return key_count;
+		});
+	auto const gltf = run(
+		[&](std::vector<testing::MeshData>& meshes) { return testing::Model::import_gltf(arguments[1].c_str(), meshes); },
+		[&] {
+			auto key_count = std::size_t{};
+			testing::Animation::for_each_gltf_track(arguments[1].c_str(), [&](std::string const&, testing::cooked::Channel, auto const& track) {
+				key_count += track.extract_times().size();
+			});
+			return key_count;
+		});
+
+	auto const print_result = [&](char const* const name, Result const& result) {
+		fmt::print("{}: {} bones, {} vertices, {} keys. Model {:.3f} ms, animation {:.3f} ms.\n", name, result.bone_count, result.vertex_count, result.key_count,
+			Milliseconds{result.model_time}.count()/repetitions, Milliseconds{result.animation_time}.count()/repetitions);
+	};
+	print_result("FBX", fbx);
+	print_result("glTF", gltf);
+
+	fmt::print("glTF is {:.1f}x faster for models and {:.1f}x faster for animations.\n", 
+		Milliseconds{fbx.model_time}/Milliseconds{gltf.model_time}, Milliseconds{fbx.animation_time}/Milliseconds{gltf.animation_time});
+	return 0;
+}
+
+// Measures BVH parse throughput, optionally retargeting the take to a model in chunks while it's parsed.
+int benchmark_bvh_import(std::vector<std::string> const& arguments)
+{
+	if (arguments.empty()) {
+		fmt::print("Usage: benchmark bvh-import <bvh path> [chunk frame count] [target fbx or gltf path]\n");
+		return 1;
+	}
+	auto const chunk_frame_count = arguments.size() > 1 ? static_cast<std::size_t>(std::stoul(arguments[1])) : std::size_t{256};
+
+	auto start_time = Clock::now();
+	auto file = testing::bvh::File{arguments[0].c_str()};
+	auto const hierarchy_time = Clock::now() - start_time;
+
+	auto chunk = animation_retargeting::Animation{};
+	start_time = Clock::now();
+	while (file.read_frames(chunk_frame_count, chunk)) {}
+	auto const motion_time = Clock::now() - start_time;
+
+	auto const megabytes = static_cast<double>(file.byte_size())/(1024.*1024.);
+	auto const seconds = std::chrono::duration<double>{hierarchy_time + motion_time}.count();
+
+	fmt::print("{} bones, {} frames at {:.1f} fps, {:.1f} MB.\n", file.pose().bones.size(), file.frame_count(), 1.f/file.frame_time(), megabytes);
+	fmt::print("Hierarchy {:.3f} ms, motion {:.3f} ms: {:.1f} MB/s.\n", 
+		Milliseconds{hierarchy_time}.count(), Milliseconds{motion_time}.count(), megabytes/seconds);
+
+	if (arguments.size() > 2)
+	{
+		auto meshes = std::vector<testing::MeshData>{};
+		auto const model = import_model(arguments[2].c_str(), meshes);
+
+		file.rewind();
+		auto retargeted_key_count = std::size_t{};
+		start_time = Clock::now();
+		testing::bvh::retarget_in_chunks(file, model.skeleton().extract_pose(), chunk_frame_count, 
+			[&](animation_retargeting::Animation const& retargeted_chunk, std::size_t) {
+				for (auto const& bone : retargeted_chunk.bones) {
+					retargeted_key_count += bone.rotations.size() + bone.translations.size();
+				}
+			});
+		auto const retarget_seconds = std::chrono::duration<double>{Clock::now() - start_time}.count();
+
+		fmt::print("Parsed and retargeted {} frames ({} keys) to {} bones in chunks of {}: {:.1f} MB/s.\n", 
+			file.frames_read(), retargeted_key_count, model.skeleton().bone_count(), chunk_frame_count, megabytes/retarget_seconds);
+	}
+	return 0;
+}
+
+// Compares playing a clip retargeted ahead of time (a copy per target) with retargeting it live while sampling the source clip.
+int benchmark_live_retarget(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 3) {
+		fmt::print("Usage: benchmark live-retarget <source model> <clip> <target model> [sample count]\n");
+		return 1;
+	}
+	auto const sample_count = arguments.size() > 3 ? std::stoi(arguments[3]) : 10000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto source = import_model(arguments[0].c_str(), meshes);
+	auto const source_animation = testing::Animation{arguments[1].c_str(), source.skeleton()};
+
+	auto baked_target = import_model(arguments[2].c_str(), meshes);
+	auto baked_animation = testing::Animation{arguments[1].c_str(), baked_target.skeleton()};
+
+	auto const bake_start_time = Clock::now();
+	auto const result = animation_retargeting::retarget(source.skeleton().extract_animation(), source.skeleton().extract_pose(), baked_target.skeleton().extract_pose(), 
+		animation_retargeting::ConstantChannels::collapse);
+	baked_target.skeleton().set_animation_values(result.animation);
+	baked_target.skeleton().set_bind_pose(result.bind_pose);
+	auto const bake_time = Clock::now() - bake_start_time;
+
+	auto live_target = import_model(arguments[2].c_str(), meshes);
+	auto live_animation = testing::Animation{nullptr, live_target.skeleton()};
+	live_animation.retarget_from(source.skeleton());
+
+	auto const keyframe_bytes = [](testing::Skeleton const& skeleton) {
+		auto bytes = std::size_t{};
+		for (auto const& bone : skeleton.bones()) {
+			bytes += bone.scale_track.key_count()*sizeof(testing::Keyframe<glm::vec3>);
+			bytes += bone.rotation_track.key_count()*sizeof(testing::Keyframe<glm::quat>);
+			bytes += bone.translation_track.key_count()*sizeof(testing::Keyframe<glm::vec3>);
+		}
+		return bytes;
+	};
+
+	auto const duration = source_animation.duration();
+	auto const sample = [&](testing::Animation& animation) {
+		auto const start_time = Clock::now();
+		for (auto i = 0; i < sample_count; ++i) {
+			animation.update_bone_matrices(duration*(static_cast<float>(i)/static_cast<float>(sample_count)));
+		}
+		return Clock::now() - start_time;
+	};
+	auto const baked_time = sample(baked_animation);
+	auto const live_time = sample(live_animation);
+
+	auto max_difference = 0.f;
+	for (auto const i : testing::util::indices(live_target.skeleton().bone_count())) {
+		auto const difference = baked_target.skeleton().bones()[i].global_transform[3] - live_target.skeleton().bones()[i].global_transform[3];
+		max_difference = std::max(max_difference, glm::length(glm::vec3{difference}));
+	}
+
+	auto const microseconds_per_sample = [&](Clock::duration const time) {
+		return std::chrono::duration<double, std::micro>{time}.count()/sample_count;
+	};
+	fmt::print("Baked: retargeting took {:.3f} ms, {} bytes of keyframes per target, {:.3f} us per pose.\n", 
+		Milliseconds{bake_time}.count(), keyframe_bytes(baked_target.skeleton()), microseconds_per_sample(baked_time));
+	fmt::print("Live: {} bytes of keyframes per target, {} bytes of corrections, {:.3f} us per pose.\n", 
+		keyframe_bytes(live_target.skeleton()), live_target.skeleton().bone_count()*sizeof(animation_retargeting::RetargetBone), microseconds_per_sample(live_time));
+	fmt::print("Max difference in final bone positions: {} units.\n", max_difference);
+	return 0;
+}
+
+// Plays one clip on many instances with different time offsets and playback rates, like a crowd.
+int benchmark_crowd(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark crowd <model> <clip> [instance count] [thread count] [frame count]\n");
+		return 1;
+	}
+	auto const instance_count = arguments.size() > 2 ? std::stoi(arguments[2]) : 5000;
+	auto const thread_count = arguments.size() > 3 ? static_cast<unsigned>(std::stoi(arguments[3])) : std::thread::hardware_concurrency();
+	auto const frame_count = arguments.size() > 4 ? std::stoi(arguments[4]) : 100;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto animation = testing::Animation{arguments[1].c_str(), model.skeleton()};
+
+	auto crowd = testing::Crowd{model.skeleton()};
+	for (auto i = 0; i < instance_count; ++i) {
+		// Spread the instances over the clip, with rates between 0.8 and 1.2.
+		auto const fraction = static_cast<float>(i)/static_cast<float>(instance_count);
+		crowd.add_instance(crowd.duration()*fraction, 0.8f + 0.4f*static_cast<float>((i*7919) % 101)/100.f);
+	}
+
+	auto thread_pool = testing::ThreadPool{thread_count};
+
+	auto const start_time = Clock::now();
+	for (auto frame = 0; frame < frame_count; ++frame) {
+		crowd.update(testing::Seconds{static_cast<float>(frame)/60.f}, thread_pool);
+	}
+	auto const crowd_time = Milliseconds{Clock::now() - start_time}.count();
+
+	// Every instance uses the same skeleton, so the crowd can be checked against the skeleton sampled one instance at a time.
+	auto max_difference = 0.f;
+	for (auto const instance : testing::util::indices(crowd.instance_count()))
+	{
+		animation.update_bone_matrices(crowd.local_time(instance));
+		auto const palette = crowd.palette(instance);
+		for (auto const& bone : model.skeleton().bones()) {
+			auto const difference = bone.animation_transform[3] - palette[bone.id][3];
+			max_difference = std::max(max_difference, glm::length(glm::vec3{difference}));
+		}
+	}
+
+	auto const single_start_time = Clock::now();
+	for (auto frame = 0; frame < frame_count; ++frame) {
+		for (auto const instance : testing::util::indices(crowd.instance_count())) {
+			animation.update_bone_matrices(crowd.local_time(instance));
+		}
+	}
+	auto const single_time = Milliseconds{Clock::now() - single_start_time}.count();
+
+	auto const instance_updates = static_cast<double>(instance_count)*frame_count;
+	fmt::print("{} instances of {} bones on {} threads, {} frames.\n", instance_count, crowd.bone_count(), thread_pool.thread_count(), frame_count);
+	fmt::print("Crowd: {:.3f} ms per frame, {:.0f} instances per ms.\n", crowd_time/frame_count, instance_updates/crowd_time);
+	fmt::print("One at a time: {:.3f} ms per frame, {:.0f} instances per ms.\n", single_time/frame_count, instance_updates/single_time);
+	fmt::print("Max difference in bone matrix translations: {} units.\n", max_difference);
+	return 0;
+}
+
+// Compares sampling a clip every frame with blending palettes baked ahead of time at full and half precision.
+int benchmark_baked_palette(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark baked-palette <model> <clip> [frames per second] [sample count]\n");
+		return 1;
+	}
+	auto const frames_per_second = arguments.size() > 2 ? std::stof(arguments[2]) : 30.f;
+	auto const sample_count = arguments.size() > 3 ? std::stoi(arguments[3]) : 10000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto animation = testing::Animation{arguments[1].c_str(), model.skeleton()};
+	auto const duration = animation.duration();
+
+	auto const bake_start_time = Clock::now();
+	auto const full = testing::BakedPalette{animation, frames_per_second};
+	auto const bake_time = Clock::now() - bake_start_time;
+	auto const half = testing::BakedPalette{animation, frames_per_second, testing::PalettePrecision::half};
+
+	// Sample times that fall between baked frames.
+	auto const sample_time = [&](int const i) {
+		return duration*(static_cast<float>(i)/static_cast<float>(sample_count));
+	};
+
+	auto palette = std::vector<glm::mat4>(model.skeleton().bone_count());
+	auto const palette_span = testing::util::Span<glm::mat4>{palette.data(), palette.size()};
+
+	auto const time_samples = [&](auto const& sample) {
+		auto const start_time = Clock::now();
+		for (auto i = 0; i < sample_count; ++i) {
+			sample(sample_time(i));
+		}
+		return std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/sample_count;
+	};
+	auto const sampled_time = time_samples([&](testing::Seconds const time) { animation.update_bone_matrices(time); });
+	auto const full_time = time_samples([&](testing::Seconds const time) { full.sample(time, palette_span); });
+	auto const half_time = time_samples([&](testing::Seconds const time) { half.sample(time, palette_span); });
+	auto const nearest_time = time_samples([&](testing::Seconds const time) { full.sample_nearest(time, palette_span); });
+
+	auto const max_difference = [&](testing::BakedPalette const& baked) {
+		auto difference = 0.f;
+		for (auto i = 0; i < sample_count; i += std::max(1, sample_count/500)) {
+			animation.update_bone_matrices(sample_time(i));
+			baked.sample(sample_time(i), palette_span);
+			for (auto const& bone : model.skeleton().bones()) {
+				difference = std::max(difference, glm::length(glm::vec3{bone.animation_transform[3] - palette[bone.id][3]}));
+			}
+		}
+		return difference;
+	};
+
+	fmt::print("{} bones, {} frames at {} frames per second, baked in {:.3f} ms.\n", 
+		model.skeleton().bone_count(), full.frame_count(), frames_per_second, Milliseconds{bake_time}.count());
+	fmt::print("Sampled: {:.3f} us per instance.\n", sampled_time);
+	fmt::print("Baked: {} bytes per clip, {:.3f} us per instance blended, {:.3f} us nearest frame, max difference {} units.\n", 
+		full.byte_size(), full_time, nearest_time, max_difference(full));
+	fmt::print("Baked half precision: {} bytes per clip, {:.3f} us per instance blended, max difference {} units.\n", 
+		half.byte_size(), half_time, max_difference(half));
+	return 0;
+}
+
+// Plays one clip on many instances that fall into a few groups in sync, evaluating each instance's pose or sharing them through a pose cache.
+int benchmark_pose_cache(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark pose-cache <model> <clip> [instance count] [phase count] [thread count] [frame count]\n");
+		return 1;
+	}
+	auto const instance_count = arguments.size() > 2 ? static_cast<std::size_t>(std::stoi(arguments[2])) : std::size_t{1000};
+	auto const phase_count = arguments.size() > 3 ? std::stoi(arguments[3]) : 8;
+	auto const thread_count = arguments.size() > 4 ? static_cast<unsigned>(std::stoi(arguments[4])) : std::thread::hardware_concurrency();
+	auto const frame_count = arguments.size() > 5 ? std::stoi(arguments[5]) : 100;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto const animation = testing::Animation{arguments[1].c_str(), model.skeleton()};
+	auto const duration = animation.duration();
+	auto const bone_count = model.skeleton().bone_count();
+
+	auto const instance_time = [&](std::size_t const instance, int const frame) {
+		auto const phase = static_cast<float>(static_cast<int>(instance) % phase_count)/static_cast<float>(phase_count);
+		return testing::Seconds{std::fmod(duration.count()*phase + static_cast<float>(frame)/60.f, duration.count())};
+	};
+
+	auto thread_pool = testing::ThreadPool{thread_count};
+
+	auto global_transforms = std::vector<glm::mat4>(instance_count*bone_count);
+	auto animation_transforms = std::vector<glm::mat4>(instance_count*bone_count);
+	auto const uncached_start_time = Clock::now();
+	for (auto frame = 0; frame < frame_count; ++frame) {
+		thread_pool.parallel_for(instance_count, [&](std::size_t const instance) {
+			animation.evaluate_bone_matrices(instance_time(instance, frame), 
+				{&global_transforms[instance*bone_count], bone_count}, {&animation_transforms[instance*bone_count], bone_count});
+		});
+	}
+	auto const uncached_time = Milliseconds{Clock::now() - uncached_start_time}.count();
+
+	auto cache = testing::PoseCache{};
+	auto palettes = std::vector<testing::util::Span<glm::mat4 const>>(instance_count);
+	auto const cached_start_time = Clock::now();
+	for (auto frame = 0; frame < frame_count; ++frame) {
+		cache.begin_frame();
+		thread_pool.parallel_for(instance_count, [&](std::size_t const instance) {
+			palettes[instance] = cache.animation_transforms(animation, instance_time(instance, frame));
+		});
+	}
+	auto const cached_time = Milliseconds{Clock::now() - cached_start_time}.count();
+
+	// The cache rounds times to its step, so compare with the last uncached frame.
+	auto max_difference = 0.f;
+	for (auto const instance : testing::util::indices(instance_count)) {
+		for (auto const bone : testing::util::indices(bone_count)) {
+			auto const difference = palettes[instance][bone][3] - animation_transforms[instance*bone_count + bone][3];
+			max_difference = std::max(max_difference, glm::length(glm::vec3{difference}));
+		}
+	}
+
+	fmt::print("{} instances in {} phases, {} bones, {} threads, {} frames.\n", instance_count, phase_count, bone_count, thread_pool.thread_count(), frame_count);
+	fmt::print("Evaluated per instance: {:.3f} ms per frame.\n", uncached_time/frame_count);
+	fmt::print("Pose cache: {:.3f} ms per frame, {:.1f}% hit rate.\n", cached_time/frame_count, cache.hit_rate()*100.f);
+	fmt::print("Max difference in bone matrix translations: {} units.\n", max_difference);
+	return 0;
+}
+
+// Generates reduced skeletons and compares their update cost, upload size and skinning error with the full skeleton.
+int benchmark_skeleton_lod(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark skeleton-lod <model> <clip> [sample count]\n");
+		return 1;
+	}
+	auto const sample_count = arguments.size() > 2 ? std::stoi(arguments[2]) : 10000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto const animation = testing::Animation{arguments[1].c_str(), model.skeleton()};
+	auto const duration = animation.duration();
+	auto const& skeleton = model.skeleton();
+
+	auto const influences = testing::calculate_bone_influences(skeleton, {meshes.data(), meshes.size()});
+
+	auto global_transforms = std::vector<glm::mat4>(skeleton.bone_count());
+	auto full_transforms = std::vector<glm::mat4>(skeleton.bone_count());
+	auto lod_transforms = std::vector<glm::mat4>(skeleton.bone_count());
+
+	auto const skin = [](testing::Vertex const& vertex, std::vector<glm::mat4> const& transforms) {
+		auto position = glm::vec4{};
+		for (auto const i : testing::util::indices(testing::Vertex::max_bone_influence)) {
+			position += transforms[vertex.bone_ids[i]]*glm::vec4{vertex.position, 1.f}*vertex.bone_weights[i];
+		}
+		return glm::vec3{position};
+	};
+
+	auto full_time = 0.;
+	for (auto const max_bone_count : {skeleton.bone_count(), skeleton.bone_count()/2, skeleton.bone_count()/4})
+	{
+		auto const lod = testing::create_skeleton_lod(skeleton, {influences.data(), influences.size()}, max_bone_count);
+		auto const bone_ids = testing::util::Span<testing::Bone::Id const>{lod.kept_bone_ids.data(), lod.kept_bone_ids.size()};
+
+		auto const start_time = Clock::now();
+		for (auto i = 0; i < sample_count; ++i) {
+			animation.evaluate_bone_matrices(duration*(static_cast<float>(i)/static_cast<float>(sample_count)), bone_ids,
+				{global_transforms.data(), global_transforms.size()}, {lod_transforms.data(), lod.bone_count()});
+		}
+		auto const time = std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/sample_count;
+		if (!full_time) {
+			full_time = time;
+		}
+
+		// Skin the remapped vertices with the LOD and the original vertices with the full skeleton.
+		auto remapped_meshes = meshes;
+		for (auto& mesh : remapped_meshes) {
+			lod.remap_vertices({mesh.vertices.data(), mesh.vertices.size()});
+		}
+		auto max_error = 0.f;
+		for (auto const sample : {0.25f, 0.5f, 0.75f})
+		{
+			auto const sample_time = duration*sample;
+			animation.evaluate_bone_matrices(sample_time, {global_transforms.data(), global_transforms.size()}, {full_transforms.data(), full_transforms.size()});
+			animation.evaluate_bone_matrices(sample_time, bone_ids, {global_transforms.data(), global_transforms.size()}, {lod_transforms.data(), lod.bone_count()});
+
+			for (auto const mesh : testing::util::indices(meshes)) {
+				for (auto const i : testing::util::indices(meshes[mesh].vertices)) {
+					auto const difference = skin(meshes[mesh].vertices[i], full_transforms) - skin(remapped_meshes[mesh].vertices[i], lod_transforms);
+					max_error = std::max(max_error, glm::length(difference));
+				}
+			}
+		}
+
+		fmt::print("{} bones: {:.3f} us per update ({:.0f}% of full), {} bytes uploaded per frame, max skinning error {} units.\n",
+			lod.bone_count(), time, time/full_time*100., lod.bone_count()*sizeof(glm::mat4), max_error);
+	}
+	return 0;
+}
+
+// Compares skinning with 1, 2 and 4 bone influences: vertex bytes, CPU skinning time as a stand-in for shader work, and error.
+int benchmark_skinning_variants(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark skinning-variants <model> <clip> [repetitions]\n");
+		return 1;
+	}
+	auto const repetitions = arguments.size() > 2 ? std::stoi(arguments[2]) : 20;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto const animation = testing::Animation{arguments[1].c_str(), model.skeleton()};
+
+	auto global_transforms = std::vector<glm::mat4>(model.skeleton().bone_count());
+	auto animation_transforms = std::vector<glm::mat4>(model.skeleton().bone_count());
+	animation.evaluate_bone_matrices(animation.duration()*0.5f, 
+		{global_transforms.data(), global_transforms.size()}, {animation_transforms.data(), animation_transforms.size()});
+
+	auto vertices = std::vector<testing::Vertex>{};
+	auto chosen_vertex_bytes = std::size_t{};
+	for (auto const i : testing::util::indices(meshes)) 
+	{
+		auto const& mesh_vertices = meshes[i].vertices;
+		auto const variant = testing::required_bone_influence_variant({mesh_vertices.data(), mesh_vertices.size()});
+		fmt::print("Mesh {}: {} vertices, skinned with {} influences.\n", i, mesh_vertices.size(), testing::bone_influence_variants[variant]);
+
+		chosen_vertex_bytes += mesh_vertices.size()*testing::skinned_vertex_size(testing::bone_influence_variants[variant]);
+		vertices.insert(vertices.end(), mesh_vertices.begin(), mesh_vertices.end());
+	}
+
+	auto const skin = [&](testing::Vertex const& vertex, std::size_t const influence_count) {
+		auto transform = animation_transforms[vertex.bone_ids[0]]*vertex.bone_weights[0];
+		for (auto i = std::size_t{1}; i < influence_count; ++i) {
+			transform = transform + animation_transforms[vertex.bone_ids[i]]*vertex.bone_weights[i];
+		}
+		return glm::vec3{transform*glm::vec4{vertex.position, 1.f}};
+	};
+
+	auto positions = std::vector<glm::vec3>(vertices.size());
+	auto reference_positions = std::vector<glm::vec3>{};
+	auto reference_time = 0.;
+
+	// The four influence variant goes first, as the reference.
+	for (auto const influence_count : {std::size_t{4}, std::size_t{2}, std::size_t{1}})
+	{
+		auto pruned_vertices = vertices;
+		for (auto& vertex : pruned_vertices) {
+			vertex.prune_bone_influences(influence_count);
+		}
+
+		auto const start_time = Clock::now();
+		for (auto repetition = 0; repetition < repetitions; ++repetition) {
+			for (auto const i : testing::util::indices(pruned_vertices)) {
+				positions[i] = skin(pruned_vertices[i], influence_count);
+			}
+		}
+		auto const time = Milliseconds{Clock::now() - start_time}.count()/repetitions;
+
+		if (reference_positions.empty()) {
+			reference_positions = positions;
+			reference_time = time;
+		}
+		auto max_error = 0.f;
+		for (auto const i : testing::util::indices(positions)) {
+			max_error = std::max(max_error, glm::length(positions[i] - reference_positions[i]));
+		}
+
+		fmt::print("{} influences: {} bytes per vertex ({} in total), skinning took {:.3f} ms ({:.0f}% of four), max error {} units.\n",
+			influence_count, testing::skinned_vertex_size(influence_count), vertices.size()*testing::skinned_vertex_size(influence_count), 
+			time, time/reference_time*100., max_error);
+	}
+	fmt::print("Unpacked vertices: {} bytes in total. Cheapest variant per mesh: {} bytes in total.\n", 
+		vertices.size()*sizeof(testing::Vertex), chosen_vertex_bytes);
+	return 0;
+}
+
+// Compares evaluating a few bones' global transforms through their ancestor chains against evaluating the whole skeleton.
+int benchmark_partial_pose(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 3) {
+		fmt::print("Usage: benchmark partial-pose <model> <clip> <bone name>...\n");
+		return 1;
+	}
+	constexpr auto sample_count = 10000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto const animation = testing::Animation{arguments[1].c_str(), model.skeleton()};
+	auto const duration = animation.duration();
+	auto const& skeleton = model.skeleton();
+
+	auto bone_ids = std::vector<testing::Bone::Id>{};
+	for (auto i = std::size_t{2}; i < arguments.size(); ++i)
+	{
+		if (!skeleton.bone_by_name(arguments[i].c_str())) {
+			throw std::runtime_error{fmt::format("The skeleton has no bone named {}.", arguments[i])};
+		}
+		bone_ids.push_back(skeleton.bone_id_by_name(arguments[i].c_str()));
+	}
+
+	auto full_globals = std::vector<glm::mat4>(skeleton.bone_count());
+	auto animation_transforms = std::vector<glm::mat4>(skeleton.bone_count());
+	auto partial_globals = std::vector<glm::mat4>(skeleton.bone_count());
+
+	auto const sample_time = [&](int const i) {
+		return duration*(static_cast<float>(i)/static_cast<float>(sample_count));
+	};
+
+	auto start_time = Clock::now();
+	for (auto i = 0; i < sample_count; ++i) {
+		animation.evaluate_bone_matrices(sample_time(i), {full_globals.data(), full_globals.size()}, {animation_transforms.data(), animation_transforms.size()});
+	}
+	auto const full_time = std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/sample_count;
+
+	auto chain_ids = std::vector<testing::Bone::Id>(skeleton.bone_count());
+	auto collected_bones = testing::util::BitSet{};
+	auto chain = testing::util::Span<testing::Bone::Id const>{};
+	start_time = Clock::now();
+	for (auto i = 0; i < sample_count; ++i) {
+		chain = animation.evaluate_global_transforms(sample_time(i), {bone_ids.data(), bone_ids.size()}, 
+			{chain_ids.data(), chain_ids.size()}, collected_bones, {partial_globals.data(), partial_globals.size()});
+	}
+	auto const partial_time = std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/sample_count;
+
+	// Both ended on the same sample, so the requested bones should match exactly.
+	auto max_difference = 0.f;
+	for (auto const id : bone_ids) {
+		max_difference = std::max(max_difference, glm::length(glm::vec3{full_globals[id][3] - partial_globals[id][3]}));
+	}
+
+	fmt::print("Full: {} bones, {:.3f} us per evaluation.\n", skeleton.bone_count(), full_time);
+	fmt::print("Partial: {} bones for {} requested, {:.3f} us per evaluation ({:.0f}% of full), max position difference {} units.\n",
+		chain.size(), bone_ids.size(), partial_time, partial_time/full_time*100., max_difference);
+	return 0;
+}
+
+// Compresses clips and reports the compression ratio, the largest vertex error and how fast poses decode compared to sampling the tracks.
+int benchmark_clip_compression(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark clip-compression <model> <clip>...\n");
+		return 1;
+	}
+	constexpr auto pose_count = 2000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto& skeleton = model.skeleton();
+
+	auto total_track_bytes = std::size_t{};
+	auto total_compressed_bytes = std::size_t{};
+
+	for (auto i = std::size_t{1}; i < arguments.size(); ++i)
+	{
+		skeleton.clear_animation();
+		auto const animation = testing::Animation{arguments[i].c_str(), skeleton};
+
+		auto track_bytes = std::size_t{};
+		for (auto const& bone : skeleton.bones()) {
+			track_bytes += bone.scale_track.key_count()*sizeof(testing::Keyframe<glm::vec3>) + 
+				bone.rotation_track.key_count()*sizeof(testing::Keyframe<glm::quat>) + 
+				bone.translation_track.key_count()*sizeof(testing::Keyframe<glm::vec3>);
+		}
+
+		auto start_time = Clock::now();
+		auto const clip = testing::CompressedClip{skeleton};
+		auto const compression_time = Milliseconds{Clock::now() - start_time}.count();
+
+		// At every sample and halfway between them.
+		auto max_error = 0.f;
+		for (auto sample = std::size_t{}; sample < clip.sample_count()*2 - 1; ++sample) {
+			max_error = std::max(max_error, clip.measure_error(skeleton, clip.duration()*(static_cast<float>(sample)/static_cast<float>(clip.sample_count()*2 - 2))));
+		}
+
+		auto const pose_time = [&](int const pose) {
+			return clip.duration()*(static_cast<float>(pose)/static_cast<float>(pose_count));
+		};
+		auto pose = std::vector<testing::LocalTransform>(skeleton.bone_count());
+
+		start_time = Clock::now();
+		for (auto j = 0; j < pose_count; ++j) {
+			clip.sample(pose_time(j), {pose.data(), pose.size()});
+		}
+		auto const decode_time = std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/pose_count;
+
+		start_time = Clock::now();
+		for (auto j = 0; j < pose_count; ++j) {
+			for (auto const& bone : skeleton.bones()) {
+				pose[bone.id] = testing::LocalTransform{
+					bone.scale_track.evaluate(pose_time(j), bone.local_bind_scale),
+					bone.rotation_track.evaluate(pose_time(j), bone.local_bind_rotation),
+					bone.translation_track.evaluate(pose_time(j), bone.local_bind_translation),
+				};
+			}
+		}
+		auto const track_time = std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/pose_count;
+
+		fmt::print("{}: {} -> {} bytes ({:.1f}:1), {} of {} tracks animated, compressed in {:.1f} ms. "
+			"Max error {} units (limit {}). {:.3f} us per pose, {:.3f} us sampling tracks, {:.1f} million bones per second.\n",
+			arguments[i], track_bytes, clip.byte_size(), static_cast<double>(track_bytes)/static_cast<double>(clip.byte_size()),
+			clip.animated_track_count(), skeleton.bone_count()*3, compression_time, max_error, clip.max_error(),
+			decode_time, track_time, static_cast<double>(skeleton.bone_count())/decode_time);
+
+		total_track_bytes += track_bytes;
+		total_compressed_bytes += clip.byte_size();
+	}
+
+	fmt::print("Total: {} -> {} bytes ({:.1f}:1).\n", total_track_bytes, total_compressed_bytes, 
+		static_cast<double>(total_track_bytes)/static_cast<double>(total_compressed_bytes));
+	return 0;
+}
+
+// Reduces a clip's keys with linear and cubic interpolation, and compares key counts, sampling time and error against the full clip.
+int benchmark_keyframe_reduction(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark keyframe-reduction <model> <clip> [tolerance]\n");
+		return 1;
+	}
+	auto const tolerance = arguments.size() > 2 ? std::stof(arguments[2]) : 0.01f;
+	constexpr auto sample_count = 2000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto& skeleton = model.skeleton();
+	auto const bone_count = skeleton.bone_count();
+
+	auto const count_keys = [&] {
+		auto count = std::size_t{};
+		for (auto const& bone : skeleton.bones()) {
+			count += bone.scale_track.key_count() + bone.rotation_track.key_count() + bone.translation_track.key_count();
+		}
+		return count;
+	};
+
+	auto original_globals = std::vector<glm::mat4>(sample_count*bone_count);
+	auto global_transforms = std::vector<glm::mat4>(bone_count);
+	auto animation_transforms = std::vector<glm::mat4>(bone_count);
+
+	struct Mode {
+		char const* name;
+		bool should_reduce;
+		testing::Interpolation interpolation;
+	};
+	for (auto const mode : {Mode{"Original", false, testing::Interpolation::linear}, Mode{"Linear", true, testing::Interpolation::linear}, Mode{"Cubic", true, testing::Interpolation::cubic}})
+	{
+		skeleton.clear_animation();
+		auto const animation = testing::Animation{arguments[1].c_str(), skeleton};
+		auto const duration = animation.duration();
+		auto const sample_time = [&](int const i) {
+			return duration*(static_cast<float>(i)/static_cast<float>(sample_count - 1));
+		};
+
+		auto const start_time = Clock::now();
+		if (mode.should_reduce) {
+			skeleton.reduce_keyframes(tolerance, mode.interpolation, 1.f);
+		}
+		auto const reduction_time = Milliseconds{Clock::now() - start_time}.count();
+
+		auto max_error = 0.f;
+		auto const sampling_start_time = Clock::now();
+		for (auto i = 0; i < sample_count; ++i)
+		{
+			auto const globals = testing::util::Span<glm::mat4>{mode.should_reduce ? global_transforms.data() : original_globals.data() + i*bone_count, bone_count};
+			animation.evaluate_bone_matrices(sample_time(i), globals, {animation_transforms.data(), bone_count});
+		}
+		auto const sampling_time = std::chrono::duration<double, std::micro>{Clock::now() - sampling_start_time}.count()/sample_count;
+
+		if (mode.should_reduce) {
+			for (auto i = 0; i < sample_count; ++i)
+			{
+				animation.evaluate_bone_matrices(sample_time(i), {global_transforms.data(), bone_count}, {animation_transforms.data(), bone_count});
+				for (auto const bone : testing::util::indices(bone_count)) {
+					max_error = std::max(max_error, glm::length(glm::vec3{global_transforms[bone][3] - original_globals[i*bone_count + bone][3]}));
+				}
+			}
+		}
+
+		fmt::print("{}: {} keys, {:.3f} us per pose, reduced in {:.1f} ms, max bone position error {} units.\n",
+			mode.name, count_keys(), sampling_time, reduction_time, max_error);
+	}
+	return 0;
+}
+
+// Compares a clip's memory and sampling and retargeting time before and after its constant tracks are collapsed.
+int benchmark_constant_tracks(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark constant-tracks <model> <FBX or glTF clip>\n");
+		return 1;
+	}
+	constexpr auto sample_count = 2000;
+	constexpr auto retarget_count = 20;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto& skeleton = model.skeleton();
+	auto const bone_count = skeleton.bone_count();
+	auto const& clip_path = arguments[1];
+
+	// Load the tracks the way Animation does, without collapsing them.
+	auto const animation = testing::Animation{"", skeleton};
+	if (testing::gltf::is_gltf_path(clip_path.c_str())) {
+		testing::Animation::for_each_gltf_track(clip_path.c_str(), [&](std::string const& name, testing::cooked::Channel const channel, auto track) {
+			if (auto* const bone = skeleton.bone_by_name(name.c_str())) {
+				if constexpr (std::is_same_v<decltype(track), testing::AnimationTrack<glm::quat>>) {
+					bone->rotation_track = std::move(track);
+				}
+				else {
+					(channel == testing::cooked::Channel::scale ? bone->scale_track : bone->translation_track) = std::move(track);
+				}
+			}
+		});
+	}
+	else {
+		testing::Animation::for_each_animated_bone(clip_path.c_str(), [&](std::string const& name, FbxNode* const node, FbxAnimLayer* const layer, testing::fbx::CoordinateConversion const& conversion) {
+			if (auto* const bone = skeleton.bone_by_name(name.c_str())) {
+				bone->scale_track = testing::Animation::read_scale_track(node, layer, conversion);
+				bone->rotation_track = testing::Animation::read_rotation_track(node, layer, conversion);
+				bone->translation_track = testing::Animation::read_translation_track(node, layer, conversion);
+			}
+		});
+	}
+	skeleton.update_static_bones();
+
+	auto const duration = animation.duration();
+	auto global_transforms = std::vector<glm::mat4>(bone_count);
+	auto animation_transforms = std::vector<glm::mat4>(bone_count);
+	auto const retargeting = animation_retargeting::create_retargeting(skeleton.extract_pose(), skeleton.extract_pose());
+
+	auto const measure = [&](char const* const name)
+	{
+		auto track_count = std::size_t{};
+		auto byte_count = std::size_t{};
+		for (auto const& bone : skeleton.bones()) {
+			track_count += !bone.scale_track.is_empty() + !bone.rotation_track.is_empty() + !bone.translation_track.is_empty();
+			byte_count += bone.scale_track.key_count()*sizeof(testing::Keyframe<glm::vec3>) + 
+				bone.rotation_track.key_count()*sizeof(testing::Keyframe<glm::quat>) + 
+				bone.translation_track.key_count()*sizeof(testing::Keyframe<glm::vec3>);
+		}
+
+		auto start_time = Clock::now();
+		for (auto i = 0; i < sample_count; ++i) {
+			animation.evaluate_bone_matrices(duration*(static_cast<float>(i)/static_cast<float>(sample_count)), 
+				{global_transforms.data(), bone_count}, {animation_transforms.data(), bone_count});
+		}
+		auto const sampling_time = std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/sample_count;
+
+		auto const source_animation = skeleton.extract_animation();
+		start_time = Clock::now();
+		for (auto i = 0; i < retarget_count; ++i) {
+			animation_retargeting::apply_retargeting(retargeting, source_animation);
+		}
+		auto const retargeting_time = Milliseconds{Clock::now() - start_time}.count()/retarget_count;
+
+		fmt::print("{}: {} tracks, {} bytes, {} of {} bones animated, {:.3f} us per pose, {:.3f} ms to retarget.\n",
+			name, track_count, byte_count, skeleton.animated_bones().count(), bone_count, sampling_time, retargeting_time);
+	};
+
+	measure("All tracks");
+	skeleton.collapse_constant_tracks();
+	measure("Collapsed");
+
+	/*
+		Bakes the clip onto a target whose bind pose differs from the source's, as Scene and the cook tool do. Each side collapses
+		its tracks against its own bind pose, so a constant channel can have no keys on one side and one key on the other, and 
+		the target's tracks have to follow the retargeted channels.
+	*/
+	auto target_model = import_model(arguments[0].c_str(), meshes);
+	auto& target = target_model.skeleton();
+	auto target_pose = target.extract_pose();
+	for (auto& bone : target_pose.bones) {
+		bone.scale *= 1.5f;
+		bone.translation += glm::vec3{0.f, 0.1f, 0.f};
+	}
+	target.set_bind_pose(target_pose);
+	testing::Animation{clip_path.c_str(), target};
+
+	auto const result = animation_retargeting::retarget(skeleton.extract_animation(), skeleton.extract_pose(), target.extract_pose(), 
+		animation_retargeting::ConstantChannels::collapse);
+	target.set_animation_values(result.animation);
+
+	auto mismatch_count = std::size_t{};
+	for (auto const i : testing::util::indices(target.bones()))
+	{
+		auto const& bone = target.bones()[i];
+		auto const& channels = result.animation.bones[i];
+		mismatch_count += (bone.scale_track.key_count() != channels.scales.size()) + 
+			(bone.rotation_track.key_count() != channels.rotations.size()) + 
+			(bone.translation_track.key_count() != channels.translations.size());
+	}
+	fmt::print("Baked onto a different bind pose: {} tracks don't match the retargeted channels.\n", mismatch_count);
+	return mismatch_count ? 1 : 0;
+}
+
+// Compares sampling a clip's tracks, which each store their key times, against a clip whose channels share time axes.
+int benchmark_time_axes(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark time-axes <model> <clip>\n");
+		return 1;
+	}
+	constexpr auto sample_count = 2000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto& skeleton = model.skeleton();
+	auto const animation = testing::Animation{arguments[1].c_str(), skeleton};
+	auto const duration = animation.duration();
+	auto const bone_count = skeleton.bone_count();
+
+	auto track_count = std::size_t{};
+	auto track_bytes = std::size_t{};
+	for (auto const& bone : skeleton.bones()) {
+		track_count += !bone.scale_track.is_empty() + !bone.rotation_track.is_empty() + !bone.translation_track.is_empty();
+		track_bytes += bone.scale_track.key_count()*sizeof(testing::Keyframe<glm::vec3>) + 
+			bone.rotation_track.key_count()*sizeof(testing::Keyframe<glm::quat>) + 
+			bone.translation_track.key_count()*sizeof(testing::Keyframe<glm::vec3>);
+	}
+
+	auto const pose = skeleton.extract_pose();
+	auto const clip = testing::Clip{skeleton.extract_animation(), pose};
+	// The time axes are carried through retargeting, so the result can be played on its own.
+	auto const result = animation_retargeting::retarget(skeleton.extract_animation(), pose, pose, animation_retargeting::ConstantChannels::collapse);
+	auto const retargeted_clip = testing::Clip{result.animation, result.bind_pose};
+
+	auto const sample_time = [&](int const i) {
+		return duration*(static_cast<float>(i)/static_cast<float>(sample_count));
+	};
+	auto track_pose = std::vector<testing::LocalTransform>(bone_count);
+	auto clip_pose = std::vector<testing::LocalTransform>(bone_count);
+
+	auto start_time = Clock::now();
+	for (auto i = 0; i < sample_count; ++i) {
+		for (auto const& bone : skeleton.bones()) {
+			track_pose[bone.id] = testing::LocalTransform{
+				bone.scale_track.evaluate(sample_time(i), bone.local_bind_scale),
+				bone.rotation_track.evaluate(sample_time(i), bone.local_bind_rotation),
+				bone.translation_track.evaluate(sample_time(i), bone.local_bind_translation),
+			};
+		}
+	}
+	auto const track_time = std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/sample_count;
+
+	start_time = Clock::now();
+	for (auto i = 0; i < sample_count; ++i) {
+		clip.sample(sample_time(i), {clip_pose.data(), bone_count});
+	}
+	auto const clip_time = std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/sample_count;
+
+	auto max_translation_difference = 0.f;
+	auto max_rotation_difference = 0.f;
+	for (auto const i : testing::util::indices(bone_count)) {
+		max_translation_difference = std::max(max_translation_difference, glm::length(track_pose[i].translation - clip_pose[i].translation));
+		max_rotation_difference = std::max(max_rotation_difference, rotation_difference_degrees(track_pose[i].rotation, clip_pose[i].rotation));
+	}
+
+	fmt::print("Tracks: {} tracks, {} bytes, {:.3f} us per pose.\n", track_count, track_bytes, track_time);
+	fmt::print("Clip: {} time axes, {} bytes, {:.3f} us per pose. Retargeted: {} time axes, {} bytes.\n", 
+		clip.time_axis_count(), clip.byte_size(), clip_time, retargeted_clip.time_axis_count(), retargeted_clip.byte_size());
+	fmt::print("Max difference at the last sample: {} units, {} degrees.\n", max_translation_difference, max_rotation_difference);
+	return 0;
+}
+
+// Samples rotation tracks with the nlerp fast path and compares it with slerp at every segment.
+int benchmark_rotation_sampling(std::vector<std::string> const& arguments)
+{
+	if (arguments.size() < 2) {
+		fmt::print("Usage: benchmark rotation-sampling <model> <clip>\n");
+		return 1;
+	}
+	constexpr auto sample_count = 2000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto& skeleton = model.skeleton();
+	auto const animation = testing::Animation{arguments[1].c_str(), skeleton};
+	auto const duration = animation.duration();
+
+	auto tracks = std::vector<testing::AnimationTrack<glm::quat> const*>{};
+	auto segment_count = std::size_t{};
+	auto slerp_segment_count = std::size_t{};
+	for (auto const& bone : skeleton.bones())
+	{
+		auto const& track = bone.rotation_track;
+		if (track.key_count() < 2 || track.interpolation() != testing::Interpolation::linear) {
+			continue;
+		}
+		tracks.push_back(&track);
+		segment_count += track.key_count() - 1;
+		for (auto key = std::size_t{1}; key < track.key_count(); ++key) {
+			slerp_segment_count += track.is_slerp_segment(key);
+		}
+	}
+	if (tracks.empty()) {
+		fmt::print("The clip has no linearly interpolated rotation tracks.\n");
+		return 1;
+	}
+
+	auto const sample_time = [&](int const i) {
+		return duration*(static_cast<float>(i)/static_cast<float>(sample_count));
+	};
+	// The same search for the keys as AnimationTrack::evaluate, followed by slerp.
+	auto const evaluate_slerp = [](testing::AnimationTrack<glm::quat> const& track, testing::Seconds const time) {
+		auto const& keyframes = track.keyframes();
+		auto const end_key = std::lower_bound(keyframes.begin(), keyframes.end(), time, 
+			[](testing::Keyframe<glm::quat> const key, testing::Seconds const time) { return key.time < time; });
+		if (end_key == keyframes.begin()) {
+			return keyframes.front().value;
+		}
+		if (end_key == keyframes.end()) {
+			return keyframes.back().value;
+		}
+		auto const& start = *(end_key - 1);
+		return glm::slerp(start.value, end_key->value, (time - start.time)/(end_key->time - start.time));
+	};
+
+	auto nlerp_rotations = std::vector<glm::quat>(tracks.size()*sample_count);
+	auto slerp_rotations = std::vector<glm::quat>(tracks.size()*sample_count);
+
+	auto start_time = Clock::now();
+	for (auto i = 0; i < sample_count; ++i) {
+		for (auto const t : testing::util::indices(tracks)) {
+			nlerp_rotations[static_cast<std::size_t>(i)*tracks.size() + t] = tracks[t]->evaluate(sample_time(i));
+		}
+	}
+	auto const nlerp_time = std::chrono::duration<double, std::nano>{Clock::now() - start_time}.count();
+
+	start_time = Clock::now();
+	for (auto i = 0; i < sample_count; ++i) {
+		for (auto const t : testing::util::indices(tracks)) {
+			slerp_rotations[static_cast<std::size_t>(i)*tracks.size() + t] = evaluate_slerp(*tracks[t], sample_time(i));
+		}
+	}
+	auto const slerp_time = std::chrono::duration<double, std::nano>{Clock::now() - start_time}.count();
+
+	auto max_difference = 0.f;
+	for (auto const i : testing::util::indices(nlerp_rotations)) {
+		max_difference = std::max(max_difference, rotation_difference_degrees(nlerp_rotations[i], slerp_rotations[i]));
+	}
+
+	auto const samples = static_cast<double>(nlerp_rotations.size());
+	fmt::print("{} rotation tracks, {} segments, {} of them turning too far for nlerp.\n", tracks.size(), segment_count, slerp_segment_count);
+	fmt::print("Nlerp fast path: {:.2f} ns per sample. Slerp: {:.2f} ns per sample.\n", nlerp_time/samples, slerp_time/samples);
+	fmt::print("Max difference from slerp: {} degrees.\n", max_difference);
+	return 0;
+}
+
+// Compares the batched bind pose setup of Skeleton with the per-bone glm version it replaced.
+int benchmark_bind_pose_setup(std::vector<std::string> const& arguments)
+{
+	if (arguments.empty()) {
+		fmt::print("Usage: benchmark bind-pose-setup <model> [repetitions]\n");
+		return 1;
+	}
+	auto const repetitions = arguments.size() > 1 ? std::stoi(arguments[1]) : 1000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto model = import_model(arguments[0].c_str(), meshes);
+	auto& skeleton = model.skeleton();
+	auto const& bones = skeleton.bones();
+	auto const pose = skeleton.extract_pose();
+
+	// The per-bone versions, writing into separate arrays so that the skeleton keeps its results.
+	auto glm_inverse_binds = std::vector<glm::mat4>(bones.size());
+	auto glm_binds = std::vector<glm::mat4>(bones.size());
+	auto glm_pose = pose;
+	auto const calculate_local_bind_components_glm = [&] {
+		for (auto const& bone : bones) {
+			glm_inverse_binds[bone.id] = glm::inverse(bone.bind_transform);
+		}
+		for (auto const& bone : bones)
+		{
+			auto const local = bone.has_parent() ? glm_inverse_binds[bone.parent]*bone.bind_transform : glm::inverse(bone.post_translation)*bone.bind_transform;
+			auto& pose_bone = glm_pose.bones[bone.id];
+			glm::vec3 skew;
+			glm::vec4 perspective;
+			glm::decompose(local, pose_bone.scale, pose_bone.rotation, pose_bone.translation, skew, perspective);
+		}
+	};
+	auto const set_bind_pose_glm = [&] {
+		for (auto const& bone : bones)
+		{
+			auto const& pose_bone = pose.bones[bone.id];
+			auto const local = bone.calculate_local_transform(pose_bone.scale, pose_bone.rotation, pose_bone.translation);
+			glm_binds[bone.id] = bone.has_parent() ? glm_binds[bone.parent]*local : local;
+			glm_inverse_binds[bone.id] = glm::inverse(glm_binds[bone.id]);
+		}
+	};
+	auto const time = [&](auto const& run) {
+		auto const start_time = Clock::now();
+		for (auto i = 0; i < repetitions; ++i) {
+			run();
+		}
+		return std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count()/repetitions;
+	};
+
+	// The largest difference of a matrix from the reference, relative to the reference's largest element.
+	auto const matrix_difference = [](glm::mat4 const& a, glm::mat4 const& reference) {
+		auto difference = 0.f;
+		auto magnitude = 1.f;
+		for (auto const column : testing::util::indices(4)) {
+			for (auto const row : testing::util::indices(4)) {
+				difference = std::max(difference, std::abs(a[column][row] - reference[column][row]));
+				magnitude = std::max(magnitude, std::abs(reference[column][row]));
+			}
+		}
+		return difference/magnitude;
+	};
+
+	auto const glm_components_time = time(calculate_local_bind_components_glm);
+	auto const components_time = time([&] { skeleton.calculate_local_bind_components(); });
+
+	auto max_inverse_difference = 0.f;
+	auto max_scale_difference = 0.f;
+	auto max_rotation_difference = 0.f;
+	auto max_translation_difference = 0.f;
+	for (auto const& bone : bones)
+	{
+		auto const& reference = glm_pose.bones[bone.id];
+		max_inverse_difference = std::max(max_inverse_difference, matrix_difference(bone.inverse_bind_transform, glm_inverse_binds[bone.id]));
+		max_scale_difference = std::max(max_scale_difference, glm::compMax(glm::abs(bone.local_bind_scale - reference.scale)));
+		max_rotation_difference = std::max(max_rotation_difference, rotation_difference_degrees(bone.local_bind_rotation, reference.rotation));
+		max_translation_difference = std::max(max_translation_difference, 
+			glm::compMax(glm::abs(bone.local_bind_translation - reference.translation))/std::max(1.f, glm::compMax(glm::abs(reference.translation))));
+	}
+
+	auto const glm_pose_time = time(set_bind_pose_glm);
+	auto const pose_time = time([&] { skeleton.set_bind_pose(pose); });
+
+	auto max_bind_difference = 0.f;
+	auto max_pose_inverse_difference = 0.f;
+	for (auto const& bone : bones) {
+		max_bind_difference = std::max(max_bind_difference, matrix_difference(bone.bind_transform, glm_binds[bone.id]));
+		max_pose_inverse_difference = std::max(max_pose_inverse_difference, matrix_difference(bone.inverse_bind_transform, glm_inverse_binds[bone.id]));
+	}
+
+	fmt::print("{} bones.\n", bones.size());
+	fmt::print("Local bind components: {:.2f} us batched, {:.2f} us per bone with glm.\n", components_time, glm_components_time);
+	fmt::print("  Max differences: inverse bind transform {}, scale {}, rotation {} degrees, relative translation {}.\n", 
+		max_inverse_difference, max_scale_difference, max_rotation_difference, max_translation_difference);
+	fmt::print("Bind pose: {:.2f} us batched, {:.2f} us per bone with glm.\n", pose_time, glm_pose_time);
+	fmt::print("  Max differences: bind transform {}, inverse bind transform {}.\n", max_bind_difference, max_pose_inverse_difference);
+	return 0;
+}
+
+// Compares finding bones by name through the skeleton's interned name index with comparing the name against every bone's.
+int benchmark_bone_lookup(std::vector<std::string> const& arguments)
+{
+	if (arguments.empty()) {
+		fmt::print("Usage: benchmark bone-lookup <model> [repetitions]\n");
+		return 1;
+	}
+	auto const repetitions = arguments.size() > 1 ? std::stoi(arguments[1]) : 10000;
+
+	auto meshes = std::vector<testing::MeshData>{};
+	auto const model = import_model(arguments[0].c_str(), meshes);
+	auto const& skeleton = model.skeleton();
+	auto const& bones = skeleton.bones();
+
+	auto names = std::vector<std::string>{};
+	auto name_ids = std::vector<animation_retargeting::NameId>{};
+	for (auto const& bone : bones) {
+		names.push_back(bone.name);
+		name_ids.push_back(bone.name_id);
+	}
+
+	auto const time = [&](auto const& find_id) {
+		auto ids = std::vector<testing::Bone::Id>(names.size());
+		auto const start_time = Clock::now();
+		for (auto i = 0; i < repetitions; ++i) {
+			for (auto const n : testing::util::indices(names)) {
+				ids[n] = find_id(n);
+			}
+		}
+		auto const nanoseconds = std::chrono::duration<double, std::nano>{Clock::now() - start_time}.count()/(static_cast<double>(repetitions)*static_cast<double>(names.size()));
+		return std::make_pair(nanoseconds, ids);
+	};
+	auto const [linear_time, linear_ids] = time([&](std::size_t const n) {
+		auto const pos = std::find_if(bones.begin(), bones.end(), [&](testing::Bone const& bone) { return bone.name == names[n]; });
+		return static_cast<testing::Bone::Id>(pos - bones.begin());
+	});
+	auto const [string_time, string_ids] = time([&](std::size_t const n) { return skeleton.bone_id_by_name(names[n].c_str()); });
+	auto const [interned_time, interned_ids] = time([&](std::size_t const n) { return skeleton.bone_id_by_name(name_ids[n]); });
+
+	fmt::print("{} bones.\n", bones.size());
+	fmt::print("Linear search: {:.2f} ns, name index by string: {:.2f} ns, by interned name: {:.2f} ns per lookup.\n", linear_time, string_time, interned_time);
+	if (string_ids != linear_ids || interned_ids != linear_ids) {
+		fmt::print("The name index found different bones than the linear search.\n");
+		return 1;
+	}
+	return 0;
+}
+
+// The layout skeletons had before bones were stored by id: a heap allocated util::StaticVector of 256 bones, each 
+// with a pointer to its parent, its name as a std::string and a std::vector of keyframes per track.
+struct PreviousBone {
+	PreviousBone const* parent;
+	std::string name;
+	testing::Bone::Id id;
+	glm::mat4 bind_transform;
+	glm::mat4 inverse_bind_transform;
+	glm::mat4 global_transform;
+	glm::mat4 animation_transform;
+	glm::mat4 pre_scaling;
+	glm::mat4 pre_rotation;
+	glm::mat4 pre_translation;
+	glm::mat4 post_translation;
+	glm::vec3 local_bind_scale;
+	glm::quat local_bind_rotation;
+	glm::vec3 local_bind_translation;
+	std::vector<testing::Keyframe<glm::vec3>> scale_keyframes;
+	std::vector<testing::Keyframe<glm::quat>> rotation_keyframes;
+	std::vector<testing::Keyframe<glm::vec3>> translation_keyframes;
+};
+struct PreviousBones {
+	std::array<PreviousBone, 256> bones;
+	std::size_t size;
+};
+
+// Reports the memory used by skeletons compared with the previous layout, and how long copying one takes.
+int benchmark_skeleton_memory(std::vector<std::string> const& arguments)
+{
+	if (arguments.empty()) {
+		fmt::print("Usage: benchmark skeleton-memory <model>...\n");
+		return 1;
+	}
+	// Like byte_size, without the names and keyframes that the bones own.
+	constexpr auto previous_byte_size = sizeof(PreviousBones);
+
+	for (auto const& path : arguments)
+	{
+		auto meshes = std::vector<testing::MeshData>{};
+		auto const model = import_model(path.c_str(), meshes);
+		auto const& skeleton = model.skeleton();
+		auto const byte_size = skeleton.byte_size();
+
+		auto const start_time = Clock::now();
+		auto const copy = skeleton;
+		auto const copy_time = std::chrono::duration<double, std::micro>{Clock::now() - start_time}.count();
+
+		fmt::print("{}: {} bones, {:.1f} KB, previously {:.1f} KB. Copying the skeleton with its tracks took {:.1f} us.\n", 
+			path, copy.bone_count(), static_cast<double>(byte_size)/1024., static_cast<double>(previous_byte_size)/1024., copy_time);
+	}
+	return 0;
+}
+
+struct Benchmark {
+	char const* name;
+	int (*run)(std::vector<std::string> const&);
+};
+
+constexpr Benchmark benchmarks[] = {
+	{"curve-import", benchmark_curve_import},
+	{"scene-conversion", benchmark_scene_conversion},
+	{"gltf-import", benchmark_gltf_import},
+	{"bvh-import", benchmark_bvh_import},
+	{"live-retarget", benchmark_live_retarget},
+	{"crowd", benchmark_crowd},
+	{"baked-palette", benchmark_baked_palette},
+	{"pose-cache", benchmark_pose_cache},
+	{"skeleton-lod", benchmark_skeleton_lod},
+	{"skinning-variants", benchmark_skinning_variants},
+	{"partial-pose", benchmark_partial_pose},
+	{"clip-compression", benchmark_clip_compression},
+	{"keyframe-reduction", benchmark_keyframe_reduction},
+	{"constant-tracks", benchmark_constant_tracks},
+	{"time-axes", benchmark_time_axes},
+	{"rotation-sampling", benchmark_rotation_sampling},
+	{"bind-pose-setup", benchmark_bind_pose_setup},
+	{"bone-lookup", benchmark_bone_lookup},
+	{"skeleton-memory", benchmark_skeleton_memory},
+};
+
+} // namespace
+
+int main(int const argument_count, char const* const* const arguments)
+{
+	if (argument_count >= 2) {
+		for (auto const& benchmark : benchmarks) {
+			if (!std::strcmp(arguments[1], benchmark.name)) {
+				try {
+					return benchmark.run(std::vector<std::string>(arguments + 2, arguments + argument_count));
+				}
+				catch (std::exception const& exception) {
+					fmt::print("{}\n", exception.what());
+					return 1;
+				}
+			}
+		}
+	}
+
+	fmt::print("Usage: benchmark <name> [arguments...]\nAvailable benchmarks:\n");
+	for (auto const& benchmark : benchmarks) {
+		fmt::print("  {}\n", benchmark.name);
+	}
+	return 1;
+}
@@ -0,0 +1,35 @@
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "cook.hpp"
+
+#include <fmt/format.h>
+
+#include <cstring>
+#include <thread>
+
+int main(int const argument_count, char const* const* const arguments) 
+{
+	if (argument_count < 3) {
+		fmt::print("Usage: cook <manifest> <output directory> [-j <thread count>]\n");
+		return 1;
+	}
+
+	auto thread_count = std::thread::hardware_concurrency();
+	if (argument_count >= 5 && !std::strcmp(arguments[3], "-j")) {
+		thread_count = static_cast<unsigned>(std::stoul(arguments[4]));
+	}
+
+	try {
+		auto const manifest = testing::cook::Manifest{arguments[1]};
+		auto const summary = testing::cook::Pipeline{manifest.assets(), arguments[2], thread_count}.run();
+
+		fmt::print("{} skipped, {} rebuilt, {} failed. Took {:.2f} s ({:.2f} s spent cooking on {} threads).\n", 
+			summary.skipped, summary.rebuilt, summary.failed, summary.total_time.count(), summary.cook_time.count(), thread_count);
+
+		return summary.failed ? 1 : 0;
+	}
+	catch (std::exception const& exception) {
+		fmt::print("{}\n", exception.what());
+		return 1;
+	}
+}
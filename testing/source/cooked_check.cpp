@@ -0,0 +1,211 @@
+// Writes a skeleton, a clip and a mesh to a cooked file, maps it back and compares every field.
+// Doesn't use the FBX SDK, so that the cooked format can be checked where the SDK isn't installed.
+// Usage: cooked_check [output path]
+
+#include "cooked.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Vertex {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 texture_coordinates;
+	std::array<std::uint32_t, 4> bone_ids;
+	glm::vec4 bone_weights;
+};
+
+struct Bone {
+	char const* name;
+	std::uint32_t parent;
+	testing::cooked::BoneRecord record;
+};
+
+template<typename T>
+struct Track {
+	char const* bone_name;
+	testing::cooked::Channel channel;
+	std::vector<float> times;
+	std::vector<T> values;
+};
+
+class Checker {
+private:
+	int failure_count_{};
+
+public:
+	template<typename T>
+	void equal(std::string const& field, T const& read, T const& written)
+	{
+		if (!(read == written)) {
+			fmt::print("{} differs from what was written.\n", field);
+			++failure_count_;
+		}
+	}
+	void is_true(std::string const& field, bool const condition)
+	{
+		if (!condition) {
+			fmt::print("{} is wrong.\n", field);
+			++failure_count_;
+		}
+	}
+
+	int failure_count() const {
+		return failure_count_;
+	}
+};
+
+testing::cooked::BoneRecord make_bone_record(float const seed)
+{
+	auto record = testing::cooked::BoneRecord{};
+	record.bind_transform = glm::mat4{glm::vec4{seed, 0.f, 0.f, 0.f}, glm::vec4{0.f, seed + 1.f, 0.f, 0.f},
+		glm::vec4{0.f, 0.f, seed + 2.f, 0.f}, glm::vec4{seed, -seed, 0.5f*seed, 1.f}};
+	record.pre_scaling = glm::mat4{1.f};
+	record.pre_rotation = glm::mat4{glm::vec4{0.f, 1.f, 0.f, 0.f}, glm::vec4{-1.f, 0.f, 0.f, 0.f},
+		glm::vec4{0.f, 0.f, 1.f, 0.f}, glm::vec4{0.f, 0.f, 0.f, 1.f}};
+	record.pre_translation = glm::mat4{glm::vec4{1.f, 0.f, 0.f, 0.f}, glm::vec4{0.f, 1.f, 0.f, 0.f},
+		glm::vec4{0.f, 0.f, 1.f, 0.f}, glm::vec4{seed, 2.f*seed, 3.f*seed, 1.f}};
+	record.post_translation = glm::mat4{2.f};
+	record.local_bind_scale = glm::vec3{1.f, seed, 1.f};
+	record.local_bind_rotation = glm::quat{0.5f, 0.5f, -0.5f, 0.5f};
+	record.local_bind_translation = glm::vec3{-seed, seed, 0.25f};
+	return record;
+}
+
+template<typename T>
+void check_track(Checker& checker, testing::cooked::File const& file, testing::cooked::TrackRecord const& record, Track<T> const& track)
+{
+	auto const prefix = fmt::format("Track of {}", track.bone_name);
+
+	checker.equal(prefix + " bone name", std::string{file.string(record.bone_name)}, std::string{track.bone_name});
+	checker.is_true(prefix + " channel", record.channel == track.channel);
+	checker.equal(prefix + " key count", std::size_t{record.key_count}, track.times.size());
+
+	auto const times = file.times(record);
+	auto const values = file.values<T>(record);
+	checker.is_true(prefix + " times alignment", reinterpret_cast<std::uintptr_t>(times.data()) % testing::cooked::alignment == 0);
+	checker.is_true(prefix + " values alignment", reinterpret_cast<std::uintptr_t>(values.data()) % testing::cooked::alignment == 0);
+	if (times.size() != track.times.size() || values.size() != track.values.size()) {
+		checker.is_true(prefix + " array sizes", false);
+		return;
+	}
+	for (auto i = std::size_t{}; i < times.size(); ++i) {
+		checker.equal(fmt::format("{} time {}", prefix, i), times[i], track.times[i]);
+		checker.equal(fmt::format("{} value {}", prefix, i), values[i], track.values[i]);
+	}
+}
+
+} // namespace
+
+int main(int const argument_count, char const* const* const arguments)
+{
+	auto const path = std::string{argument_count > 1 ? arguments[1] : "cooked_check.cooked"};
+
+	auto const bones = std::vector<Bone>{
+		{"hips", testing::cooked::no_parent, make_bone_record(1.f)},
+		{"spine", 0, make_bone_record(2.f)},
+		{"head", 1, make_bone_record(3.f)},
+		{"left_leg", 0, make_bone_record(4.f)},
+	};
+	auto const translation_track = Track<glm::vec3>{"hips", testing::cooked::Channel::translation,
+		{0.f, 0.5f, 1.f}, {glm::vec3{0.f}, glm::vec3{0.f, 1.f, 0.f}, glm::vec3{1.f, 2.f, 3.f}}};
+	auto const rotation_track = Track<glm::quat>{"spine", testing::cooked::Channel::rotation,
+		{0.f, 1.f}, {glm::quat{1.f, 0.f, 0.f, 0.f}, glm::quat{0.f, 0.f, 1.f, 0.f}}};
+	auto const empty_track = Track<glm::vec3>{"head", testing::cooked::Channel::scale, {}, {}};
+
+	auto const vertices = std::vector<Vertex>{
+		{glm::vec3{0.f, 0.f, 0.f}, glm::vec3{0.f, 0.f, 1.f}, glm::vec2{0.f, 0.f}, {0, 1, 0, 0}, glm::vec4{0.75f, 0.25f, 0.f, 0.f}},
+		{glm::vec3{1.f, 0.f, 0.f}, glm::vec3{0.f, 0.f, 1.f}, glm::vec2{1.f, 0.f}, {1, 2, 0, 0}, glm::vec4{0.5f, 0.5f, 0.f, 0.f}},
+		{glm::vec3{0.f, 1.f, 0.f}, glm::vec3{0.f, 0.f, 1.f}, glm::vec2{0.f, 1.f}, {3, 0, 0, 0}, glm::vec4{1.f, 0.f, 0.f, 0.f}},
+	};
+	auto const indices = std::vector<std::uint32_t>{0, 1, 2, 2, 1, 0};
+
+	try {
+		auto writer = testing::cooked::Writer{};
+		for (auto const& bone : bones) {
+			writer.add_bone(bone.name, bone.parent, bone.record);
+		}
+		writer.add_track(translation_track.bone_name, translation_track.channel, translation_track.times, translation_track.values);
+		writer.add_track(rotation_track.bone_name, rotation_track.channel, rotation_track.times, rotation_track.values);
+		writer.add_track(empty_track.bone_name, empty_track.channel, empty_track.times, empty_track.values);
+		writer.add_mesh(vertices, indices);
+		writer.write(path.c_str());
+
+		auto checker = Checker{};
+		{
+			auto const file = testing::cooked::File{path.c_str()};
+
+			auto const bone_records = file.bones();
+			checker.equal("Bone count", bone_records.size(), bones.size());
+			for (auto i = std::size_t{}; i < std::min(bone_records.size(), bones.size()); ++i)
+			{
+				auto const& read = bone_records[i];
+				auto const& written = bones[i].record;
+				auto const prefix = fmt::format("Bone {}", i);
+
+				checker.equal(prefix + " name", std::string{file.string(read.name)}, std::string{bones[i].name});
+				checker.equal(prefix + " parent", read.parent, bones[i].parent);
+				checker.equal(prefix + " bind transform", read.bind_transform, written.bind_transform);
+				checker.equal(prefix + " pre-scaling", read.pre_scaling, written.pre_scaling);
+				checker.equal(prefix + " pre-rotation", read.pre_rotation, written.pre_rotation);
+				checker.equal(prefix + " pre-translation", read.pre_translation, written.pre_translation);
+				checker.equal(prefix + " post-translation", read.post_translation, written.post_translation);
+				checker.equal(prefix + " local bind scale", read.local_bind_scale, written.local_bind_scale);
+				checker.equal(prefix + " local bind rotation", read.local_bind_rotation, written.local_bind_rotation);
+				checker.equal(prefix + " local bind translation", read.local_bind_translation, written.local_bind_translation);
+			}
+
+			auto const tracks = file.tracks();
+			checker.equal("Track count", tracks.size(), std::size_t{3});
+			if (tracks.size() == 3) {
+				check_track(checker, file, tracks[0], translation_track);
+				check_track(checker, file, tracks[1], rotation_track);
+				check_track(checker, file, tracks[2], empty_track);
+			}
+
+			auto const meshes = file.meshes();
+			checker.equal("Mesh count", meshes.size(), std::size_t{1});
+			if (meshes.size() == 1)
+			{
+				auto const read_vertices = file.vertices<Vertex>(meshes[0]);
+				auto const read_indices = file.indices(meshes[0]);
+				checker.equal("Vertex count", read_vertices.size(), vertices.size());
+				checker.equal("Index count", read_indices.size(), indices.size());
+
+				for (auto i = std::size_t{}; i < std::min(read_vertices.size(), vertices.size()); ++i)
+				{
+					auto const prefix = fmt::format("Vertex {}", i);
+					checker.equal(prefix + " position", read_vertices[i].position, vertices[i].position);
+					checker.equal(prefix + " normal", read_vertices[i].normal, vertices[i].normal);
+					checker.equal(prefix + " texture coordinates", read_vertices[i].texture_coordinates, vertices[i].texture_coordinates);
+					checker.equal(prefix + " bone ids", read_vertices[i].bone_ids, vertices[i].bone_ids);
+					checker.equal(prefix + " bone weights", read_vertices[i].bone_weights, vertices[i].bone_weights);
+				}
+				for (auto i = std::size_t{}; i < std::min(read_indices.size(), indices.size()); ++i) {
+					checker.equal(fmt::format("Index {}", i), read_indices[i], indices[i]);
+				}
+			}
+		}
+		std::remove(path.c_str());
+
+		if (checker.failure_count()) {
+			fmt::print("{} cooked fields didn't survive the round trip.\n", checker.failure_count());
+			return 1;
+		}
+		fmt::print("The cooked skeleton, clip and mesh read back unchanged.\n");
+		return 0;
+	}
+	catch (std::exception const& exception) {
+		fmt::print("{}\n", exception.what());
+		return 1;
+	}
+}
@@ -0,0 +1,283 @@
+// Runs headless frames of a few animated characters and fails if any warmed-up frame allocates from the heap.
+// Builds the characters from a cooked file that it writes itself, so it needs neither the FBX SDK nor model files.
+// Usage: frame_check [frames] [characters]
+
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "animated_model.hpp"
+#include "animation_lod.hpp"
+#include "arena.hpp"
+#include "cooked.hpp"
+#include "model.hpp"
+#include "pose_cache.hpp"
+
+#include <fmt/format.h>
+#include <glm/ext.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#	include <malloc.h>
+#endif
+
+namespace {
+
+// Counted by every replaced operator new, including the aligned and nothrow ones.
+std::atomic<std::size_t> heap_allocation_count{};
+
+void* allocate(std::size_t const size) noexcept
+{
+	heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void* allocate_aligned(std::size_t const size, std::align_val_t const alignment) noexcept
+{
+	heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	auto const alignment_size = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+	return _aligned_malloc(size ? size : 1, alignment_size);
+#else
+	// aligned_alloc needs the size to be a multiple of the alignment.
+	return std::aligned_alloc(alignment_size, (std::max(size, std::size_t{1}) + alignment_size - 1)/alignment_size*alignment_size);
+#endif
+}
+
+void free_aligned(void* const memory) noexcept
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+} // namespace
+
+void* operator new(std::size_t const size)
+{
+	if (auto* const memory = allocate(size)) {
+		return memory;
+	}
+	throw std::bad_alloc{};
+}
+void* operator new[](std::size_t const size) {
+	return operator new(size);
+}
+void* operator new(std::size_t const size, std::nothrow_t const&) noexcept {
+	return allocate(size);
+}
+void* operator new[](std::size_t const size, std::nothrow_t const&) noexcept {
+	return allocate(size);
+}
+void* operator new(std::size_t const size, std::align_val_t const alignment)
+{
+	if (auto* const memory = allocate_aligned(size, alignment)) {
+		return memory;
+	}
+	throw std::bad_alloc{};
+}
+void* operator new[](std::size_t const size, std::align_val_t const alignment) {
+	return operator new(size, alignment);
+}
+void* operator new(std::size_t const size, std::align_val_t const alignment, std::nothrow_t const&) noexcept {
+	return allocate_aligned(size, alignment);
+}
+void* operator new[](std::size_t const size, std::align_val_t const alignment, std::nothrow_t const&) noexcept {
+	return allocate_aligned(size, alignment);
+}
+
+void operator delete(void* const memory) noexcept {
+	std::free(memory);
+}
+void operator delete[](void* const memory) noexcept {
+	std::free(memory);
+}
+void operator delete(void* const memory, std::size_t) noexcept {
+	std::free(memory);
+}
+void operator delete[](void* const memory, std::size_t) noexcept {
+	std::free(memory);
+}
+void operator delete(void* const memory, std::nothrow_t const&) noexcept {
+	std::free(memory);
+}
+void operator delete[](void* const memory, std::nothrow_t const&) noexcept {
+	std::free(memory);
+}
+void operator delete(void* const memory, std::align_val_t) noexcept {
+	free_aligned(memory);
+}
+void operator delete[](void* const memory, std::align_val_t) noexcept {
+	free_aligned(memory);
+}
+void operator delete(void* const memory, std::size_t, std::align_val_t) noexcept {
+	free_aligned(memory);
+}
+void operator delete[](void* const memory, std::size_t, std::align_val_t) noexcept {
+	free_aligned(memory);
+}
+void operator delete(void* const memory, std::align_val_t, std::nothrow_t const&) noexcept {
+	free_aligned(memory);
+}
+void operator delete[](void* const memory, std::align_val_t, std::nothrow_t const&) noexcept {
+	free_aligned(memory);
+}
+
+namespace {
+
+/*
+	Writes a character to a cooked file: a branching skeleton where each bone sits above its parent, a one second clip that
+	turns every bone and moves the root, and a mesh with a vertex next to each bone, skinned to it and its parent.
+*/
+void write_character(char const* const path, std::uint32_t const bone_count)
+{
+	auto writer = testing::cooked::Writer{};
+	auto const times = std::vector<float>{0.f, 0.25f, 0.5f, 0.75f, 1.f};
+
+	auto global_transforms = std::vector<glm::mat4>(bone_count);
+	auto vertices = std::vector<testing::Vertex>{};
+	auto indices = std::vector<std::uint32_t>{};
+
+	for (auto bone = std::uint32_t{}; bone < bone_count; ++bone)
+	{
+		auto const parent = bone ? (bone - 1)/2 : testing::cooked::no_parent;
+		auto const local_translation = bone ? glm::vec3{bone % 2 ? 0.2f : -0.2f, 0.3f, 0.f} : glm::vec3{0.f, 1.f, 0.f};
+		auto const local_transform = glm::translate(glm::mat4{1.f}, local_translation);
+		global_transforms[bone] = bone ? global_transforms[parent]*local_transform : local_transform;
+
+		auto record = testing::cooked::BoneRecord{};
+		record.bind_transform = global_transforms[bone];
+		record.pre_scaling = glm::mat4{1.f};
+		record.pre_rotation = glm::mat4{1.f};
+		record.pre_translation = glm::mat4{1.f};
+		record.post_translation = glm::mat4{1.f};
+		record.local_bind_scale = glm::vec3{1.f};
+		record.local_bind_rotation = glm::quat{1.f, 0.f, 0.f, 0.f};
+		record.local_bind_translation = local_translation;
+
+		auto const name = fmt::format("bone_{}", bone);
+		writer.add_bone(name.c_str(), parent, record);
+
+		auto rotations = std::vector<glm::quat>{};
+		for (auto const time : times) {
+			rotations.push_back(glm::angleAxis(0.3f*std::sin(6.283f*time + static_cast<float>(bone)), glm::vec3{0.f, 0.f, 1.f}));
+		}
+		writer.add_track(name.c_str(), testing::cooked::Channel::rotation, times, rotations);
+		if (!bone)
+		{
+			auto translations = std::vector<glm::vec3>{};
+			for (auto const time : times) {
+				translations.push_back(local_translation + glm::vec3{0.f, 0.1f*std::sin(6.283f*time), 0.f});
+			}
+			writer.add_track(name.c_str(), testing::cooked::Channel::translation, times, translations);
+		}
+
+		auto vertex = testing::Vertex{};
+		vertex.position = glm::vec3{global_transforms[bone][3]} + glm::vec3{0.f, 0.f, 0.1f};
+		vertex.normal = glm::vec3{0.f, 0.f, 1.f};
+		vertex.add_bone(bone, bone ? 0.75f : 1.f);
+		if (bone) {
+			vertex.add_bone(parent, 0.25f);
+			indices.insert(indices.end(), {bone, parent, 0});
+		}
+		vertices.push_back(vertex);
+	}
+	writer.add_mesh(vertices, indices);
+	writer.write(path);
+}
+
+} // namespace
+
+int main(int const argument_count, char const* const* const arguments)
+{
+	auto const frame_count = argument_count > 1 ? std::stoi(arguments[1]) : 1000;
+	auto const character_count = argument_count > 2 ? std::stoi(arguments[2]) : 8;
+	// The viewer moves away from the characters and back over this many frames, so that they go through every LOD level
+	// and out of view and back. The frames warm up over one trip.
+	constexpr auto trip_frame_count = 128;
+	constexpr auto warm_up_frame_count = trip_frame_count;
+	constexpr auto path = "frame_check.cooked";
+
+	try {
+		write_character(path, 63);
+
+		auto animation_lod = testing::AnimationLod{testing::AnimationLod::Milliseconds{2.f}, {40.f, 80.f, 160.f}};
+		auto meshes = std::vector<testing::MeshData>{};
+		auto characters = std::deque<testing::AnimatedModel>{};
+		for (auto i = 0; i < character_count; ++i)
+		{
+			auto& character = characters.emplace_back(testing::Model::import_cooked(path, meshes), path);
+			character.position_scale(glm::vec3{10.f*static_cast<float>(i - character_count/2), 0.f, -30.f}, 1.f);
+			character.calculate_bounds();
+			character.restart_animation();
+			animation_lod.add_character(character);
+		}
+		meshes.clear();
+		std::remove(path);
+
+		auto pose_cache = testing::PoseCache{};
+		auto frame_arena = testing::util::Arena{};
+		auto const projection = glm::perspective(glm::radians(50.f), 16.f/9.f, 0.1f, 100.f);
+		auto visible_count = std::size_t{};
+		auto checksum = 0.f;
+
+		// The frame of Scene without the drawing: the arena is reset, AnimationLod updates the characters, the visible ones
+		// are culled against the view, and the matrices for the shaders are gathered in the arena. Also looks the poses up in a pose cache.
+		auto const run_frame = [&](int const frame)
+		{
+			auto const trip_frame = frame % trip_frame_count;
+			auto const distance = 4.f*static_cast<float>(std::min(trip_frame, trip_frame_count - trip_frame));
+			auto const viewer_position = glm::vec3{0.f, 8.f, distance};
+
+			frame_arena.reset();
+			pose_cache.begin_frame();
+			animation_lod.update(viewer_position);
+
+			auto const frustum = testing::Frustum::from_matrix(projection*glm::translate(glm::mat4{1.f}, -viewer_position));
+			for (auto& character : characters)
+			{
+				if (!character.is_visible(frustum)) {
+					continue;
+				}
+				++visible_count;
+				auto const bone_matrices = character.gather_bone_matrices(frame_arena);
+				auto const cached_transforms = pose_cache.animation_transforms(character.animation(), character.animation_time());
+				checksum += bone_matrices.back()[3][0] + cached_transforms.back()[3][0];
+			}
+		};
+
+		for (auto i = 0; i < warm_up_frame_count; ++i) {
+			run_frame(i);
+		}
+		visible_count = 0;
+		auto const allocation_count_before = heap_allocation_count.load();
+		for (auto i = 0; i < frame_count; ++i) {
+			run_frame(warm_up_frame_count + i);
+		}
+		auto const allocation_count = heap_allocation_count.load() - allocation_count_before;
+
+		fmt::print("{} characters, {:.1f} visible on average, {} bytes of frame scratch memory (checksum {}).\n",
+			characters.size(), static_cast<double>(visible_count)/frame_count, frame_arena.byte_size(), checksum);
+		if (allocation_count) {
+			fmt::print("{} heap allocations in {} warmed-up frames.\n", allocation_count, frame_count);
+			return 1;
+		}
+		fmt::print("No heap allocations in {} warmed-up frames.\n", frame_count);
+		return 0;
+	}
+	catch (std::exception const& exception) {
+		std::remove(path);
+		fmt::print("{}\n", exception.what());
+		return 1;
+	}
+}
@@ -0,0 +1,180 @@
+// Compares every SIMD kernel with glm for each instruction set that the CPU supports, and measures them.
+// Doesn't use the FBX SDK, so that every dispatch path can be checked wherever the kernels are built.
+// Usage: simd_check [element count]
+
+#include "simd.hpp"
+
+#include <fmt/format.h>
+#include <glm/ext.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+} // namespace
+
+int main(int const argument_count, char const* const* const arguments)
+{
+	auto const count = argument_count > 1 ? static_cast<std::size_t>(std::stoul(arguments[1])) : std::size_t{4099};
+	constexpr auto repetitions = 200;
+	constexpr auto tolerance = 1e-5f;
+
+	auto random = std::mt19937{1};
+	auto uniform = std::uniform_real_distribution<float>{-1.f, 1.f};
+	auto const random_vector = [&] {
+		return glm::vec3{uniform(random), uniform(random), uniform(random)};
+	};
+
+	// Pairs of rotations up to 90 degrees apart like neighbouring animation keys, half of them in opposite hemispheres.
+	auto starts = std::vector<glm::quat>(count);
+	auto ends = std::vector<glm::quat>(count);
+	auto weights = std::vector<float>(count);
+	auto scales = std::vector<glm::vec3>(count);
+	auto translations = std::vector<glm::vec3>(count);
+	auto matrices = std::vector<glm::mat4>(count);
+	for (auto i = std::size_t{}; i < count; ++i)
+	{
+		starts[i] = glm::normalize(glm::quat{uniform(random), uniform(random), uniform(random), uniform(random)});
+		ends[i] = starts[i]*glm::angleAxis(glm::radians(45.f)*(uniform(random) + 1.f), glm::normalize(random_vector()));
+		if (i % 2) {
+			ends[i] = -ends[i];
+		}
+		weights[i] = 0.5f*(uniform(random) + 1.f);
+		scales[i] = glm::vec3{1.f} + 0.5f*random_vector();
+		translations[i] = 10.f*random_vector();
+		matrices[i] = glm::translate(glm::mat4{1.f}, translations[i])*glm::mat4_cast(starts[i])*glm::scale(glm::mat4{1.f}, scales[i]);
+	}
+	auto const start_components = testing::simd::ComponentArrays{starts};
+	auto const end_components = testing::simd::ComponentArrays{ends};
+	auto const scale_components = testing::simd::ComponentArrays{scales};
+	auto const translation_components = testing::simd::ComponentArrays{translations};
+	auto vector_results = testing::simd::ComponentArrays{translations};
+	auto quat_results = testing::simd::ComponentArrays{starts};
+	auto scale_results = testing::simd::ComponentArrays{scales};
+	auto matrix_results = std::vector<glm::mat4>(count);
+	auto glm_vectors = std::vector<glm::vec3>(count);
+	auto glm_quats = std::vector<glm::quat>(count);
+	auto glm_matrices = std::vector<glm::mat4>(count);
+	auto glm_scales = std::vector<glm::vec3>(count);
+
+	auto const quat_error = [](glm::quat const a, glm::quat const b) {
+		return glm::length(glm::vec4{a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w});
+	};
+	// Relative to the size of the column, since translations are larger than the rest.
+	auto const matrix_error = [](glm::mat4 const& a, glm::mat4 const& b) {
+		auto error = 0.f;
+		for (auto const column : {0, 1, 2, 3}) {
+			error = std::max(error, glm::length(a[column] - b[column])/(1.f + glm::length(b[column])));
+		}
+		return error;
+	};
+
+	// Each kernel has its glm equivalent, which also gives the expected results.
+	struct Kernel {
+		char const* name;
+		std::function<void()> run;
+		std::function<void()> run_glm;
+		std::function<float(std::size_t)> error;
+	};
+	auto const kernels = std::array<Kernel, 8>{{
+		{"rotate", 
+			[&] { testing::simd::rotate(start_components.quat(), translation_components.vec3(), count, vector_results.vec3()); },
+			[&] { for (auto i = std::size_t{}; i < count; ++i) { glm_vectors[i] = starts[i]*translations[i]; } },
+			[&](std::size_t const i) { return glm::length(vector_results.vec3(i) - glm_vectors[i])/(1.f + glm::length(glm_vectors[i])); }},
+		{"normalize",
+			[&] { testing::simd::normalize(end_components.quat(), count, quat_results.quat()); },
+			[&] { for (auto i = std::size_t{}; i < count; ++i) { glm_quats[i] = glm::normalize(ends[i]); } },
+			[&](std::size_t const i) { return quat_error(quat_results.quat(i), glm_quats[i]); }},
+		{"nlerp",
+			[&] { testing::simd::nlerp(start_components.quat(), end_components.quat(), weights.data(), count, quat_results.quat()); },
+			[&] {
+				for (auto i = std::size_t{}; i < count; ++i) {
+					auto const end = glm::dot(starts[i], ends[i]) < 0.f ? -ends[i] : ends[i];
+					glm_quats[i] = glm::normalize(starts[i]*(1.f - weights[i]) + end*weights[i]);
+				}
+			},
+			[&](std::size_t const i) { return quat_error(quat_results.quat(i), glm_quats[i]); }},
+		{"slerp",
+			[&] { testing::simd::slerp(start_components.quat(), end_components.quat(), weights.data(), count, quat_results.quat()); },
+			[&] { for (auto i = std::size_t{}; i < count; ++i) { glm_quats[i] = glm::slerp(starts[i], ends[i], weights[i]); } },
+			[&](std::size_t const i) { return quat_error(quat_results.quat(i), glm_quats[i]); }},
+		{"compose",
+			[&] { testing::simd::compose(scale_components.vec3(), start_components.quat(), translation_components.vec3(), count, matrix_results.data()); },
+			[&] { for (auto i = std::size_t{}; i < count; ++i) { glm_matrices[i] = glm::translate(glm::mat4{1.f}, translations[i])*glm::mat4_cast(starts[i])*glm::scale(glm::mat4{1.f}, scales[i]); } },
+			[&](std::size_t const i) { return matrix_error(matrix_results[i], glm_matrices[i]); }},
+		{"multiply",
+			[&] { testing::simd::multiply(matrices.data(), matrices.data(), count, matrix_results.data()); },
+			[&] { for (auto i = std::size_t{}; i < count; ++i) { glm_matrices[i] = matrices[i]*matrices[i]; } },
+			[&](std::size_t const i) { return matrix_error(matrix_results[i], glm_matrices[i]); }},
+		{"inverse",
+			[&] { testing::simd::inverse_affine(matrices.data(), count, matrix_results.data()); },
+			[&] { for (auto i = std::size_t{}; i < count; ++i) { glm_matrices[i] = glm::inverse(matrices[i]); } },
+			[&](std::size_t const i) { return matrix_error(matrix_results[i], glm_matrices[i]); }},
+		{"decompose",
+			[&] { testing::simd::decompose(matrices.data(), count, scale_results.vec3(), quat_results.quat(), vector_results.vec3()); },
+			[&] {
+				for (auto i = std::size_t{}; i < count; ++i) {
+					auto skew = glm::vec3{};
+					auto perspective = glm::vec4{};
+					glm::decompose(matrices[i], glm_scales[i], glm_quats[i], glm_vectors[i], skew, perspective);
+				}
+			},
+			[&](std::size_t const i) {
+				// Both signs of a quaternion are the same rotation.
+				auto const rotation = quat_results.quat(i);
+				return std::max({
+					glm::length(scale_results.vec3(i) - glm_scales[i]), 
+					std::min(quat_error(rotation, glm_quats[i]), quat_error(-rotation, glm_quats[i])),
+					glm::length(vector_results.vec3(i) - glm_vectors[i])/(1.f + glm::length(glm_vectors[i])),
+				});
+			}},
+	}};
+
+	auto const nanoseconds_per_element = [&](std::function<void()> const& run) {
+		auto const start_time = Clock::now();
+		for (auto i = 0; i < repetitions; ++i) {
+			run();
+		}
+		return std::chrono::duration<double, std::nano>{Clock::now() - start_time}.count()/static_cast<double>(repetitions*count);
+	};
+
+	constexpr char const* instruction_set_names[] = {"Scalar", "SSE2", "AVX2", "AVX-512"};
+	auto const supported = testing::simd::supported_instruction_set();
+	fmt::print("{} elements, {} supported.\n", count, instruction_set_names[static_cast<int>(supported)]);
+
+	auto failed = false;
+	for (auto const& kernel : kernels)
+	{
+		// The glm version runs first and gives the results that the kernels are compared with.
+		fmt::print("{:<10} glm: {:.2f} ns", kernel.name, nanoseconds_per_element(kernel.run_glm));
+		for (auto level = 0; level <= static_cast<int>(supported); ++level)
+		{
+			testing::simd::set_instruction_set(static_cast<testing::simd::InstructionSet>(level));
+			auto const time = nanoseconds_per_element(kernel.run);
+			auto max_error = 0.f;
+			for (auto i = std::size_t{}; i < count; ++i) {
+				max_error = std::max(max_error, kernel.error(i));
+			}
+			failed = failed || !(max_error <= tolerance);
+			fmt::print(", {}: {:.2f} ns, {:.1e} error", instruction_set_names[level], time, max_error);
+		}
+		fmt::print("\n");
+	}
+	testing::simd::set_instruction_set(supported);
+
+	if (failed) {
+		fmt::print("Some kernels differ from glm by more than {}.\n", tolerance);
+		return 1;
+	}
+	return 0;
+}